@@ -0,0 +1,69 @@
+#include "geo.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std::literals;
+
+// Time per distance from one point to many: ComputeDistance on coordinates, on precomputed
+// trigonometry and ComputeDistances on a batch. Usage: geo_bench [POINTS]
+namespace {
+template <typename Function>
+double MeasureNsPerDistance(size_t count, Function function) {
+    constexpr int RUNS = 5;
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < RUNS; ++i) {
+        function();
+    }
+    const std::chrono::duration<double, std::nano> time = std::chrono::steady_clock::now() - start;
+    return time.count() / (RUNS * count);
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+    const size_t count = argc > 1 ? std::stoul(argv[1]) : 1000000;
+    std::mt19937 generator(1);
+    std::uniform_real_distribution<double> latitude(55.5, 56.0);
+    std::uniform_real_distribution<double> longitude(37.3, 37.9);
+    std::vector<geo::Coordinates> points;
+    std::vector<geo::CoordinatesTrig> points_trig;
+    geo::CoordinatesBatch batch;
+    batch.Reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        points.push_back({ latitude(generator), longitude(generator) });
+        points_trig.push_back(geo::PrecomputeTrig(points.back()));
+        batch.Add(points_trig.back());
+    }
+    const geo::Coordinates from{ 55.75, 37.62 };
+    const geo::CoordinatesTrig from_trig = geo::PrecomputeTrig(from);
+
+    std::vector<double> scalar(count);
+    std::vector<double> distances;
+    const double coordinates_time = MeasureNsPerDistance(count, [&] {
+        for (size_t i = 0; i < count; ++i) {
+            scalar[i] = geo::ComputeDistance(from, points[i]);
+        }
+    });
+    const double trig_time = MeasureNsPerDistance(count, [&] {
+        for (size_t i = 0; i < count; ++i) {
+            scalar[i] = geo::ComputeDistance(from_trig, points_trig[i]);
+        }
+    });
+    const double batch_time = MeasureNsPerDistance(count, [&] {
+        geo::ComputeDistances(from_trig, batch, distances);
+    });
+
+    double max_error = 0;
+    for (size_t i = 0; i < count; ++i) {
+        max_error = std::max(max_error, std::abs(distances[i] - scalar[i]) / scalar[i]);
+    }
+    std::cout << "ComputeDistance(Coordinates):     "sv << coordinates_time << " ns"sv << std::endl;
+    std::cout << "ComputeDistance(CoordinatesTrig): "sv << trig_time << " ns"sv << std::endl;
+    std::cout << "ComputeDistances(batch):          "sv << batch_time << " ns"sv << std::endl;
+    std::cout << "max relative difference: "sv << max_error << std::endl;
+}
\ No newline at end of file
@@ -0,0 +1,87 @@
+#include "json.h"
+#include "json_stream_parser.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <string_view>
+
+using namespace std::literals;
+
+// Throughput of json::Load against the stream parser it replaced, in MB/s.
+// Usage: json_bench [SIZE_MB]; the input is a make_base document of about that size
+namespace {
+std::string MakeInput(size_t size) {
+    std::mt19937 generator(1);
+    std::uniform_real_distribution<double> latitude(55.5, 56.0);
+    std::uniform_real_distribution<double> longitude(37.3, 37.9);
+    std::ostringstream out;
+    out.precision(17);
+    out << "{\n \"serialization_settings\": {\"file\": \"base.db\"},\n"sv
+        << " \"routing_settings\": {\"bus_wait_time\": 2, \"bus_velocity\": 30},\n"sv
+        << " \"base_requests\": [\n"sv;
+    for (size_t i = 0; out.tellp() < static_cast<std::streamoff>(size); ++i) {
+        if (i > 0) {
+            out << ",\n"sv;
+        }
+        if (i % 5 == 4) {
+            out << "  {\"type\": \"Bus\", \"name\": \"Bus "sv << i << "\", \"stops\": ["sv;
+            for (size_t k = 0; k < 8; ++k) {
+                out << (k > 0 ? ", "sv : ""sv) << "\"Stop "sv << generator() % (i + 1) << '"';
+            }
+            out << "], \"is_roundtrip\": "sv << (i % 2 ? "true"sv : "false"sv) << '}';
+        } else {
+            out << "  {\"type\": \"Stop\", \"name\": \"Stop "sv << i << " \\\"q\\\"\", \"latitude\": "sv << latitude(generator)
+                << ", \"longitude\": "sv << longitude(generator) << ", \"road_distances\": {"sv;
+            for (size_t k = 0; k < 3; ++k) {
+                out << (k > 0 ? ", "sv : ""sv) << "\"Stop "sv << i + k + 1 << "\": "sv << 500 + generator() % 4500;
+            }
+            out << "}}"sv;
+        }
+    }
+    out << "\n ]\n}\n"sv;
+    return out.str();
+}
+
+// the best of several runs
+template <typename Loader>
+double MeasureMbPerSecond(const std::string& input, Loader loader) {
+    constexpr int RUNS = 3;
+    double best = 0;
+    for (int i = 0; i < RUNS; ++i) {
+        const auto start = std::chrono::steady_clock::now();
+        const json::Document document = loader();
+        const std::chrono::duration<double> time = std::chrono::steady_clock::now() - start;
+        if (!document.GetRoot().IsDict()) {
+            std::abort();
+        }
+        best = std::max(best, input.size() / 1e6 / time.count());
+    }
+    return best;
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+    const size_t size_mb = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 32;
+    const std::string input = MakeInput(size_mb << 20);
+    std::cout << "input: "sv << input.size() / 1e6 << " MB"sv << std::endl;
+
+    const double stream_parser = MeasureMbPerSecond(input, [&input] {
+        std::istringstream stream(input);
+        return json_stream_parser::Load(stream);
+    });
+    std::cout << "stream parser:            "sv << stream_parser << " MB/s"sv << std::endl;
+    const double buffer = MeasureMbPerSecond(input, [&input] {
+        return json::Load(std::string_view(input));
+    });
+    std::cout << "Load(std::string_view):   "sv << buffer << " MB/s"sv << std::endl;
+    const double stream = MeasureMbPerSecond(input, [&input] {
+        std::istringstream stream(input);
+        return json::Load(stream);
+    });
+    std::cout << "Load(std::istream&):      "sv << stream << " MB/s"sv << std::endl;
+}
\ No newline at end of file
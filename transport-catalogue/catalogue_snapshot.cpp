@@ -0,0 +1,205 @@
+#include "catalogue_snapshot.h"
+
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+
+namespace transport_catalogue {
+using namespace std::literals;
+
+std::unique_ptr<CatalogueSnapshot> MakeNextSnapshot(const CatalogueSnapshot& current, const CatalogueUpdate& update) {
+	const auto& old_cat = current.tran_cat;
+	TransportCatalogue tran_cat;
+
+	std::unordered_map<std::string_view, const Stop*> updated_stops;
+	for (const auto& stop : update.stops) {
+		updated_stops[stop.name] = &stop;
+	}
+	for (const auto& stop : old_cat.GetDequeStops()) {
+		const auto it = updated_stops.find(stop.name);
+		tran_cat.AddStop({ stop.name, it == updated_stops.end() ? stop.coordinates : it->second->coordinates });
+	}
+	for (const auto& stop : update.stops) {
+		if (!old_cat.GetStopnameToStop().count(stop.name)) {
+			tran_cat.AddStop({ stop.name, stop.coordinates });
+		}
+	}
+
+	for (const auto& [stops, distance] : old_cat.GetDistanceToStops()) {
+		tran_cat.SetLengthInStops(tran_cat.FindStop(stops.first->name), tran_cat.FindStop(stops.second->name), distance);
+	}
+	const auto find_stop = [&tran_cat](std::string_view stopname) {
+		const auto& stopname_to_stop = tran_cat.GetStopnameToStop();
+		const auto it = stopname_to_stop.find(stopname);
+		if (it == stopname_to_stop.end()) {
+			throw std::invalid_argument("The stopname is not found!"s);
+		}
+		return it->second;
+	};
+	for (const auto& distance : update.distances) {
+		tran_cat.SetLengthInStops(find_stop(distance.from), find_stop(distance.to), distance.distance);
+	}
+
+	auto add_bus = [&tran_cat, &find_stop](const std::string& name, const std::vector<std::string_view>& stopnames, TypeRoute type_route) {
+		std::vector<const Stop*> stops;
+		std::unordered_set<std::string_view> unique_stops;
+		stops.reserve(stopnames.size());
+		for (const auto stopname : stopnames) {
+			stops.push_back(find_stop(stopname));
+			unique_stops.insert(stops.back()->name);
+		}
+		tran_cat.AddBus({ std::string(name), std::move(stops), std::move(type_route), std::move(unique_stops) });
+	};
+	std::unordered_map<std::string_view, const BusUpdate*> updated_buses;
+	for (const auto& bus : update.buses) {
+		updated_buses[bus.name] = &bus;
+	}
+	for (const auto& bus : old_cat.GetDequeBusses()) {
+		std::vector<std::string_view> stopnames;
+		TypeRoute type_route = bus.type_route;
+		if (const auto it = updated_buses.find(bus.name); it != updated_buses.end()) {
+			stopnames.assign(it->second->stops.begin(), it->second->stops.end());
+			type_route = it->second->type_route;
+		}
+		else {
+			for (const auto* stop : bus.stops) {
+				stopnames.push_back(stop->name);
+			}
+		}
+		add_bus(bus.name, stopnames, type_route);
+	}
+	for (const auto& bus : update.buses) {
+		if (old_cat.FindBus(bus.name) == nullptr) {
+			add_bus(bus.name, { bus.stops.begin(), bus.stops.end() }, bus.type_route);
+		}
+	}
+	tran_cat.Freeze();
+	tran_cat.BuildStopsIndex();
+
+	auto render_settings = current.map_render.GetRenderSettings();
+	auto route_settings = current.transport_router.GetRouteSettings();
+	auto snapshot = std::make_unique<CatalogueSnapshot>(CatalogueSnapshot{ current.version, std::move(tran_cat),
+		rendering::MapRenderer(std::move(render_settings)), {}, std::make_unique<rendering::MapCache>(), current.base_file });
+	snapshot->transport_router = transport_router::TransportRouter(snapshot->tran_cat, std::move(route_settings));
+	return snapshot;
+}
+
+SnapshotPublisher::ReadGuard::ReadGuard(const SnapshotPublisher* publisher, std::atomic<uint64_t>* slot,
+	const CatalogueSnapshot* snapshot)
+	: publisher_(publisher)
+	, slot_(slot)
+	, snapshot_(snapshot)
+{
+}
+
+SnapshotPublisher::ReadGuard::ReadGuard(ReadGuard&& other) noexcept
+	: publisher_(other.publisher_)
+	, slot_(std::exchange(other.slot_, nullptr))
+	, snapshot_(std::exchange(other.snapshot_, nullptr))
+{
+}
+
+SnapshotPublisher::ReadGuard::~ReadGuard() {
+	if (slot_) {
+		slot_->store(IDLE);
+		publisher_->ReclaimOnRelease();
+	}
+}
+
+const CatalogueSnapshot& SnapshotPublisher::ReadGuard::operator*() const {
+	return *snapshot_;
+}
+
+const CatalogueSnapshot* SnapshotPublisher::ReadGuard::operator->() const {
+	return snapshot_;
+}
+
+SnapshotPublisher::SnapshotPublisher(std::unique_ptr<CatalogueSnapshot>&& snapshot)
+	: current_(snapshot.release())
+{
+}
+
+SnapshotPublisher::~SnapshotPublisher() {
+	delete current_.load();
+}
+
+SnapshotPublisher::ReadGuard SnapshotPublisher::Acquire() const {
+	const size_t start = std::hash<std::thread::id>{}(std::this_thread::get_id()) % MAX_READERS;
+	for (size_t i = 0;; ++i) {
+		auto& slot = slots_[(start + i) % MAX_READERS].epoch;
+		uint64_t expected = IDLE;
+		// the epoch is read before the pointer: a reader holding a retired snapshot
+		// always has an epoch not greater than the epoch of its retirement
+		if (slot.load(std::memory_order_relaxed) == IDLE && slot.compare_exchange_strong(expected, epoch_.load())) {
+			return ReadGuard(this, &slot, current_.load());
+		}
+		if ((i + 1) % MAX_READERS == 0) {
+			std::this_thread::yield();
+		}
+	}
+}
+
+void SnapshotPublisher::Publish(std::unique_ptr<CatalogueSnapshot>&& snapshot) {
+	std::lock_guard guard(writer_mutex_);
+	PublishLocked(std::move(snapshot));
+}
+
+void SnapshotPublisher::PublishLocked(std::unique_ptr<CatalogueSnapshot>&& snapshot) {
+	snapshot->version = current_.load()->version + 1;
+	std::unique_ptr<CatalogueSnapshot> old(current_.exchange(snapshot.release()));
+	const uint64_t retire_epoch = epoch_.fetch_add(1);
+	retired_.emplace_back(retire_epoch, std::move(old));
+	retired_count_.store(retired_.size());
+	Reclaim();
+}
+
+void SnapshotPublisher::Update(const CatalogueUpdate& update) {
+	// only writers retire snapshots, so the current one stays alive under the writer lock
+	std::lock_guard guard(writer_mutex_);
+	PublishLocked(MakeNextSnapshot(*current_.load(), update));
+}
+
+std::optional<SnapshotPublisher::ReadGuard> SnapshotPublisher::TryPublish(uint64_t version,
+	std::unique_ptr<CatalogueSnapshot>& snapshot) {
+	std::lock_guard guard(writer_mutex_);
+	if (current_.load()->version != version) {
+		return std::nullopt;
+	}
+	PublishLocked(std::move(snapshot));
+	// no other writer publishes while the lock is held, so this pins the snapshot just published
+	return Acquire();
+}
+
+uint64_t SnapshotPublisher::GetVersion() const {
+	return Acquire()->version;
+}
+
+size_t SnapshotPublisher::GetRetiredCount() const {
+	return retired_count_.load();
+}
+
+void SnapshotPublisher::Reclaim() const {
+	uint64_t min_active = IDLE;
+	for (const auto& slot : slots_) {
+		min_active = std::min(min_active, slot.epoch.load());
+	}
+	retired_.erase(std::remove_if(retired_.begin(), retired_.end(), [min_active](const auto& retired) {
+		return retired.first < min_active;
+		}), retired_.end());
+	retired_count_.store(retired_.size());
+}
+
+void SnapshotPublisher::ReclaimOnRelease() const {
+	// nearly every release finds nothing retired and touches no lock. Otherwise the reader does not
+	// wait: if a writer holds the lock, the writer or a later release reclaims the snapshot
+	if (retired_count_.load() == 0) {
+		return;
+	}
+	std::unique_lock guard(writer_mutex_, std::try_to_lock);
+	if (guard.owns_lock()) {
+		Reclaim();
+	}
+}
+} //namespace transport_catalogue
\ No newline at end of file
@@ -0,0 +1,118 @@
+#pragma once
+#include "transport_catalogue.h"
+#include "map_renderer.h"
+#include "map_cache.h"
+#include "transport_router.h"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace transport_catalogue {
+
+// Immutable state which answers stat requests. A new version is built aside and published as a whole.
+struct CatalogueSnapshot {
+	uint64_t version = 0;
+	TransportCatalogue tran_cat;
+	rendering::MapRenderer map_render;
+	transport_router::TransportRouter transport_router;
+	// the map is rendered once per version
+	std::unique_ptr<rendering::MapCache> map_cache = std::make_unique<rendering::MapCache>();
+	// the base file the catalogue was loaded from, kept by updates; empty if none
+	std::string base_file;
+};
+
+struct DistanceUpdate {
+	std::string from;
+	std::string to;
+	double distance;
+};
+
+struct BusUpdate {
+	std::string name;
+	std::vector<std::string> stops;
+	TypeRoute type_route;
+};
+
+// Stops and buses with known names replace the old ones, the rest are added.
+// Distances are set over the old ones; every stop they and the buses name has to exist after the update
+struct CatalogueUpdate {
+	std::vector<Stop> stops;
+	std::vector<DistanceUpdate> distances;
+	std::vector<BusUpdate> buses;
+};
+
+// throws std::invalid_argument if the update names an unknown stop
+std::unique_ptr<CatalogueSnapshot> MakeNextSnapshot(const CatalogueSnapshot& current, const CatalogueUpdate& update);
+
+// Read-copy-update holder of the current snapshot.
+// Readers pin the snapshot by publishing the epoch they entered in into a free slot, they never lock.
+// Writers swap the pointer and retire the old snapshot; it is deleted once no reader
+// that could have seen it is still active: by the writer, or by the reader releasing it last.
+class SnapshotPublisher {
+public:
+	class ReadGuard {
+	public:
+		ReadGuard(ReadGuard&& other) noexcept;
+		ReadGuard(const ReadGuard&) = delete;
+		ReadGuard& operator=(const ReadGuard&) = delete;
+		ReadGuard& operator=(ReadGuard&&) = delete;
+		~ReadGuard();
+
+		const CatalogueSnapshot& operator*() const;
+		const CatalogueSnapshot* operator->() const;
+	private:
+		friend class SnapshotPublisher;
+		ReadGuard(const SnapshotPublisher* publisher, std::atomic<uint64_t>* slot, const CatalogueSnapshot* snapshot);
+
+		const SnapshotPublisher* publisher_;
+		std::atomic<uint64_t>* slot_;
+		const CatalogueSnapshot* snapshot_;
+	};
+
+	explicit SnapshotPublisher(std::unique_ptr<CatalogueSnapshot>&& snapshot);
+	SnapshotPublisher(const SnapshotPublisher&) = delete;
+	SnapshotPublisher& operator=(const SnapshotPublisher&) = delete;
+	~SnapshotPublisher();
+
+	ReadGuard Acquire() const;
+	// assigns the next version to the snapshot and makes it current
+	void Publish(std::unique_ptr<CatalogueSnapshot>&& snapshot);
+	// builds the next snapshot from the current one off the read path and publishes it
+	void Update(const CatalogueUpdate& update);
+	// Publishes the snapshot only if the current version is still `version` and returns it pinned;
+	// otherwise returns nullopt and the snapshot stays with the caller
+	std::optional<ReadGuard> TryPublish(uint64_t version, std::unique_ptr<CatalogueSnapshot>& snapshot);
+	uint64_t GetVersion() const;
+	// retired snapshots some reader may still hold
+	size_t GetRetiredCount() const;
+private:
+	static constexpr size_t MAX_READERS = 128;
+	static constexpr uint64_t IDLE = UINT64_MAX;
+
+	struct alignas(64) ReaderSlot {
+		std::atomic<uint64_t> epoch{ IDLE };
+	};
+
+	mutable std::array<ReaderSlot, MAX_READERS> slots_;
+	std::atomic<CatalogueSnapshot*> current_;
+	std::atomic<uint64_t> epoch_{ 0 };
+
+	// readers only try it, to delete retired snapshots on release
+	mutable std::mutex writer_mutex_;
+	mutable std::vector<std::pair<uint64_t, std::unique_ptr<CatalogueSnapshot>>> retired_;
+	// size of retired_, read by readers without the lock
+	mutable std::atomic<size_t> retired_count_{ 0 };
+
+	void PublishLocked(std::unique_ptr<CatalogueSnapshot>&& snapshot);
+	// called with writer_mutex_ held
+	void Reclaim() const;
+	void ReclaimOnRelease() const;
+};
+} //namespace transport_catalogue
@@ -28,6 +28,9 @@ enum class ActionType {
 struct Stop {
 	std::string name;
 	geo::Coordinates coordinates;
+	// filled by TransportCatalogue::AddStop
+	geo::CoordinatesTrig trig = {};
+	size_t id = 0;
 };
 
 struct Bus {
@@ -37,6 +40,8 @@ struct Bus {
 	std::vector<const Stop*> stops;
 	TypeRoute type_route;
 	std::unordered_set<std::string_view> unique_stops;
+	// filled by TransportCatalogue::AddBus
+	size_t id = 0;
 };
 
 struct BusInfo {
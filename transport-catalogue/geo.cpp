@@ -1,10 +1,25 @@
 #define _USE_MATH_DEFINES
 #include "geo.h"
 
+#include <algorithm>
 #include <cmath>
 
 namespace geo {
 
+namespace {
+const double DR = M_PI / 180.;
+const double EARTH_RADIUS = 6371000;
+
+// the same expression as in ComputeDistance(Coordinates, Coordinates), without the latitude trigonometry
+inline double ComputeDistanceTrig(double from_sin_lat, double from_cos_lat, double from_lng,
+    double to_sin_lat, double to_cos_lat, double to_lng) {
+    using namespace std;
+    return acos(from_sin_lat * to_sin_lat
+        + from_cos_lat * to_cos_lat * cos(abs(from_lng - to_lng) * DR))
+        * EARTH_RADIUS;
+}
+} // namespace
+
 double ComputeDistance(Coordinates from, Coordinates to) {
     using namespace std;
     if (from == to) {
@@ -16,4 +31,71 @@ double ComputeDistance(Coordinates from, Coordinates to) {
         * 6371000;
 }
 
+CoordinatesTrig PrecomputeTrig(Coordinates coordinates) {
+    return { std::sin(coordinates.lat * DR), std::cos(coordinates.lat * DR), coordinates.lng };
+}
+
+double ComputeDistance(const CoordinatesTrig& from, const CoordinatesTrig& to) {
+    if (from == to) {
+        return 0;
+    }
+    return ComputeDistanceTrig(from.sin_lat, from.cos_lat, from.lng, to.sin_lat, to.cos_lat, to.lng);
+}
+
+void CoordinatesBatch::Reserve(size_t size) {
+    sin_lat.reserve(size);
+    cos_lat.reserve(size);
+    lng.reserve(size);
+}
+
+void CoordinatesBatch::Add(const CoordinatesTrig& coordinates) {
+    sin_lat.push_back(coordinates.sin_lat);
+    cos_lat.push_back(coordinates.cos_lat);
+    lng.push_back(coordinates.lng);
+}
+
+size_t CoordinatesBatch::Size() const {
+    return lng.size();
+}
+
+void ComputeDistances(const CoordinatesTrig& from, const double* sin_lat, const double* cos_lat, const double* lng,
+    size_t count, double* distances) {
+    // Three passes over the output, the terms are those of ComputeDistanceTrig in its order. The dot products
+    // have no calls and no comparisons and vectorise; the cos and acos calls stay scalar, and equal points,
+    // whose products may round past 1, are caught in the acos pass
+    const double from_sin_lat = from.sin_lat;
+    const double from_cos_lat = from.cos_lat;
+    const double from_lng = from.lng;
+    for (size_t i = 0; i < count; ++i) {
+        distances[i] = std::cos(std::abs(from_lng - lng[i]) * DR);
+    }
+    for (size_t i = 0; i < count; ++i) {
+        distances[i] = from_sin_lat * sin_lat[i] + from_cos_lat * cos_lat[i] * distances[i];
+    }
+    for (size_t i = 0; i < count; ++i) {
+        const bool same = from_sin_lat == sin_lat[i] && from_cos_lat == cos_lat[i] && from_lng == lng[i];
+        distances[i] = same ? 0. : std::acos(distances[i]) * EARTH_RADIUS;
+    }
+}
+
+void ComputeDistances(const CoordinatesTrig& from, const CoordinatesBatch& to, std::vector<double>& distances) {
+    distances.resize(to.Size());
+    ComputeDistances(from, to.sin_lat.data(), to.cos_lat.data(), to.lng.data(), to.Size(), distances.data());
+}
+
+void ComputeDistances(const CoordinatesBatch& from, const CoordinatesBatch& to, std::vector<double>& distances) {
+    const size_t count = std::min(from.Size(), to.Size());
+    distances.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        distances[i] = std::cos(std::abs(from.lng[i] - to.lng[i]) * DR);
+    }
+    for (size_t i = 0; i < count; ++i) {
+        distances[i] = from.sin_lat[i] * to.sin_lat[i] + from.cos_lat[i] * to.cos_lat[i] * distances[i];
+    }
+    for (size_t i = 0; i < count; ++i) {
+        const bool same = from.sin_lat[i] == to.sin_lat[i] && from.cos_lat[i] == to.cos_lat[i] && from.lng[i] == to.lng[i];
+        distances[i] = same ? 0. : std::acos(distances[i]) * EARTH_RADIUS;
+    }
+}
+
 }  // namespace geo
\ No newline at end of file
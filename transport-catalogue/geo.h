@@ -1,6 +1,7 @@
 #pragma once
 
 #include <iostream>
+#include <vector>
 
 namespace geo {
 struct Coordinates {
@@ -20,4 +21,37 @@ inline std::ostream& operator<<(std::ostream& os, const Coordinates& coordinates
 }
 
 double ComputeDistance(Coordinates from, Coordinates to);
+
+// Coordinates with the latitude terms of ComputeDistance evaluated once.
+// Distances computed from them are bit-identical to ComputeDistance.
+struct CoordinatesTrig {
+    double sin_lat = 0;
+    double cos_lat = 1;
+    double lng = 0;
+    bool operator==(const CoordinatesTrig& other) const {
+        return sin_lat == other.sin_lat && cos_lat == other.cos_lat && lng == other.lng;
+    }
+};
+
+CoordinatesTrig PrecomputeTrig(Coordinates coordinates);
+double ComputeDistance(const CoordinatesTrig& from, const CoordinatesTrig& to);
+
+// Structure-of-arrays storage for batch distance computation
+struct CoordinatesBatch {
+    std::vector<double> sin_lat;
+    std::vector<double> cos_lat;
+    std::vector<double> lng;
+
+    void Reserve(size_t size);
+    void Add(const CoordinatesTrig& coordinates);
+    size_t Size() const;
+};
+
+// distances[i] = distance from `from` to the i-th point of the arrays, which `distances` must not overlap.
+// The dot products of all points are computed in one vectorisable pass, the acos calls in the next one
+void ComputeDistances(const CoordinatesTrig& from, const double* sin_lat, const double* cos_lat, const double* lng,
+    size_t count, double* distances);
+void ComputeDistances(const CoordinatesTrig& from, const CoordinatesBatch& to, std::vector<double>& distances);
+// distances[i] = distance from the i-th point of `from` to the i-th point of `to`
+void ComputeDistances(const CoordinatesBatch& from, const CoordinatesBatch& to, std::vector<double>& distances);
 }
\ No newline at end of file
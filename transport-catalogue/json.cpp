@@ -1,45 +1,50 @@
 #include "json.h"
+#include "json_input.h"
 
-#include <iterator>
+#include <cctype>
+#include <charconv>
 
 namespace json {
 
 namespace {
 using namespace std::literals;
 
-Node LoadNode(std::istream& input);
-Node LoadString(std::istream& input);
+using detail::Input;
+using detail::IsAlpha;
+using detail::IsDigit;
+using detail::IsSpace;
+using detail::LoadLiteral;
+using detail::STRUCTURAL_INDEX_MIN_SIZE;
 
-std::string LoadLiteral(std::istream& input) {
-    std::string s;
-    while (std::isalpha(input.peek())) {
-        s.push_back(static_cast<char>(input.get()));
-    }
-    return s;
-}
+Node LoadNode(Input& input);
+Node LoadString(Input& input);
 
-Node LoadArray(std::istream& input) {
+Node LoadArray(Input& input) {
     std::vector<Node> result;
 
-    for (char c; input >> c && c != ']';) {
+    char c;
+    bool has_char;
+    while ((has_char = input.ReadNonSpace(c)) && c != ']') {
         if (c != ',') {
-            input.putback(c);
+            input.Putback();
         }
         result.push_back(LoadNode(input));
     }
-    if (!input) {
+    if (!has_char) {
         throw ParsingError("Array parsing error"s);
     }
     return Node(std::move(result));
 }
 
-Node LoadDict(std::istream& input) {
+Node LoadDict(Input& input) {
     Dict dict;
 
-    for (char c; input >> c && c != '}';) {
+    char c;
+    bool has_char;
+    while ((has_char = input.ReadNonSpace(c)) && c != '}') {
         if (c == '"') {
             std::string key = LoadString(input).AsString();
-            if (input >> c && c == ':') {
+            if (input.ReadNonSpace(c) && c == ':') {
                 if (dict.find(key) != dict.end()) {
                     throw ParsingError("Duplicate key '"s + key + "' have been found");
                 }
@@ -51,17 +56,21 @@ Node LoadDict(std::istream& input) {
             throw ParsingError(R"(',' is expected but ')"s + c + "' has been found"s);
         }
     }
-    if (!input) {
+    if (!has_char) {
         throw ParsingError("Dictionary parsing error"s);
     }
     return Node(std::move(dict));
 }
 
-Node LoadString(std::istream& input) {
-    auto it = std::istreambuf_iterator<char>(input);
-    auto end = std::istreambuf_iterator<char>();
+Node LoadString(Input& input) {
+    const char* it = input.Pos();
+    const char* end = input.End();
     std::string s;
     while (true) {
+        // plain characters are copied in runs
+        const char* run = it;
+        it = input.FindStringSpecial(it);
+        s.append(run, it);
         if (it == end) {
             throw ParsingError("String parsing error");
         }
@@ -74,125 +83,45 @@ Node LoadString(std::istream& input) {
             if (it == end) {
                 throw ParsingError("String parsing error");
             }
-            const char escaped_char = *(it);
-            switch (escaped_char) {
-                case 'n':
-                    s.push_back('\n');
-                    break;
-                case 't':
-                    s.push_back('\t');
-                    break;
-                case 'r':
-                    s.push_back('\r');
-                    break;
-                case '"':
-                    s.push_back('"');
-                    break;
-                case '\\':
-                    s.push_back('\\');
-                    break;
-                default:
-                    throw ParsingError("Unrecognized escape sequence \\"s + escaped_char);
-            }
-        } else if (ch == '\n' || ch == '\r') {
-            throw ParsingError("Unexpected end of line"s);
+            s.push_back(detail::Unescape(*it));
         } else {
-            s.push_back(ch);
+            throw ParsingError("Unexpected end of line"s);
         }
         ++it;
     }
+    input.Advance(it);
 
     return Node(std::move(s));
 }
 
-Node LoadBool(std::istream& input) {
+Node LoadBool(Input& input) {
     const auto s = LoadLiteral(input);
     if (s == "true"sv) {
         return Node{true};
     } else if (s == "false"sv) {
         return Node{false};
     } else {
-        throw ParsingError("Failed to parse '"s + s + "' as bool"s);
+        throw ParsingError("Failed to parse '"s + std::string(s) + "' as bool"s);
     }
 }
 
-Node LoadNull(std::istream& input) {
+Node LoadNull(Input& input) {
     if (auto literal = LoadLiteral(input); literal == "null"sv) {
         return Node{nullptr};
     } else {
-        throw ParsingError("Failed to parse '"s + literal + "' as null"s);
+        throw ParsingError("Failed to parse '"s + std::string(literal) + "' as null"s);
     }
 }
 
-Node LoadNumber(std::istream& input) {
-    std::string parsed_num;
-
-    // Считывает в parsed_num очередной символ из input
-    auto read_char = [&parsed_num, &input] {
-        parsed_num += static_cast<char>(input.get());
-        if (!input) {
-            throw ParsingError("Failed to read number from stream"s);
-        }
-    };
-
-    // Считывает одну или более цифр в parsed_num из input
-    auto read_digits = [&input, read_char] {
-        if (!std::isdigit(input.peek())) {
-            throw ParsingError("A digit is expected"s);
-        }
-        while (std::isdigit(input.peek())) {
-            read_char();
-        }
-    };
-
-    if (input.peek() == '-') {
-        read_char();
-    }
-    // Парсим целую часть числа
-    if (input.peek() == '0') {
-        read_char();
-        // После 0 в JSON не могут идти другие цифры
-    } else {
-        read_digits();
-    }
-
-    bool is_int = true;
-    // Парсим дробную часть числа
-    if (input.peek() == '.') {
-        read_char();
-        read_digits();
-        is_int = false;
-    }
-
-    // Парсим экспоненциальную часть числа
-    if (int ch = input.peek(); ch == 'e' || ch == 'E') {
-        read_char();
-        if (ch = input.peek(); ch == '+' || ch == '-') {
-            read_char();
-        }
-        read_digits();
-        is_int = false;
-    }
-
-    try {
-        if (is_int) {
-            // Сначала пробуем преобразовать строку в int
-            try {
-                return std::stoi(parsed_num);
-            } catch (...) {
-                // В случае неудачи, например, при переполнении
-                // код ниже попробует преобразовать строку в double
-            }
-        }
-        return std::stod(parsed_num);
-    } catch (...) {
-        throw ParsingError("Failed to convert "s + parsed_num + " to number"s);
-    }
+Node LoadNumber(Input& input) {
+    return std::visit([](auto value) {
+        return Node(value);
+    }, detail::ParseNumber(input));
 }
 
-Node LoadNode(std::istream& input) {
+Node LoadNode(Input& input) {
     char c;
-    if (!(input >> c)) {
+    if (!input.ReadNonSpace(c)) {
         throw ParsingError("Unexpected EOF"s);
     }
     switch (c) {
@@ -211,13 +140,13 @@ Node LoadNode(std::istream& input) {
             // литералов true либо false
             [[fallthrough]];
         case 'f':
-            input.putback(c);
+            input.Putback();
             return LoadBool(input);
         case 'n':
-            input.putback(c);
+            input.Putback();
             return LoadNull(input);
         default:
-            input.putback(c);
+            input.Putback();
             return LoadNumber(input);
     }
 }
@@ -226,6 +155,7 @@ struct PrintContext {
     std::ostream& out;
     int indent_step = 4;
     int indent = 0;
+    number_format::Mode number_mode = number_format::Mode::SHORTEST;
 
     void PrintIndent() const {
         for (int i = 0; i < indent; ++i) {
@@ -234,7 +164,7 @@ struct PrintContext {
     }
 
     PrintContext Indented() const {
-        return {out, indent_step, indent_step + indent};
+        return {out, indent_step, indent_step + indent, number_mode};
     }
 };
 
@@ -269,6 +199,16 @@ void PrintString(const std::string& value, std::ostream& out) {
     out.put('"');
 }
 
+template <>
+void PrintValue<int>(const int& value, const PrintContext& ctx) {
+    number_format::Write(ctx.out, value);
+}
+
+template <>
+void PrintValue<double>(const double& value, const PrintContext& ctx) {
+    number_format::Write(ctx.out, value, ctx.number_mode);
+}
+
 template <>
 void PrintValue<std::string>(const std::string& value, const PrintContext& ctx) {
     PrintString(value, ctx.out);
@@ -340,12 +280,455 @@ void PrintNode(const Node& node, const PrintContext& ctx) {
 
 }  // namespace
 
+Document Load(std::string_view input) {
+    if (input.size() < STRUCTURAL_INDEX_MIN_SIZE) {
+        Input buffer(input.data(), input.data() + input.size());
+        return Document{LoadNode(buffer)};
+    }
+    const detail::StructuralIndex index(input.data(), input.size());
+    Input buffer(input.data(), input.data() + input.size(), &index);
+    return Document{LoadNode(buffer)};
+}
+
 Document Load(std::istream& input) {
-    return Document{LoadNode(input)};
+    return Load(std::string_view(detail::ReadAll(input)));
+}
+
+namespace detail {
+
+std::string ReadAll(std::istream& input) {
+    std::string buffer;
+    char chunk[1 << 16];
+    while (input.read(chunk, sizeof(chunk)) || input.gcount() > 0) {
+        buffer.append(chunk, static_cast<size_t>(input.gcount()));
+    }
+    return buffer;
+}
+
+char Unescape(char escaped_char) {
+    switch (escaped_char) {
+        case 'n':
+            return '\n';
+        case 't':
+            return '\t';
+        case 'r':
+            return '\r';
+        case '"':
+            return '"';
+        case '\\':
+            return '\\';
+        default:
+            throw ParsingError("Unrecognized escape sequence \\"s + escaped_char);
+    }
+}
+
+std::variant<int, double> ParseNumber(Input& input) {
+    const char* begin = input.Pos();
+
+    // Считывает одну или более цифр из input
+    auto read_digits = [&input] {
+        if (!IsDigit(input.Peek())) {
+            throw ParsingError("A digit is expected"s);
+        }
+        while (IsDigit(input.Peek())) {
+            input.Get();
+        }
+    };
+
+    if (input.Peek() == '-') {
+        input.Get();
+    }
+    // Парсим целую часть числа
+    if (input.Peek() == '0') {
+        input.Get();
+        // После 0 в JSON не могут идти другие цифры
+    } else {
+        read_digits();
+    }
+
+    bool is_int = true;
+    // Парсим дробную часть числа
+    if (input.Peek() == '.') {
+        input.Get();
+        read_digits();
+        is_int = false;
+    }
+
+    // Парсим экспоненциальную часть числа
+    if (int ch = input.Peek(); ch == 'e' || ch == 'E') {
+        input.Get();
+        if (ch = input.Peek(); ch == '+' || ch == '-') {
+            input.Get();
+        }
+        read_digits();
+        is_int = false;
+    }
+
+    // the grammar is already checked, from_chars only converts
+    const char* end = input.Pos();
+    if (is_int) {
+        // Сначала пробуем преобразовать строку в int
+        int value;
+        if (const auto result = std::from_chars(begin, end, value); result.ec == std::errc()) {
+            return value;
+        }
+        // В случае неудачи, например, при переполнении
+        // код ниже попробует преобразовать строку в double
+    }
+    double value;
+    if (const auto result = std::from_chars(begin, end, value); result.ec != std::errc()) {
+        throw ParsingError("Failed to convert "s + std::string(begin, end) + " to number"s);
+    }
+    return value;
+}
+
+}  // namespace detail
+
+// ---------- Reader ------------------
+
+Reader::Reader(std::string_view input)
+    : data_(input) {
+}
+
+Reader::Reader(std::istream& input)
+    : stream_(&input) {
+}
+
+Event Reader::Next() {
+    if (peeked_) {
+        const Event event = *peeked_;
+        peeked_.reset();
+        return event;
+    }
+    return Advance();
+}
+
+Event Reader::Peek() {
+    if (!peeked_) {
+        peeked_ = Advance();
+    }
+    return *peeked_;
+}
+
+const std::string& Reader::GetKey() const {
+    return key_;
+}
+
+const Node& Reader::GetValue() const {
+    return value_;
+}
+
+Node Reader::ReadValue() {
+    switch (Next()) {
+        case Event::VALUE:
+            return std::move(value_);
+        case Event::START_ARRAY: {
+            Array result;
+            while (Peek() != Event::END_ARRAY) {
+                result.push_back(ReadValue());
+            }
+            Next();
+            return Node(std::move(result));
+        }
+        case Event::START_DICT: {
+            Dict result;
+            while (Next() == Event::KEY) {
+                std::string key = std::move(key_);
+                result.emplace(std::move(key), ReadValue());
+            }
+            return Node(std::move(result));
+        }
+        default:
+            throw ParsingError("A value is expected"s);
+    }
+}
+
+void Reader::SkipValue() {
+    size_t depth = 0;
+    do {
+        switch (Next()) {
+            case Event::START_ARRAY:
+            case Event::START_DICT:
+                ++depth;
+                break;
+            case Event::END_ARRAY:
+            case Event::END_DICT:
+                --depth;
+                break;
+            case Event::END_DOCUMENT:
+                throw ParsingError("A value is expected"s);
+            default:
+                break;
+        }
+    } while (depth != 0);
+}
+
+bool Reader::ReadRawValue(std::string& text) {
+    if (peeked_) {
+        throw std::logic_error("ReadRawValue is called after Peek"s);
+    }
+    if (stack_.empty()) {
+        if (root_read_) {
+            throw ParsingError("A value is expected"s);
+        }
+        root_read_ = true;
+    } else if (!stack_.back().is_dict) {
+        char c;
+        if (!ReadNonSpace(c)) {
+            throw ParsingError("Array parsing error"s);
+        }
+        if (c == ']') {
+            PopContext();
+            return false;
+        }
+        if (c != ',') {
+            --pos_;
+        }
+    } else if (stack_.back().expect_value) {
+        stack_.back().expect_value = false;
+    } else {
+        throw std::logic_error("ReadRawValue is called where a key is expected"s);
+    }
+    char c;
+    if (!ReadNonSpace(c)) {
+        throw ParsingError("Unexpected EOF"s);
+    }
+    --pos_;
+
+    size_t begin = pos_;
+    size_t depth = 0;
+    bool in_string = false;
+    bool escaped = false;
+    while (true) {
+        if (pos_ == data_.size()) {
+            text.append(data_.data() + begin, pos_ - begin);
+            if (!Refill()) {
+                // скаляр может закончиться вместе со входом
+                if (depth == 0 && !in_string) {
+                    return true;
+                }
+                throw ParsingError("Unexpected EOF"s);
+            }
+            begin = pos_;
+            continue;
+        }
+        const char ch = data_[pos_];
+        if (in_string) {
+            if (escaped) {
+                escaped = false;
+            } else if (ch == '\\') {
+                escaped = true;
+            } else if (ch == '"') {
+                in_string = false;
+                if (depth == 0) {
+                    ++pos_;
+                    break;
+                }
+            }
+        } else if (ch == '"') {
+            in_string = true;
+        } else if (ch == '[' || ch == '{') {
+            ++depth;
+        } else if (ch == ']' || ch == '}') {
+            if (depth == 0) {
+                break;
+            }
+            if (--depth == 0) {
+                ++pos_;
+                break;
+            }
+        } else if (depth == 0 && (ch == ',' || IsSpace(ch))) {
+            break;
+        }
+        ++pos_;
+    }
+    text.append(data_.data() + begin, pos_ - begin);
+    return true;
+}
+
+bool Reader::Refill() {
+    if (stream_ == nullptr || !*stream_) {
+        return false;
+    }
+    // the consumed part is dropped, so the buffer holds at most one chunk and the current token
+    buffer_.erase(0, pos_);
+    pos_ = 0;
+    const size_t size = buffer_.size();
+    buffer_.resize(size + CHUNK_SIZE);
+    stream_->read(buffer_.data() + size, CHUNK_SIZE);
+    buffer_.resize(size + static_cast<size_t>(stream_->gcount()));
+    data_ = buffer_;
+    return buffer_.size() > size;
+}
+
+bool Reader::ReadNonSpace(char& c) {
+    while (true) {
+        while (pos_ < data_.size() && IsSpace(data_[pos_])) {
+            ++pos_;
+        }
+        if (pos_ < data_.size()) {
+            c = data_[pos_++];
+            return true;
+        }
+        if (!Refill()) {
+            return false;
+        }
+    }
+}
+
+void Reader::EnsureToken(bool is_string) {
+    size_t end = pos_;
+    while (true) {
+        while (end < data_.size()) {
+            const char c = data_[end];
+            if (is_string) {
+                if (c == '\\') {
+                    ++end;
+                } else if (c == '"' || c == '\n' || c == '\r') {
+                    return;
+                }
+            } else if (!IsAlpha(static_cast<unsigned char>(c)) && !IsDigit(static_cast<unsigned char>(c))
+                && c != '.' && c != '+' && c != '-') {
+                return;
+            }
+            ++end;
+        }
+        const size_t offset = end - pos_;
+        if (!Refill()) {
+            return;
+        }
+        end = pos_ + offset;
+    }
+}
+
+Event Reader::ReadValueEvent() {
+    char c;
+    if (!ReadNonSpace(c)) {
+        throw ParsingError("Unexpected EOF"s);
+    }
+    switch (c) {
+        case '[':
+            PushContext(false);
+            return Event::START_ARRAY;
+        case '{':
+            PushContext(true);
+            return Event::START_DICT;
+        case '"':
+            EnsureToken(true);
+            value_ = ParseToken(LoadString);
+            return Event::VALUE;
+        case 't':
+            [[fallthrough]];
+        case 'f':
+            --pos_;
+            EnsureToken(false);
+            value_ = ParseToken(LoadBool);
+            return Event::VALUE;
+        case 'n':
+            --pos_;
+            EnsureToken(false);
+            value_ = ParseToken(LoadNull);
+            return Event::VALUE;
+        default:
+            --pos_;
+            EnsureToken(false);
+            value_ = ParseToken(LoadNumber);
+            return Event::VALUE;
+    }
+}
+
+template <typename TokenLoader>
+Node Reader::ParseToken(TokenLoader loader) {
+    Input input(data_.data() + pos_, data_.data() + data_.size());
+    Node result = loader(input);
+    pos_ = input.Pos() - data_.data();
+    return result;
+}
+
+void Reader::PushContext(bool is_dict) {
+    stack_.push_back({ is_dict, false, keys_size_ });
+}
+
+void Reader::PopContext() {
+    keys_size_ = stack_.back().keys_begin;
+    stack_.pop_back();
+}
+
+bool Reader::InsertKey(Context& context) {
+    if (!context.keys.empty()) {
+        return context.keys.insert(key_).second;
+    }
+    for (size_t i = context.keys_begin; i < keys_size_; ++i) {
+        if (keys_[i] == key_) {
+            return false;
+        }
+    }
+    if (keys_size_ - context.keys_begin == LINEAR_KEYS) {
+        context.keys.insert(keys_.begin() + context.keys_begin, keys_.begin() + keys_size_);
+        keys_size_ = context.keys_begin;
+        return context.keys.insert(key_).second;
+    }
+    if (keys_size_ == keys_.size()) {
+        keys_.push_back(key_);
+    } else {
+        keys_[keys_size_] = key_;
+    }
+    ++keys_size_;
+    return true;
+}
+
+// Mirrors the grammar accepted by Load: commas between array items may be omitted
+Event Reader::Advance() {
+    if (stack_.empty()) {
+        if (root_read_) {
+            return Event::END_DOCUMENT;
+        }
+        root_read_ = true;
+        return ReadValueEvent();
+    }
+    Context& context = stack_.back();
+    char c;
+    if (!context.is_dict) {
+        if (!ReadNonSpace(c)) {
+            throw ParsingError("Array parsing error"s);
+        }
+        if (c == ']') {
+            PopContext();
+            return Event::END_ARRAY;
+        }
+        if (c != ',') {
+            --pos_;
+        }
+        return ReadValueEvent();
+    }
+    if (context.expect_value) {
+        context.expect_value = false;
+        return ReadValueEvent();
+    }
+    while (ReadNonSpace(c)) {
+        if (c == '}') {
+            PopContext();
+            return Event::END_DICT;
+        } else if (c == '"') {
+            EnsureToken(true);
+            key_ = ParseToken(LoadString).AsString();
+            if (ReadNonSpace(c) && c == ':') {
+                if (!InsertKey(context)) {
+                    throw ParsingError("Duplicate key '"s + key_ + "' have been found");
+                }
+                context.expect_value = true;
+                return Event::KEY;
+            }
+            throw ParsingError(": is expected but '"s + c + "' has been found"s);
+        } else if (c != ',') {
+            throw ParsingError(R"(',' is expected but ')"s + c + "' has been found"s);
+        }
+    }
+    throw ParsingError("Dictionary parsing error"s);
 }
 
-void Print(const Document& doc, std::ostream& output) {
-    PrintNode(doc.GetRoot(), PrintContext{output});
+void Print(const Document& doc, std::ostream& output, number_format::Mode number_mode) {
+    PrintNode(doc.GetRoot(), PrintContext{output, 4, 0, number_mode});
 }
 
 }  // namespace json
\ No newline at end of file
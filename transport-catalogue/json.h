@@ -1,8 +1,13 @@
 #pragma once
 
+#include "number_format.h"
+
 #include <iostream>
 #include <map>
+#include <optional>
+#include <set>
 #include <string>
+#include <string_view>
 #include <variant>
 #include <vector>
 
@@ -139,8 +144,91 @@ inline bool operator!=(const Document& lhs, const Document& rhs) {
     return !(lhs == rhs);
 }
 
+// Parses the document from a contiguous buffer
+Document Load(std::string_view input);
+// Reads the whole stream into memory and parses it as a buffer
 Document Load(std::istream& input);
 
-void Print(const Document& doc, std::ostream& output);
+// Doubles are printed in the shortest form that reads back exactly;
+// STREAM_COMPATIBLE reproduces the output of std::ostream << double
+void Print(const Document& doc, std::ostream& output,
+    number_format::Mode number_mode = number_format::Mode::SHORTEST);
+
+enum class Event {
+    START_DICT,
+    END_DICT,
+    START_ARRAY,
+    END_ARRAY,
+    KEY,
+    VALUE,
+    END_DOCUMENT
+};
+
+/*
+    * Потоковый (pull) читатель JSON. Выдаёт события по одному, не строя документ целиком.
+    * При чтении из потока в памяти держится только текущий фрагмент входа,
+    * поэтому большие массивы можно обрабатывать поэлементно через ReadValue
+    */
+class Reader {
+public:
+    explicit Reader(std::string_view input);
+    explicit Reader(std::istream& input);
+
+    Event Next();
+    // Возвращает следующее событие, не извлекая его
+    Event Peek();
+
+    // Ключ последнего события KEY
+    const std::string& GetKey() const;
+    // Значение последнего события VALUE (строка, число, bool или null)
+    const Node& GetValue() const;
+
+    // Читает очередное значение целиком, включая вложенные массивы и словари
+    Node ReadValue();
+    void SkipValue();
+    // Дописывает текст очередного значения в text, не разбирая его: сопоставляются только
+    // скобки и кавычки, остальное проверит json::Load этого текста.
+    // Внутри массива возвращает false, если массив закончился. Нельзя вызывать после Peek
+    bool ReadRawValue(std::string& text);
+
+private:
+    static constexpr size_t CHUNK_SIZE = 1 << 16;
+
+    // Словари до LINEAR_KEYS ключей проверяются на дубликаты линейным поиском по keys_
+    static constexpr size_t LINEAR_KEYS = 16;
+
+    struct Context {
+        bool is_dict;
+        bool expect_value = false;
+        size_t keys_begin = 0;
+        std::set<std::string> keys = {};
+    };
+
+    std::istream* stream_ = nullptr;
+    std::string buffer_;
+    std::string_view data_;
+    size_t pos_ = 0;
+
+    std::vector<Context> stack_;
+    // Ключи открытых словарей; строки не освобождаются при закрытии словаря и переиспользуются
+    std::vector<std::string> keys_;
+    size_t keys_size_ = 0;
+    bool root_read_ = false;
+    std::optional<Event> peeked_;
+    std::string key_;
+    Node value_;
+
+    Event Advance();
+    Event ReadValueEvent();
+    void PushContext(bool is_dict);
+    void PopContext();
+    bool InsertKey(Context& context);
+    bool Refill();
+    bool ReadNonSpace(char& c);
+    // Дочитывает поток, пока текущая строка или литерал не окажутся в буфере целиком
+    void EnsureToken(bool is_string);
+    template <typename TokenLoader>
+    Node ParseToken(TokenLoader loader);
+};
 
 }  // namespace json
\ No newline at end of file
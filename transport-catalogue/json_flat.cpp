@@ -0,0 +1,329 @@
+#include "json_flat.h"
+#include "json_input.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <unordered_set>
+
+namespace json {
+namespace flat {
+
+using namespace std::literals;
+
+namespace {
+// Словари до LINEAR_KEYS ключей проверяются на дубликаты линейным поиском
+const size_t LINEAR_KEYS = 16;
+
+uint32_t CheckSize(size_t size) {
+    if (size > std::numeric_limits<uint32_t>::max()) {
+        throw ParsingError("Value is too large for a flat document"s);
+    }
+    return static_cast<uint32_t>(size);
+}
+}  // namespace
+
+const Node& Array::at(size_t index) const {
+    if (index >= size_) {
+        throw std::out_of_range("Array index is out of range"s);
+    }
+    return begin_[index];
+}
+
+const Node* Dict::Find(std::string_view key) const {
+    size_t left = 0;
+    size_t right = size_;
+    while (left < right) {
+        const size_t middle = left + (right - left) / 2;
+        if (begin_[2 * middle].AsString() < key) {
+            left = middle + 1;
+        } else {
+            right = middle;
+        }
+    }
+    if (left < size_ && begin_[2 * left].AsString() == key) {
+        return &begin_[2 * left + 1];
+    }
+    return nullptr;
+}
+
+const Node& Dict::at(std::string_view key) const {
+    if (const Node* value = Find(key)) {
+        return *value;
+    }
+    throw std::out_of_range("Key '"s + std::string(key) + "' is not found"s);
+}
+
+json::Node Node::ToNode() const {
+    switch (type_) {
+        case Type::BOOL:
+            return bool_;
+        case Type::INT:
+            return int_;
+        case Type::DOUBLE:
+            return double_;
+        case Type::STRING:
+            return std::string(AsString());
+        case Type::ARRAY: {
+            json::Array result;
+            result.reserve(size_);
+            for (const Node& item : AsArray()) {
+                result.push_back(item.ToNode());
+            }
+            return result;
+        }
+        case Type::DICT: {
+            json::Dict result;
+            for (const auto& [key, value] : AsDict()) {
+                result.emplace_hint(result.end(), std::string(key), value.ToNode());
+            }
+            return result;
+        }
+        default:
+            return nullptr;
+    }
+}
+
+// Грамматика и сообщения об ошибках совпадают с json::Load.
+// Потомки открытых массивов и словарей копятся в стеках items_ и members_
+// и переносятся в nodes_ одним отрезком, когда контейнер закрывается
+class Parser {
+public:
+    static Document Parse(std::string&& input) {
+        Document document;
+        document.buffer_ = std::make_unique<std::string>(std::move(input));
+        char* data = document.buffer_->data();
+        const size_t size = document.buffer_->size();
+        if (size < detail::STRUCTURAL_INDEX_MIN_SIZE) {
+            Parser parser(data, size, nullptr);
+            parser.Finish(document);
+        } else {
+            const detail::StructuralIndex index(data, size);
+            Parser parser(data, size, &index);
+            parser.Finish(document);
+        }
+        return document;
+    }
+
+private:
+    detail::Input input_;
+    // начало входа; строки с escape-последовательностями переписываются на месте
+    char* data_;
+    std::vector<Node> nodes_;
+    std::vector<Node> items_;
+    std::vector<std::pair<Node, Node>> members_;
+
+    Parser(char* data, size_t size, const detail::StructuralIndex* index)
+        : input_(data, data + size, index)
+        , data_(data) {
+    }
+
+    void Finish(Document& document) {
+        document.root_ = ParseNode();
+        // позиции потомков становятся указателями, когда массив узлов больше не растёт
+        auto link = [this](Node& node) {
+            if (node.type_ == Node::Type::ARRAY || node.type_ == Node::Type::DICT) {
+                node.children_ = nodes_.data() + node.index_;
+            }
+        };
+        for (Node& node : nodes_) {
+            link(node);
+        }
+        link(document.root_);
+        document.nodes_ = std::move(nodes_);
+    }
+
+    char* Mutable(const char* pos) const {
+        return data_ + (pos - input_.Begin());
+    }
+
+    Node ParseNode() {
+        char c;
+        if (!input_.ReadNonSpace(c)) {
+            throw ParsingError("Unexpected EOF"s);
+        }
+        switch (c) {
+            case '[':
+                return ParseArray();
+            case '{':
+                return ParseDict();
+            case '"':
+                return ParseString();
+            case 't':
+                [[fallthrough]];
+            case 'f':
+                input_.Putback();
+                return ParseBool();
+            case 'n':
+                input_.Putback();
+                return ParseNull();
+            default:
+                input_.Putback();
+                return ParseNumber();
+        }
+    }
+
+    Node ParseArray() {
+        const size_t begin = items_.size();
+        char c;
+        bool has_char;
+        while ((has_char = input_.ReadNonSpace(c)) && c != ']') {
+            if (c != ',') {
+                input_.Putback();
+            }
+            const Node item = ParseNode();
+            items_.push_back(item);
+        }
+        if (!has_char) {
+            throw ParsingError("Array parsing error"s);
+        }
+        Node result;
+        result.type_ = Node::Type::ARRAY;
+        result.size_ = CheckSize(items_.size() - begin);
+        result.index_ = nodes_.size();
+        nodes_.insert(nodes_.end(), items_.begin() + begin, items_.end());
+        items_.resize(begin);
+        return result;
+    }
+
+    bool IsDuplicateKey(size_t begin, std::string_view key, std::unordered_set<std::string_view>& large_keys) const {
+        const size_t count = members_.size() - begin;
+        if (count < LINEAR_KEYS) {
+            for (size_t i = begin; i < members_.size(); ++i) {
+                if (members_[i].first.AsString() == key) {
+                    return true;
+                }
+            }
+            return false;
+        }
+        if (count == LINEAR_KEYS) {
+            for (size_t i = begin; i < members_.size(); ++i) {
+                large_keys.insert(members_[i].first.AsString());
+            }
+        }
+        return !large_keys.insert(key).second;
+    }
+
+    Node ParseDict() {
+        const size_t begin = members_.size();
+        std::unordered_set<std::string_view> large_keys;
+        char c;
+        bool has_char;
+        while ((has_char = input_.ReadNonSpace(c)) && c != '}') {
+            if (c == '"') {
+                const Node key = ParseString();
+                if (input_.ReadNonSpace(c) && c == ':') {
+                    if (IsDuplicateKey(begin, key.AsString(), large_keys)) {
+                        throw ParsingError("Duplicate key '"s + std::string(key.AsString()) + "' have been found");
+                    }
+                    const Node value = ParseNode();
+                    members_.emplace_back(key, value);
+                } else {
+                    throw ParsingError(": is expected but '"s + c + "' has been found"s);
+                }
+            } else if (c != ',') {
+                throw ParsingError(R"(',' is expected but ')"s + c + "' has been found"s);
+            }
+        }
+        if (!has_char) {
+            throw ParsingError("Dictionary parsing error"s);
+        }
+        std::sort(members_.begin() + begin, members_.end(), [](const auto& lhs, const auto& rhs) {
+            return lhs.first.AsString() < rhs.first.AsString();
+        });
+        Node result;
+        result.type_ = Node::Type::DICT;
+        result.size_ = CheckSize(members_.size() - begin);
+        result.index_ = nodes_.size();
+        for (size_t i = begin; i < members_.size(); ++i) {
+            nodes_.push_back(members_[i].first);
+            nodes_.push_back(members_[i].second);
+        }
+        members_.resize(begin);
+        return result;
+    }
+
+    // Строка без escape-последовательностей остаётся как есть, иначе она сдвигается
+    // на месте: раскрытая последовательность всегда короче исходной
+    Node ParseString() {
+        const char* begin = input_.Pos();
+        const char* end = input_.End();
+        const char* it = input_.FindStringSpecial(begin);
+        char* out = Mutable(it);
+        while (true) {
+            if (it == end) {
+                throw ParsingError("String parsing error");
+            }
+            const char ch = *it;
+            if (ch == '"') {
+                ++it;
+                break;
+            } else if (ch == '\\') {
+                ++it;
+                if (it == end) {
+                    throw ParsingError("String parsing error");
+                }
+                *out++ = detail::Unescape(*it);
+            } else {
+                throw ParsingError("Unexpected end of line"s);
+            }
+            ++it;
+            const char* run = it;
+            it = input_.FindStringSpecial(it);
+            std::memmove(out, run, it - run);
+            out += it - run;
+        }
+        input_.Advance(it);
+
+        Node result;
+        result.type_ = Node::Type::STRING;
+        result.size_ = CheckSize(out - Mutable(begin));
+        result.chars_ = begin;
+        return result;
+    }
+
+    Node ParseBool() {
+        const auto s = detail::LoadLiteral(input_);
+        Node result;
+        result.type_ = Node::Type::BOOL;
+        if (s == "true"sv) {
+            result.bool_ = true;
+        } else if (s == "false"sv) {
+            result.bool_ = false;
+        } else {
+            throw ParsingError("Failed to parse '"s + std::string(s) + "' as bool"s);
+        }
+        return result;
+    }
+
+    Node ParseNull() {
+        if (auto literal = detail::LoadLiteral(input_); literal != "null"sv) {
+            throw ParsingError("Failed to parse '"s + std::string(literal) + "' as null"s);
+        }
+        return Node();
+    }
+
+    Node ParseNumber() {
+        const auto number = detail::ParseNumber(input_);
+        Node result;
+        if (std::holds_alternative<int>(number)) {
+            result.type_ = Node::Type::INT;
+            result.int_ = std::get<int>(number);
+        } else {
+            result.type_ = Node::Type::DOUBLE;
+            result.double_ = std::get<double>(number);
+        }
+        return result;
+    }
+};
+
+Document Load(std::string input) {
+    return Parser::Parse(std::move(input));
+}
+
+Document Load(std::istream& input) {
+    return Load(detail::ReadAll(input));
+}
+
+}  // namespace flat
+}  // namespace json
\ No newline at end of file
@@ -0,0 +1,253 @@
+#pragma once
+
+#include "json.h"
+
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace json {
+namespace flat {
+
+class Array;
+class Dict;
+class Parser;
+
+/*
+    * Неизменяемое представление документа: все узлы лежат в одном массиве,
+    * строки ссылаются на буфер входа, в котором escape-последовательности раскрыты на месте.
+    * Массив и словарь - это непрерывные отрезки узлов; словарь хранит пары (ключ, значение),
+    * отсортированные по ключу, как в json::Dict
+    */
+class Node final {
+public:
+    Node() = default;
+
+    bool IsNull() const {
+        return type_ == Type::NUL;
+    }
+
+    bool IsBool() const {
+        return type_ == Type::BOOL;
+    }
+    bool AsBool() const {
+        using namespace std::literals;
+        if (!IsBool()) {
+            throw std::logic_error("Not a bool"s);
+        }
+        return bool_;
+    }
+
+    bool IsInt() const {
+        return type_ == Type::INT;
+    }
+    int AsInt() const {
+        using namespace std::literals;
+        if (!IsInt()) {
+            throw std::logic_error("Not an int"s);
+        }
+        return int_;
+    }
+
+    bool IsPureDouble() const {
+        return type_ == Type::DOUBLE;
+    }
+    bool IsDouble() const {
+        return IsInt() || IsPureDouble();
+    }
+    double AsDouble() const {
+        using namespace std::literals;
+        if (!IsDouble()) {
+            throw std::logic_error("Not a double"s);
+        }
+        return IsPureDouble() ? double_ : int_;
+    }
+
+    bool IsString() const {
+        return type_ == Type::STRING;
+    }
+    std::string_view AsString() const {
+        using namespace std::literals;
+        if (!IsString()) {
+            throw std::logic_error("Not a string"s);
+        }
+        return std::string_view(chars_, size_);
+    }
+
+    bool IsArray() const {
+        return type_ == Type::ARRAY;
+    }
+    Array AsArray() const;
+
+    bool IsDict() const {
+        return type_ == Type::DICT;
+    }
+    Dict AsDict() const;
+
+    // Глубокая копия в обычный json::Node
+    json::Node ToNode() const;
+
+private:
+    friend class Parser;
+
+    enum class Type : uint8_t {
+        NUL,
+        BOOL,
+        INT,
+        DOUBLE,
+        STRING,
+        ARRAY,
+        DICT
+    };
+
+    Type type_ = Type::NUL;
+    // длина строки, число элементов массива или пар словаря
+    uint32_t size_ = 0;
+    union {
+        bool bool_;
+        int int_;
+        double double_;
+        const char* chars_;
+        const Node* children_;
+        // позиция первого потомка, пока массив узлов ещё растёт
+        size_t index_ = 0;
+    };
+};
+
+class Array {
+public:
+    using const_iterator = const Node*;
+
+    Array(const Node* begin, size_t size)
+        : begin_(begin)
+        , size_(size) {
+    }
+
+    const_iterator begin() const {
+        return begin_;
+    }
+    const_iterator end() const {
+        return begin_ + size_;
+    }
+    size_t size() const {
+        return size_;
+    }
+    bool empty() const {
+        return size_ == 0;
+    }
+    const Node& operator[](size_t index) const {
+        return begin_[index];
+    }
+    const Node& at(size_t index) const;
+
+private:
+    const Node* begin_;
+    size_t size_;
+};
+
+class Dict {
+public:
+    using value_type = std::pair<std::string_view, const Node&>;
+
+    // Ключи и значения чередуются: key0, value0, key1, value1, ...
+    class const_iterator {
+    public:
+        explicit const_iterator(const Node* pos)
+            : pos_(pos) {
+        }
+        value_type operator*() const;
+        const_iterator& operator++() {
+            pos_ += 2;
+            return *this;
+        }
+        bool operator==(const const_iterator& other) const {
+            return pos_ == other.pos_;
+        }
+        bool operator!=(const const_iterator& other) const {
+            return pos_ != other.pos_;
+        }
+
+    private:
+        const Node* pos_;
+    };
+
+    Dict(const Node* begin, size_t size)
+        : begin_(begin)
+        , size_(size) {
+    }
+
+    const_iterator begin() const {
+        return const_iterator(begin_);
+    }
+    const_iterator end() const {
+        return const_iterator(begin_ + 2 * size_);
+    }
+    size_t size() const {
+        return size_;
+    }
+    bool empty() const {
+        return size_ == 0;
+    }
+    // Двоичный поиск по ключу; nullptr, если ключа нет
+    const Node* Find(std::string_view key) const;
+    size_t count(std::string_view key) const {
+        return Find(key) != nullptr;
+    }
+    // Как std::map::at: std::out_of_range, если ключа нет
+    const Node& at(std::string_view key) const;
+
+private:
+    const Node* begin_;
+    size_t size_;
+};
+
+inline Array Node::AsArray() const {
+    using namespace std::literals;
+    if (!IsArray()) {
+        throw std::logic_error("Not an array"s);
+    }
+    return Array(children_, size_);
+}
+
+inline Dict Node::AsDict() const {
+    using namespace std::literals;
+    if (!IsDict()) {
+        throw std::logic_error("Not a dict"s);
+    }
+    return Dict(children_, size_);
+}
+
+inline Dict::value_type Dict::const_iterator::operator*() const {
+    return { pos_->AsString(), pos_[1] };
+}
+
+class Document {
+public:
+    Document(Document&&) = default;
+    Document& operator=(Document&&) = default;
+
+    const Node& GetRoot() const {
+        return root_;
+    }
+
+private:
+    friend class Parser;
+    Document() = default;
+
+    // std::string is kept behind a pointer: a short string would move its characters with it
+    std::unique_ptr<std::string> buffer_;
+    std::vector<Node> nodes_;
+    Node root_;
+};
+
+// Takes ownership of the input: strings of the document point into it
+Document Load(std::string input);
+Document Load(std::istream& input);
+
+}  // namespace flat
+}  // namespace json
\ No newline at end of file
@@ -0,0 +1,127 @@
+#pragma once
+
+#include "json.h"
+#include "json_scan.h"
+
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <variant>
+
+namespace json {
+namespace detail {
+
+// Inputs smaller than this are scanned byte by byte, the index would not pay off
+inline constexpr size_t STRUCTURAL_INDEX_MIN_SIZE = 1 << 12;
+
+// The rest of the stream, read in large chunks
+std::string ReadAll(std::istream& input);
+
+inline bool IsSpace(char c) {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\v' || c == '\f';
+}
+
+inline bool IsAlpha(int c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+inline bool IsDigit(int c) {
+    return c >= '0' && c <= '9';
+}
+
+// Position in a contiguous input buffer. Mirrors the few std::istream operations
+// the parser needs, without virtual calls or locale lookups per character.
+// With a structural index whitespace and string contents are skipped by bit search.
+class Input {
+public:
+    Input(const char* begin, const char* end, const StructuralIndex* index = nullptr)
+        : begin_(begin)
+        , pos_(begin)
+        , end_(end)
+        , index_(index) {
+    }
+
+    // like input >> c: skips whitespace and reads one character
+    bool ReadNonSpace(char& c) {
+        if (index_) {
+            pos_ = begin_ + index_->NextNonSpace(pos_ - begin_);
+        } else {
+            while (pos_ != end_ && IsSpace(*pos_)) {
+                ++pos_;
+            }
+        }
+        if (pos_ == end_) {
+            return false;
+        }
+        c = *pos_++;
+        return true;
+    }
+
+    int Peek() const {
+        return pos_ == end_ ? EOF : static_cast<unsigned char>(*pos_);
+    }
+
+    char Get() {
+        return *pos_++;
+    }
+
+    void Putback() {
+        --pos_;
+    }
+
+    bool IsEnd() const {
+        return pos_ == end_;
+    }
+
+    const char* Begin() const {
+        return begin_;
+    }
+
+    const char* Pos() const {
+        return pos_;
+    }
+
+    const char* End() const {
+        return end_;
+    }
+
+    void Advance(const char* pos) {
+        pos_ = pos;
+    }
+
+    // first '"', '\\', '\n' or '\r' at or after pos
+    const char* FindStringSpecial(const char* pos) const {
+        if (index_) {
+            return begin_ + index_->NextStringSpecial(pos - begin_);
+        }
+        while (pos != end_ && *pos != '"' && *pos != '\\' && *pos != '\n' && *pos != '\r') {
+            ++pos;
+        }
+        return pos;
+    }
+
+private:
+    const char* begin_;
+    const char* pos_;
+    const char* end_;
+    const StructuralIndex* index_;
+};
+
+// Run of latin letters at the input position: true, false or null in a valid document
+inline std::string_view LoadLiteral(Input& input) {
+    const char* begin = input.Pos();
+    while (IsAlpha(input.Peek())) {
+        input.Get();
+    }
+    return std::string_view(begin, input.Pos() - begin);
+}
+
+// Character denoted by the escape sequence \escaped_char
+char Unescape(char escaped_char);
+
+// Number at the input position; int if it is integral and fits into int
+std::variant<int, double> ParseNumber(Input& input);
+
+}  // namespace detail
+}  // namespace json
\ No newline at end of file
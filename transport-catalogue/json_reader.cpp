@@ -1,10 +1,12 @@
 #include "json_reader.h"
-#include "json_builder.h"
+#include "request_pool.h"
 
+#include <algorithm>
 #include <iostream>
 #include <sstream>
 #include <utility>
-#include <sstream>
+#include <optional>
+#include <string_view>
 
 namespace transport_catalogue {
 namespace handle_iformation {
@@ -59,48 +61,178 @@ Color ParseColor(const Node& color_node) {
 	return color;
 }
 
-TransportCatalogue MakeBase::MakeTransportCatalogue() const {
-	TransportCatalogue tran_cat;
-	const auto& base_requests = document_.GetRoot().AsDict().at("base_requests"s).AsArray();
-	std::vector<const Node*> bus_requests;
-	bus_requests.reserve(base_requests.size());
-	std::unordered_map < const Stop*, Dict> stop_to_lengths_to_stops;
+void AddBaseRequest(CatalogueBuilder& builder, const json::Dict& request_as_map) {
+	if (request_as_map.at("type"s).AsString() == "Stop"s) {
+		const auto& name = request_as_map.at("name"s).AsString();
+		const auto lat = request_as_map.at("latitude"s).AsDouble();
+		const auto lng = request_as_map.at("longitude"s).AsDouble();
+		for (const auto& [stop_to, length] : request_as_map.at("road_distances"s).AsDict()) {
+			builder.AddDistance(name, stop_to, length.AsDouble());
+		}
+		builder.AddStop(name, { lat, lng });
+	}
+	else if (request_as_map.at("type"s).AsString() == "Bus"s) {
+		const auto& stopnames = request_as_map.at("stops"s).AsArray();
+		std::vector<CatalogueBuilder::StopId> stops;
+		stops.reserve(stopnames.size());
+		for (const auto& stopname : stopnames) {
+			stops.push_back(builder.InternStop(stopname.AsString()));
+		}
+		auto type_route = request_as_map.at("is_roundtrip"s).AsBool() ? TypeRoute::circle : TypeRoute::line;
+		builder.AddBus(std::string(request_as_map.at("name"s).AsString()), std::move(stops), type_route);
+	}
+	else {
+		throw std::invalid_argument("Input contains not correct command!"s);
+	}
+}
+
+CatalogueUpdate ReadCatalogueUpdate(const json::flat::Array& base_requests) {
+	CatalogueUpdate update;
 	for (const auto& request : base_requests) {
-		const auto& request_as_map = request.AsDict();
-		if (request_as_map.at("type"s).AsString() == "Stop"s) {
-			const auto& name = request_as_map.at("name"s).AsString();
-			const auto lat = request_as_map.at("latitude"s).AsDouble();
-			const auto lng = request_as_map.at("longitude"s).AsDouble();
-			tran_cat.AddStop({ std::move(name), {lat, lng} });
-			stop_to_lengths_to_stops[tran_cat.FindStop(name)] = request_as_map.at("road_distances"s).AsDict();
+		const auto request_as_map = request.AsDict();
+		const std::string_view type = request_as_map.at("type"sv).AsString();
+		if (type == "Stop"sv) {
+			const std::string name(request_as_map.at("name"sv).AsString());
+			for (const auto& [stop_to, length] : request_as_map.at("road_distances"sv).AsDict()) {
+				update.distances.push_back({ name, std::string(stop_to), length.AsDouble() });
+			}
+			update.stops.push_back({ name, { request_as_map.at("latitude"sv).AsDouble(), request_as_map.at("longitude"sv).AsDouble() } });
 		}
-		else if (request_as_map.at("type"s).AsString() == "Bus"s) {
-			bus_requests.push_back(&request);
+		else if (type == "Bus"sv) {
+			BusUpdate bus{ std::string(request_as_map.at("name"sv).AsString()), {},
+				request_as_map.at("is_roundtrip"sv).AsBool() ? TypeRoute::circle : TypeRoute::line };
+			for (const auto& stopname : request_as_map.at("stops"sv).AsArray()) {
+				bus.stops.emplace_back(stopname.AsString());
+			}
+			update.buses.push_back(std::move(bus));
 		}
 		else {
 			throw std::invalid_argument("Input contains not correct command!"s);
 		}
 	}
+	return update;
+}
+
+namespace {
+// Fields of one base request; "type" may come after the fields it defines
+struct BaseRequestRecord {
+	std::string type;
+	std::optional<std::string> name;
+	std::optional<double> latitude;
+	std::optional<double> longitude;
+	std::optional<bool> is_roundtrip;
+	bool has_road_distances = false;
+	bool has_stops = false;
+	std::vector<std::pair<CatalogueBuilder::StopId, double>> road_distances;
+	std::vector<CatalogueBuilder::StopId> stops;
+
+	void Clear() {
+		type.clear();
+		name.reset();
+		latitude.reset();
+		longitude.reset();
+		is_roundtrip.reset();
+		has_road_distances = false;
+		has_stops = false;
+		road_distances.clear();
+		stops.clear();
+	}
+};
+
+const Node& ReadScalar(json::Reader& reader) {
+	if (reader.Next() != Event::VALUE) {
+		throw std::invalid_argument("Base request field must be a string, a number or a bool"s);
+	}
+	return reader.GetValue();
+}
 
-	for (const auto& [stop_from, stop_length] : stop_to_lengths_to_stops) {
-		for (const auto& [stop_to, length] : stop_length) {
-			tran_cat.SetLengthInStops(stop_from, tran_cat.FindStop(stop_to), length.AsDouble());
+void ExpectEvent(json::Reader& reader, Event event, const char* message) {
+	if (reader.Next() != event) {
+		throw std::invalid_argument(message);
+	}
+}
+
+// Decodes one element of base_requests from the reader events. Stop names are interned
+// as soon as they are read, so nothing but the record fields is allocated per request.
+void ReadBaseRequest(json::Reader& reader, CatalogueBuilder& builder, BaseRequestRecord& record) {
+	ExpectEvent(reader, Event::START_DICT, "Base request must be a dict");
+	record.Clear();
+	while (reader.Next() == Event::KEY) {
+		const std::string_view key = reader.GetKey();
+		if (key == "type"sv) {
+			record.type = ReadScalar(reader).AsString();
+		}
+		else if (key == "name"sv) {
+			record.name = ReadScalar(reader).AsString();
+		}
+		else if (key == "latitude"sv) {
+			record.latitude = ReadScalar(reader).AsDouble();
+		}
+		else if (key == "longitude"sv) {
+			record.longitude = ReadScalar(reader).AsDouble();
+		}
+		else if (key == "is_roundtrip"sv) {
+			record.is_roundtrip = ReadScalar(reader).AsBool();
+		}
+		else if (key == "road_distances"sv) {
+			ExpectEvent(reader, Event::START_DICT, "road_distances must be a dict");
+			while (reader.Next() == Event::KEY) {
+				const auto to = builder.InternStop(reader.GetKey());
+				record.road_distances.emplace_back(to, ReadScalar(reader).AsDouble());
+			}
+			record.has_road_distances = true;
+		}
+		else if (key == "stops"sv) {
+			ExpectEvent(reader, Event::START_ARRAY, "stops must be an array");
+			while (reader.Peek() != Event::END_ARRAY) {
+				record.stops.push_back(builder.InternStop(ReadScalar(reader).AsString()));
+			}
+			reader.Next();
+			record.has_stops = true;
+		}
+		else {
+			reader.SkipValue();
 		}
 	}
 
-	for (const auto& request : bus_requests) {
-		const auto& request_as_map = request->AsDict();
-		auto& busname = request_as_map.at("name"s).AsString();
-		std::vector<const Stop*> stops;
-		std::unordered_set<std::string_view> unique_stops;
-		for (const auto& stopname : request_as_map.at("stops"s).AsArray()) {
-			stops.push_back(tran_cat.FindStop(stopname.AsString()));
-			unique_stops.insert(stops.back()->name);
+	if (record.type == "Stop"sv) {
+		if (!record.name || !record.latitude || !record.longitude || !record.has_road_distances) {
+			throw std::invalid_argument("Stop request must contain name, latitude, longitude and road_distances"s);
 		}
-		auto type_route = request_as_map.at("is_roundtrip"s).AsBool() ? TypeRoute::circle : TypeRoute::line;
-		tran_cat.AddBus({ std::move(busname), std::move(stops), std::move(type_route), std::move(unique_stops) });
+		const auto id = builder.InternStop(*record.name);
+		for (const auto& [to, length] : record.road_distances) {
+			builder.AddDistance(id, to, length);
+		}
+		builder.AddStop(id, { *record.latitude, *record.longitude });
+	}
+	else if (record.type == "Bus"sv) {
+		if (!record.name || !record.has_stops || !record.is_roundtrip) {
+			throw std::invalid_argument("Bus request must contain name, stops and is_roundtrip"s);
+		}
+		auto type_route = *record.is_roundtrip ? TypeRoute::circle : TypeRoute::line;
+		builder.AddBus(std::move(*record.name), std::move(record.stops), type_route);
+	}
+	else {
+		throw std::invalid_argument("Input contains not correct command!"s);
 	}
-	return tran_cat;
+}
+// the value of the key or nullptr, for both kinds of requests
+const json::Node* FindValue(const json::Dict& dict, const std::string& key) {
+	const auto it = dict.find(key);
+	return it == dict.end() ? nullptr : &it->second;
+}
+
+const json::flat::Node* FindValue(const json::flat::Dict& dict, std::string_view key) {
+	return dict.Find(key);
+}
+} //namespace
+
+TransportCatalogue MakeBase::MakeTransportCatalogue() const {
+	CatalogueBuilder builder;
+	for (const auto& request : document_.GetRoot().AsDict().at("base_requests"s).AsArray()) {
+		AddBaseRequest(builder, request.AsDict());
+	}
+	return builder.Build();
 }
 
 rendering::MapRenderer MakeBase::MakeMapRenderer() const {
@@ -124,6 +256,9 @@ rendering::MapRenderer MakeBase::MakeMapRenderer() const {
 		bus_label_offset, render_settings.at("stop_label_font_size"s).AsInt(),
 		stop_label_offset, underlayer_color,
 		render_settings.at("underlayer_width"s).AsDouble(), color_palette };
+	if (const auto it = render_settings.find("polyline_tolerance"s); it != render_settings.end()) {
+		settings.polyline_tolerance = it->second.AsDouble();
+	}
 	return rendering::MapRenderer(std::move(settings));
 }
 
@@ -140,109 +275,392 @@ MakeBase::MakeBase(const json::Document& document)
 {
 }
 
+StreamMakeBase::StreamMakeBase(std::istream& input)
+	: settings_(nullptr)
+{
+	json::Reader reader(input);
+	if (reader.Next() != Event::START_DICT) {
+		throw ParsingError("make_base input must be a dict"s);
+	}
+	Dict settings;
+	while (reader.Next() == Event::KEY) {
+		std::string key = reader.GetKey();
+		if (key == "base_requests"s) {
+			if (reader.Next() != Event::START_ARRAY) {
+				throw ParsingError("base_requests must be an array"s);
+			}
+			BaseRequestRecord record;
+			while (reader.Peek() != Event::END_ARRAY) {
+				ReadBaseRequest(reader, builder_, record);
+			}
+			reader.Next();
+		}
+		else {
+			settings.emplace(std::move(key), reader.ReadValue());
+		}
+	}
+	settings_ = json::Document(std::move(settings));
+}
+
+TransportCatalogue StreamMakeBase::MakeTransportCatalogue() {
+	return builder_.Build();
+}
+
+rendering::MapRenderer StreamMakeBase::MakeMapRenderer() const {
+	return MakeBase(settings_).MakeMapRenderer();
+}
+
+transport_router::TransportRouter StreamMakeBase::MakeTransportRouter(const TransportCatalogue& tran_cat) const {
+	return MakeBase(settings_).MakeTransportRouter(tran_cat);
+}
+
+std::string StreamMakeBase::GetSerializationFile() const {
+	return settings_.GetRoot().AsDict().at("serialization_settings"s).AsDict().at("file"s).AsString();
+}
+
 ProcessRequests::ProcessRequests(const json::Document& document
-	, TransportCatalogue* tran_cat
-	, rendering::MapRenderer* map_render
-	, transport_router::TransportRouter* transport_router) 
-	: document_(document)
+	, const TransportCatalogue* tran_cat
+	, const rendering::MapRenderer* map_render
+	, const transport_router::TransportRouter* transport_router) 
+	: document_(&document)
 	, p_tran_cat_(tran_cat)
 	, p_map_render_(map_render)
 	, p_transport_router_(transport_router)
 {
 }
 
-json::Node ProcessRequests::HandleBusRequest(const json::Dict& request_as_map) const {
-	auto bus_info = p_tran_cat_->GetInfromBus(request_as_map.at("name"s).AsString());
-	Node node;
-	if (!bus_info) {
-		return Builder{}.StartDict().Key("request_id"s).Value(request_as_map.at("id"s).AsInt()).Key("error_message"s).Value("not found"s).EndDict().Build();
+ProcessRequests::ProcessRequests(const TransportCatalogue* tran_cat
+	, const rendering::MapRenderer* map_render
+	, const transport_router::TransportRouter* transport_router)
+	: document_(nullptr)
+	, p_tran_cat_(tran_cat)
+	, p_map_render_(map_render)
+	, p_transport_router_(transport_router)
+{
+}
+
+// Keys are written in alphabetical order, as json::Print orders a json::Dict
+void ProcessRequests::HandleBusRequest(const StatRequest& request, json::Writer& writer) const {
+	if (request.object_id == StatRequest::NOT_FOUND) {
+		writer.StartDict().Key("error_message"sv).Value("not found"sv).Key("request_id"sv).Value(request.id).EndDict();
+		return;
+	}
+	const BusInfo bus_info = p_tran_cat_->GetInfromBus(*p_tran_cat_->GetBus(request.object_id));
+	writer.StartDict().Key("curvature"sv).Value(bus_info.curvature)
+		.Key("request_id"sv).Value(request.id)
+		.Key("route_length"sv).Value(bus_info.length)
+		.Key("stop_count"sv).Value(static_cast<int>(bus_info.amount_stops))
+		.Key("unique_stop_count"sv).Value(static_cast<int>(bus_info.amount_unique_stops))
+		.EndDict();
+}
+
+void ProcessRequests::HandleStopRequest(const StatRequest& request, json::Writer& writer) const {
+	if (request.object_id == StatRequest::NOT_FOUND) {
+		writer.StartDict().Key("error_message"sv).Value("not found"sv).Key("request_id"sv).Value(request.id).EndDict();
+		return;
+	}
+	writer.StartDict().Key("buses"sv).StartArray();
+	for (const auto& busname : p_tran_cat_->GetStopBusses(*p_tran_cat_->GetStop(request.object_id))) {
+		writer.Value(busname);
+	}
+	writer.EndArray().Key("request_id"sv).Value(request.id).EndDict();
+}
+
+void ProcessRequests::HandleMapRequest(const StatRequest& request, json::Writer& writer) const {
+	writer.StartDict().Key("map"sv);
+	if (request.tile) {
+		writer.EscapedValue(*map_cache_->GetTile(*p_map_render_, *p_tran_cat_, *request.tile, number_mode_));
+	}
+	else if (request.viewport) {
+		writer.EscapedValue(map_cache_->GetViewport(*p_map_render_, *p_tran_cat_, *request.viewport, number_mode_));
+	}
+	else if (request.bus_ids) {
+		writer.EscapedValue(map_cache_->GetBusesMap(*p_map_render_, *p_tran_cat_, *request.bus_ids, number_mode_));
 	}
 	else {
-		return Builder{}.StartDict().Key("request_id"s).Value(request_as_map.at("id"s).AsInt())
-			.Key("curvature"s).Value(bus_info->curvature)
-			.Key("route_length"s).Value(bus_info->length)
-			.Key("stop_count"s).Value(static_cast<int>(bus_info->amount_stops))
-			.Key("unique_stop_count"s).Value(static_cast<int>(bus_info->amount_unique_stops))
-			.EndDict().Build();
+		writer.EscapedValue(map_cache_->Get(*p_map_render_, *p_tran_cat_, number_mode_));
 	}
+	writer.Key("request_id"sv).Value(request.id).EndDict();
 }
 
-json::Node ProcessRequests::HandleStopRequest(const json::Dict& request_as_map) const {
-	Node node;
-	try {
-		auto busses = p_tran_cat_->GetListBusses(request_as_map.at("name"s).AsString());
-		Array names;
-		names.reserve(busses.size());
-		for (const auto& sv : busses) {
-			names.push_back(std::string(sv));
+void ProcessRequests::HandleRouteRequest(const StatRequest& request, json::Writer& writer) const {
+	std::optional<FoundedRoute> founded_route;
+	if (request.vertex_from != StatRequest::NOT_FOUND && request.vertex_to != StatRequest::NOT_FOUND) {
+		founded_route = p_transport_router_->FindRoute(request.vertex_from, request.vertex_to);
+	}
+	if (!founded_route) {
+		writer.StartDict().Key("error_message"sv).Value("not found"sv).Key("request_id"sv).Value(request.id).EndDict();
+		return;
+	}
+	writer.StartDict().Key("items"sv).StartArray();
+	for (const auto& item : founded_route->elements) {
+		if (item->type == ActionType::WAIT) {
+			writer.StartDict().Key("stop_name"sv).Value(item->name)
+				.Key("time"sv).Value(item->time).Key("type"sv).Value("Wait"sv).EndDict();
+		}
+		else {
+			writer.StartDict().Key("bus"sv).Value(item->name).Key("span_count"sv).Value(item->span_count.value())
+				.Key("time"sv).Value(item->time).Key("type"sv).Value("Bus"sv).EndDict();
 		}
-		return Builder{}.StartDict().Key("request_id"s).Value(request_as_map.at("id"s).AsInt()).Key("buses"s).Value(std::move(names)).EndDict().Build();
 	}
-	catch (std::string error) {
-		return Builder{}.StartDict().Key("request_id"s).Value(request_as_map.at("id"s).AsInt()).Key("error_message"s).Value(error).EndDict().Build();
+	writer.EndArray().Key("request_id"sv).Value(request.id).Key("total_time"sv).Value(founded_route->total_time).EndDict();
+}
+
+// the cached map with the found route on top of it
+void ProcessRequests::HandleRouteMapRequest(const StatRequest& request, json::Writer& writer) const {
+	std::optional<FoundedRoute> founded_route;
+	if (request.vertex_from != StatRequest::NOT_FOUND && request.vertex_to != StatRequest::NOT_FOUND) {
+		founded_route = p_transport_router_->FindRoute(request.vertex_from, request.vertex_to);
 	}
+	if (!founded_route) {
+		writer.StartDict().Key("error_message"sv).Value("not found"sv).Key("request_id"sv).Value(request.id).EndDict();
+		return;
+	}
+	const auto [head, tail] = map_cache_->GetRouteMap(*p_map_render_, *p_tran_cat_, *founded_route, request.object_id, number_mode_);
+	writer.StartDict().Key("map"sv).EscapedValue(head, tail).Key("request_id"sv).Value(request.id).EndDict();
 }
 
-json::Node ProcessRequests::HandleMapRequest(const json::Dict& request_as_map) {
-	std::ostringstream render;
-	RenderRoute(render);
-	return Builder{}.StartDict().Key("request_id"s).Value(request_as_map.at("id"s).AsInt()).Key("map"s).Value(render.str()).EndDict().Build();
+void WriteNearbyStopsAnswer(int request_id, const std::vector<NearbyStop>& nearby_stops, json::Writer& writer) {
+	writer.StartDict().Key("request_id"sv).Value(request_id).Key("stops"sv).StartArray();
+	for (const auto& [stop, distance] : nearby_stops) {
+		writer.StartDict().Key("distance"sv).Value(distance).Key("name"sv).Value(stop->name).EndDict();
+	}
+	writer.EndArray().EndDict();
 }
 
-json::Node ProcessRequests::HandleRouteRequest(const json::Dict& request_as_map) const {
-	auto& stop_from = request_as_map.at("from"s).AsString();
-	auto& stop_to = request_as_map.at("to"s).AsString();
-	const auto& founded_route = p_transport_router_->FindRoute(stop_from, stop_to);
-	if (!founded_route) {
-		return Builder{}.StartDict().Key("request_id"s).Value(request_as_map.at("id"s).AsInt()).Key("error_message"s).Value("not found"s).EndDict().Build();
+void ProcessRequests::HandleNearbyRequest(const StatRequest& request, json::Writer& writer) const {
+	WriteNearbyStopsAnswer(request.id, p_tran_cat_->GetStopsNearby(request.center, request.radius), writer);
+}
+
+void ProcessRequests::HandleNearestStopsRequest(const StatRequest& request, json::Writer& writer) const {
+	WriteNearbyStopsAnswer(request.id, p_tran_cat_->GetNearestStops(request.center, request.count), writer);
+}
+
+template <typename RequestDict>
+StatRequest ProcessRequests::DecodeRequestFrom(const RequestDict& request_as_map) const {
+	StatRequest request;
+	request.id = request_as_map.at("id"s).AsInt();
+	const std::string_view type = request_as_map.at("type"s).AsString();
+	if (type == "Bus"sv) {
+		request.type = StatRequestType::BUS;
+		if (const Bus* bus = p_tran_cat_->FindBus(request_as_map.at("name"s).AsString())) {
+			request.object_id = static_cast<uint32_t>(bus->id);
+		}
 	}
-	else {
-		Builder builder = Builder{};
-		auto items = builder.StartDict().Key("items"s).StartArray();
-		for (const auto& item : founded_route->elements) {
-			if (item->type == ActionType::WAIT) {
-				items.StartDict().Key("type"s).Value("Wait"s).Key("stop_name"s).Value(std::string(item->name))
-					.Key("time"s).Value(item->time).EndDict();
+	else if (type == "Stop"sv) {
+		request.type = StatRequestType::STOP;
+		const auto& stopname_to_stop = p_tran_cat_->GetStopnameToStop();
+		if (const auto it = stopname_to_stop.find(request_as_map.at("name"s).AsString()); it != stopname_to_stop.end()) {
+			request.object_id = static_cast<uint32_t>(it->second->id);
+		}
+	}
+	else if (type == "Map"sv) {
+		request.type = StatRequestType::MAP;
+		if (const auto* bbox_node = FindValue(request_as_map, "bbox"s)) {
+			const auto& bbox = bbox_node->AsArray();
+			if (bbox.size() != 4) {
+				throw std::invalid_argument("Map bbox must be [min_x, min_y, max_x, max_y]!"s);
+			}
+			request.viewport = rendering::Viewport{ bbox[0].AsDouble(), bbox[1].AsDouble(), bbox[2].AsDouble(), bbox[3].AsDouble() };
+			if (!(request.viewport->min_x < request.viewport->max_x && request.viewport->min_y < request.viewport->max_y)) {
+				throw std::invalid_argument("Map bbox is empty!"s);
+			}
+		}
+		else if (const auto* tile_node = FindValue(request_as_map, "tile"s)) {
+			const auto& tile = tile_node->AsDict();
+			const int z = tile.at("z"s).AsInt();
+			const int x = tile.at("x"s).AsInt();
+			const int y = tile.at("y"s).AsInt();
+			if (z < 0 || z > static_cast<int>(rendering::MapTile::MAX_ZOOM) || x < 0 || y < 0 || x >> z != 0 || y >> z != 0) {
+				throw std::invalid_argument("Map tile is out of the map!"s);
+			}
+			request.tile = rendering::MapTile{ static_cast<uint32_t>(z), static_cast<uint32_t>(x), static_cast<uint32_t>(y) };
+		}
+		else if (const auto* buses_node = FindValue(request_as_map, "buses"s)) {
+			// unknown names are skipped, every bus is drawn once
+			std::vector<const Bus*> buses;
+			for (const auto& busname : buses_node->AsArray()) {
+				if (const Bus* bus = p_tran_cat_->FindBus(busname.AsString())) {
+					buses.push_back(bus);
+				}
 			}
-			else {
-				items.StartDict().Key("type"s).Value("Bus"s).Key("bus"s).Value(std::string(item->name)).Key("span_count"s).Value(item->span_count.value())
-					.Key("time"s).Value(item->time).EndDict();
+			std::sort(buses.begin(), buses.end(), [](const Bus* lhs, const Bus* rhs) {
+				return lhs->name < rhs->name;
+				});
+			buses.erase(std::unique(buses.begin(), buses.end()), buses.end());
+			request.bus_ids.emplace();
+			for (const Bus* bus : buses) {
+				request.bus_ids->push_back(static_cast<uint32_t>(bus->id));
 			}
 		}
-		return items.EndArray().Key("request_id"s).Value(request_as_map.at("id"s).AsInt()).Key("total_time"s).Value(founded_route->total_time).EndDict().Build();
 	}
-}
-
-void ProcessRequests::AsnwerRequests(std::ostream& thread) {
-	const auto& stat_requests = document_.GetRoot().AsDict().at("stat_requests"s).AsArray();
-	Builder builder = Builder{};
-	auto result = builder.StartArray();
-	for (const auto& request : stat_requests) {
-		const auto& request_as_map = request.AsDict();
-		Node node;
-		if (request_as_map.at("type"s).AsString() == "Bus"s) {
-			node = HandleBusRequest(request_as_map);
+	else if (type == "Route"sv || type == "RouteMap"sv) {
+		request.type = type == "Route"sv ? StatRequestType::ROUTE : StatRequestType::ROUTE_MAP;
+		if (const auto vertex = p_transport_router_->FindVertex(request_as_map.at("from"s).AsString())) {
+			request.vertex_from = static_cast<uint32_t>(*vertex);
 		}
-		else if (request_as_map.at("type"s).AsString() == "Stop"s) {
-			node = HandleStopRequest(request_as_map);
+		if (const auto vertex = p_transport_router_->FindVertex(request_as_map.at("to"s).AsString())) {
+			request.vertex_to = static_cast<uint32_t>(*vertex);
 		}
-		else if (request_as_map.at("type"s).AsString() == "Map"s) {
-			node = HandleMapRequest(request_as_map);
+		if (request.type == StatRequestType::ROUTE_MAP && request.vertex_to != StatRequest::NOT_FOUND) {
+			request.object_id = static_cast<uint32_t>(p_tran_cat_->FindStop(request_as_map.at("to"s).AsString())->id);
 		}
-		else if (request_as_map.at("type"s).AsString() == "Route"s) {
-			node = HandleRouteRequest(request_as_map);
+	}
+	else if (type == "Nearby"sv || type == "NearestStops"sv) {
+		request.center = { request_as_map.at("latitude"s).AsDouble(), request_as_map.at("longitude"s).AsDouble() };
+		if (type == "Nearby"sv) {
+			request.type = StatRequestType::NEARBY;
+			request.radius = request_as_map.at("radius"s).AsDouble();
 		}
 		else {
-			throw std::invalid_argument("Input contains not correct request!"s);
+			request.type = StatRequestType::NEAREST_STOPS;
+			const int count = request_as_map.at("count"s).AsInt();
+			request.count = count > 0 ? static_cast<uint32_t>(count) : 0;
 		}
-		result.Value(std::move(node.GetValue()));
 	}
-	json::Print(json::Document(result.EndArray().Build()), thread);
+	else {
+		throw std::invalid_argument("Input contains not correct request!"s);
+	}
+	return request;
+}
+
+StatRequest ProcessRequests::DecodeRequest(const json::Dict& request_as_map) const {
+	return DecodeRequestFrom(request_as_map);
+}
+
+StatRequest ProcessRequests::DecodeRequest(const json::flat::Dict& request_as_map) const {
+	return DecodeRequestFrom(request_as_map);
+}
+
+std::vector<StatRequest> ProcessRequests::DecodeRequests(const json::Array& stat_requests) const {
+	std::vector<StatRequest> requests;
+	requests.reserve(stat_requests.size());
+	for (const auto& request : stat_requests) {
+		requests.push_back(DecodeRequest(request.AsDict()));
+	}
+	return requests;
+}
+
+void ProcessRequests::AnswerRequest(const StatRequest& request, json::Writer& writer) const {
+	switch (request.type) {
+		case StatRequestType::BUS:
+			HandleBusRequest(request, writer);
+			break;
+		case StatRequestType::STOP:
+			HandleStopRequest(request, writer);
+			break;
+		case StatRequestType::MAP:
+			HandleMapRequest(request, writer);
+			break;
+		case StatRequestType::ROUTE:
+			HandleRouteRequest(request, writer);
+			break;
+		case StatRequestType::ROUTE_MAP:
+			HandleRouteMapRequest(request, writer);
+			break;
+		case StatRequestType::NEARBY:
+			HandleNearbyRequest(request, writer);
+			break;
+		case StatRequestType::NEAREST_STOPS:
+			HandleNearestStopsRequest(request, writer);
+			break;
+	}
+}
+
+void ProcessRequests::AnswerRequest(const json::Dict& request_as_map, json::Writer& writer) const {
+	AnswerRequest(DecodeRequest(request_as_map), writer);
+}
+
+void ProcessRequests::AnswerRequest(const json::flat::Dict& request_as_map, json::Writer& writer) const {
+	AnswerRequest(DecodeRequest(request_as_map), writer);
+}
+
+void ProcessRequests::AsnwerRequests(std::ostream& thread) const {
+	const auto& stat_requests = document_->GetRoot().AsDict().at("stat_requests"s).AsArray();
+	const std::vector<StatRequest> requests = DecodeRequests(stat_requests);
+	json::Writer writer(thread, number_mode_);
+	writer.StartArray();
+	RequestPool pool(*this, writer, threads_);
+	for (const auto& request : requests) {
+		pool.Add(request);
+	}
+	pool.Finish();
+	writer.EndArray();
+}
+
+StreamProcessRequests::StreamProcessRequests(std::istream& input, SnapshotLoader loader)
+	: input_(input)
+	, loader_(std::move(loader))
+{
+}
+
+void ProcessRequests::SetNumberMode(number_format::Mode number_mode) {
+	number_mode_ = number_mode;
+}
+
+void StreamProcessRequests::SetNumberMode(number_format::Mode number_mode) {
+	number_mode_ = number_mode;
+}
+
+void ProcessRequests::SetThreads(size_t threads) {
+	threads_ = threads;
+}
+
+void StreamProcessRequests::SetThreads(size_t threads) {
+	threads_ = threads;
 }
 
-void ProcessRequests::RenderRoute(std::ostream& thread) {
-	p_map_render_->Render(*p_tran_cat_);
-	p_map_render_->VisualiseRender(thread);
+void ProcessRequests::SetMapCache(const rendering::MapCache* map_cache) {
+	map_cache_ = map_cache;
+}
+
+void StreamProcessRequests::AsnwerRequests(std::ostream& thread) {
+	json::Reader reader(input_);
+	if (reader.Next() != Event::START_DICT) {
+		throw ParsingError("process_requests input must be a dict"s);
+	}
+	std::unique_ptr<CatalogueSnapshot> snapshot;
+	// stat_requests met before serialization_settings have to wait for the base
+	std::optional<Node> delayed_requests;
+	json::Writer writer(thread, number_mode_);
+	writer.StartArray();
+	while (reader.Next() == Event::KEY) {
+		if (reader.GetKey() == "serialization_settings"s) {
+			snapshot = loader_(reader.ReadValue().AsDict().at("file"s).AsString());
+		}
+		else if (reader.GetKey() == "stat_requests"s && snapshot) {
+			ProcessRequests facade(&snapshot->tran_cat, &snapshot->map_render, &snapshot->transport_router);
+			facade.SetNumberMode(number_mode_);
+			facade.SetMapCache(snapshot->map_cache.get());
+			if (reader.Next() != Event::START_ARRAY) {
+				throw ParsingError("stat_requests must be an array"s);
+			}
+			RequestPool pool(facade, writer, threads_);
+			while (pool.Read(reader)) {
+			}
+			pool.Finish();
+		}
+		else if (reader.GetKey() == "stat_requests"s) {
+			delayed_requests = reader.ReadValue();
+		}
+		else {
+			reader.SkipValue();
+		}
+	}
+	if (delayed_requests) {
+		if (!snapshot) {
+			throw std::invalid_argument("serialization_settings are not set!"s);
+		}
+		ProcessRequests facade(&snapshot->tran_cat, &snapshot->map_render, &snapshot->transport_router);
+		facade.SetNumberMode(number_mode_);
+		facade.SetMapCache(snapshot->map_cache.get());
+		RequestPool pool(facade, writer, threads_);
+		for (const auto& request : delayed_requests->AsArray()) {
+			pool.Add(facade.DecodeRequest(request.AsDict()));
+		}
+		pool.Finish();
+	}
+	writer.EndArray();
 }
 } //namespace handle_iformation
 } //namespace transport_catalogue
\ No newline at end of file
@@ -1,11 +1,20 @@
 #pragma once
 
 #include "json.h"
+#include "json_flat.h"
+#include "json_writer.h"
 #include "transport_catalogue.h"
 #include "map_renderer.h"
+#include "map_cache.h"
 #include "transport_router.h"
+#include "catalogue_snapshot.h"
 
+#include <cstdint>
+#include <functional>
 #include <iostream>
+#include <memory>
+#include <optional>
+#include <vector>
 
 namespace transport_catalogue {
 namespace handle_iformation {
@@ -30,26 +39,123 @@ private:
 	const json::Document& document_;
 };
 
+// base_requests of a serve batch: Stop and Bus requests as make_base reads them
+CatalogueUpdate ReadCatalogueUpdate(const json::flat::Array& base_requests);
+
+// make_base reading the input with json::Reader: base_requests are added to the catalogue
+// one by one and never exist as a whole document
+class StreamMakeBase {
+public:
+	explicit StreamMakeBase(std::istream& input);
+
+	TransportCatalogue MakeTransportCatalogue();
+	rendering::MapRenderer MakeMapRenderer() const;
+	transport_router::TransportRouter MakeTransportRouter(const TransportCatalogue& tran_cat) const;
+	std::string GetSerializationFile() const;
+private:
+	// every section except base_requests
+	json::Document settings_;
+	CatalogueBuilder builder_;
+};
+
+enum class StatRequestType : uint8_t {
+	BUS,
+	STOP,
+	MAP,
+	ROUTE,
+	ROUTE_MAP,
+	NEARBY,
+	NEAREST_STOPS
+};
+
+// Stat request decoded before it is answered: the type is an enum and names are resolved
+// to catalogue ids and router vertices, so answering does no string lookups
+struct StatRequest {
+	static constexpr uint32_t NOT_FOUND = UINT32_MAX;
+
+	StatRequestType type = StatRequestType::MAP;
+	int id = 0;
+	// Bus: id of the bus, Stop: id of the stop, RouteMap: id of the stop "to"; NOT_FOUND if there is no such name
+	uint32_t object_id = NOT_FOUND;
+	// Route and RouteMap: vertices of the stops in the router
+	uint32_t vertex_from = NOT_FOUND;
+	uint32_t vertex_to = NOT_FOUND;
+	// Nearby and NearestStops
+	uint32_t count = 0;
+	geo::Coordinates center = {};
+	double radius = 0;
+	// Map with "bbox" or "tile": the part of the map to draw
+	std::optional<rendering::Viewport> viewport;
+	std::optional<rendering::MapTile> tile;
+	// Map with "buses": ids of the buses to draw, in name order
+	std::optional<std::vector<uint32_t>> bus_ids;
+};
+
 class ProcessRequests {
 public:
 	explicit ProcessRequests(const json::Document& document
-	, TransportCatalogue* tran_cat
-	, rendering::MapRenderer* map_render
-	, transport_router::TransportRouter* transport_router);
+	, const TransportCatalogue* tran_cat
+	, const rendering::MapRenderer* map_render
+	, const transport_router::TransportRouter* transport_router);
+	ProcessRequests(const TransportCatalogue* tran_cat
+	, const rendering::MapRenderer* map_render
+	, const transport_router::TransportRouter* transport_router);
 
-	void AsnwerRequests(std::ostream& thread);
+	// how doubles are printed in answers and in the map svg
+	void SetNumberMode(number_format::Mode number_mode);
+	// more than one thread answers requests on a RequestPool
+	void SetThreads(size_t threads);
+	// Map answers are taken from the cache shared by everyone answering with this catalogue;
+	// without it the map is cached by this object
+	void SetMapCache(const rendering::MapCache* map_cache);
+	void AsnwerRequests(std::ostream& thread) const;
+	// throws std::invalid_argument for an unknown request type
+	StatRequest DecodeRequest(const json::Dict& request_as_map) const;
+	StatRequest DecodeRequest(const json::flat::Dict& request_as_map) const;
+	std::vector<StatRequest> DecodeRequests(const json::Array& stat_requests) const;
+	// writes the answer as the next value of the writer
+	void AnswerRequest(const StatRequest& request, json::Writer& writer) const;
+	void AnswerRequest(const json::Dict& request_as_map, json::Writer& writer) const;
+	void AnswerRequest(const json::flat::Dict& request_as_map, json::Writer& writer) const;
 private:
-	void RenderRoute(std::ostream& thread);
-	json::Node HandleBusRequest(const json::Dict& request_as_map) const;
-	json::Node HandleStopRequest(const json::Dict& request_as_map) const;
-	json::Node HandleMapRequest(const json::Dict& request_as_map);
-	json::Node HandleRouteRequest(const json::Dict& request_as_map) const;
+	// for json::Dict and json::flat::Dict
+	template <typename RequestDict>
+	StatRequest DecodeRequestFrom(const RequestDict& request_as_map) const;
+
+	void HandleBusRequest(const StatRequest& request, json::Writer& writer) const;
+	void HandleStopRequest(const StatRequest& request, json::Writer& writer) const;
+	void HandleMapRequest(const StatRequest& request, json::Writer& writer) const;
+	void HandleRouteRequest(const StatRequest& request, json::Writer& writer) const;
+	void HandleRouteMapRequest(const StatRequest& request, json::Writer& writer) const;
+	void HandleNearbyRequest(const StatRequest& request, json::Writer& writer) const;
+	void HandleNearestStopsRequest(const StatRequest& request, json::Writer& writer) const;
 private:
-	const json::Document& document_;
+	const json::Document* document_;
+
+	const TransportCatalogue* p_tran_cat_;
+	const rendering::MapRenderer* p_map_render_;
+	const transport_router::TransportRouter* p_transport_router_;
+	number_format::Mode number_mode_ = number_format::Mode::SHORTEST;
+	size_t threads_ = 1;
+	std::unique_ptr<rendering::MapCache> own_map_cache_ = std::make_unique<rendering::MapCache>();
+	const rendering::MapCache* map_cache_ = own_map_cache_.get();
+};
+
+// process_requests reading the input with json::Reader: stat_requests are answered one by one
+class StreamProcessRequests {
+public:
+	using SnapshotLoader = std::function<std::unique_ptr<CatalogueSnapshot>(const std::string& filename)>;
 
-	TransportCatalogue* p_tran_cat_;
-	rendering::MapRenderer* p_map_render_;
-	transport_router::TransportRouter* p_transport_router_;
+	StreamProcessRequests(std::istream& input, SnapshotLoader loader);
+
+	void SetNumberMode(number_format::Mode number_mode);
+	void SetThreads(size_t threads);
+	void AsnwerRequests(std::ostream& thread);
+private:
+	std::istream& input_;
+	SnapshotLoader loader_;
+	number_format::Mode number_mode_ = number_format::Mode::SHORTEST;
+	size_t threads_ = 1;
 };
 } //namespace handle_iformation
 } //namespace transport_catalogue
\ No newline at end of file
@@ -0,0 +1,171 @@
+#include "json_scan.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define JSON_SCAN_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(JSON_SCAN_SSE2) && defined(__GNUC__)
+#define JSON_SCAN_AVX2
+#include <immintrin.h>
+#endif
+
+namespace json {
+namespace detail {
+
+namespace {
+
+bool IsSpace(unsigned char c) {
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+bool IsStringSpecial(unsigned char c) {
+    return c == '"' || c == '\\' || c == '\n' || c == '\r';
+}
+
+// Заполняет биты блока [begin, end) без SIMD; используется для хвоста буфера
+void BuildScalar(const char* data, size_t begin, size_t end, uint64_t* non_space, uint64_t* string_special) {
+    for (size_t i = begin; i < end; ++i) {
+        const auto c = static_cast<unsigned char>(data[i]);
+        if (!IsSpace(c)) {
+            non_space[i / 64] |= uint64_t{1} << (i % 64);
+        }
+        if (IsStringSpecial(c)) {
+            string_special[i / 64] |= uint64_t{1} << (i % 64);
+        }
+    }
+}
+
+#ifdef JSON_SCAN_SSE2
+// Возвращает маски пробелов и специальных символов строк для 16 байт
+inline void ClassifySse2(const char* data, uint32_t& space, uint32_t& special) {
+    const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+    // '\t' .. '\r' идут подряд: c - '\t' <= 4 в беззнаковой арифметике
+    const __m128i shifted = _mm_sub_epi8(chunk, _mm_set1_epi8('\t'));
+    const __m128i control = _mm_cmpeq_epi8(_mm_max_epu8(shifted, _mm_set1_epi8(4)), _mm_set1_epi8(4));
+    const __m128i spaces = _mm_or_si128(control, _mm_cmpeq_epi8(chunk, _mm_set1_epi8(' ')));
+    const __m128i specials = _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('"')), _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\\'))),
+        _mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('\n')), _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\r'))));
+    space = static_cast<uint32_t>(_mm_movemask_epi8(spaces));
+    special = static_cast<uint32_t>(_mm_movemask_epi8(specials));
+}
+
+size_t BuildSse2(const char* data, size_t size, uint64_t* non_space, uint64_t* string_special) {
+    const size_t blocks = size / 64;
+    for (size_t block = 0; block < blocks; ++block) {
+        uint64_t space = 0;
+        uint64_t special = 0;
+        for (size_t part = 0; part < 4; ++part) {
+            uint32_t part_space, part_special;
+            ClassifySse2(data + block * 64 + part * 16, part_space, part_special);
+            space |= uint64_t{part_space} << (part * 16);
+            special |= uint64_t{part_special} << (part * 16);
+        }
+        non_space[block] = ~space;
+        string_special[block] = special;
+    }
+    return blocks * 64;
+}
+#endif
+
+#ifdef JSON_SCAN_AVX2
+__attribute__((target("avx2")))
+size_t BuildAvx2(const char* data, size_t size, uint64_t* non_space, uint64_t* string_special) {
+    const size_t blocks = size / 64;
+    for (size_t block = 0; block < blocks; ++block) {
+        uint64_t space = 0;
+        uint64_t special = 0;
+        for (size_t part = 0; part < 2; ++part) {
+            const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + block * 64 + part * 32));
+            const __m256i shifted = _mm256_sub_epi8(chunk, _mm256_set1_epi8('\t'));
+            const __m256i control = _mm256_cmpeq_epi8(_mm256_max_epu8(shifted, _mm256_set1_epi8(4)), _mm256_set1_epi8(4));
+            const __m256i spaces = _mm256_or_si256(control, _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(' ')));
+            const __m256i specials = _mm256_or_si256(
+                _mm256_or_si256(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('"')), _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\\'))),
+                _mm256_or_si256(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\n')), _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\r'))));
+            space |= uint64_t{static_cast<uint32_t>(_mm256_movemask_epi8(spaces))} << (part * 32);
+            special |= uint64_t{static_cast<uint32_t>(_mm256_movemask_epi8(specials))} << (part * 32);
+        }
+        non_space[block] = ~space;
+        string_special[block] = special;
+    }
+    return blocks * 64;
+}
+#endif
+
+inline int CountTrailingZeros(uint64_t value) {
+#ifdef __GNUC__
+    return __builtin_ctzll(value);
+#else
+    int result = 0;
+    while (!(value & 1)) {
+        value >>= 1;
+        ++result;
+    }
+    return result;
+#endif
+}
+
+size_t NextSetBit(const std::vector<uint64_t>& bits, size_t pos, size_t size) {
+    if (pos >= size) {
+        return size;
+    }
+    size_t word = pos / 64;
+    uint64_t value = bits[word] & (~uint64_t{0} << (pos % 64));
+    while (value == 0) {
+        if (++word == bits.size()) {
+            return size;
+        }
+        value = bits[word];
+    }
+    const size_t result = word * 64 + CountTrailingZeros(value);
+    return result < size ? result : size;
+}
+
+}  // namespace
+
+ScanLevel GetScanLevel() {
+#if defined(JSON_SCAN_AVX2)
+    static const ScanLevel level = __builtin_cpu_supports("avx2") ? ScanLevel::AVX2 : ScanLevel::SSE2;
+    return level;
+#elif defined(JSON_SCAN_SSE2)
+    return ScanLevel::SSE2;
+#else
+    return ScanLevel::SCALAR;
+#endif
+}
+
+StructuralIndex::StructuralIndex(const char* data, size_t size, ScanLevel level)
+    : size_(size)
+    , non_space_(size / 64 + 1, 0)
+    , string_special_(size / 64 + 1, 0)
+{
+    size_t done = 0;
+    switch (level) {
+#ifdef JSON_SCAN_AVX2
+        case ScanLevel::AVX2:
+            done = BuildAvx2(data, size, non_space_.data(), string_special_.data());
+            break;
+#endif
+#ifdef JSON_SCAN_SSE2
+        case ScanLevel::SSE2:
+            done = BuildSse2(data, size, non_space_.data(), string_special_.data());
+            break;
+#endif
+        default:
+            break;
+    }
+    BuildScalar(data, done, size, non_space_.data(), string_special_.data());
+}
+
+size_t StructuralIndex::NextNonSpace(size_t pos) const {
+    return NextSetBit(non_space_, pos, size_);
+}
+
+size_t StructuralIndex::NextStringSpecial(size_t pos) const {
+    return NextSetBit(string_special_, pos, size_);
+}
+
+}  // namespace detail
+}  // namespace json
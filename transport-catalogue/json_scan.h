@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace json {
+namespace detail {
+
+enum class ScanLevel {
+    SCALAR,
+    SSE2,
+    AVX2
+};
+
+// Best instruction set available on the running CPU
+ScanLevel GetScanLevel();
+
+/*
+    * Структурный индекс входного буфера: по одному биту на байт.
+    * Строится одним SIMD-проходом, после чего парсер перепрыгивает
+    * пробелы и содержимое строк поиском следующего установленного бита
+    */
+class StructuralIndex {
+public:
+    StructuralIndex(const char* data, size_t size, ScanLevel level = GetScanLevel());
+
+    // Позиция первого непробельного символа начиная с pos, либо size
+    size_t NextNonSpace(size_t pos) const;
+
+    // Позиция первого из символов '"', '\\', '\n', '\r' начиная с pos, либо size
+    size_t NextStringSpecial(size_t pos) const;
+
+private:
+    size_t size_;
+    std::vector<uint64_t> non_space_;
+    std::vector<uint64_t> string_special_;
+};
+
+}  // namespace detail
+}  // namespace json
@@ -0,0 +1,269 @@
+#include "json_writer.h"
+
+#include <stdexcept>
+
+namespace json {
+using namespace std::literals;
+
+Writer::Writer(std::ostream& output, number_format::Mode number_mode, Layout layout)
+	: output_(output)
+	, number_mode_(number_mode)
+	, indented_(layout == Layout::INDENTED)
+{
+	buffer_.reserve(2 * FLUSH_SIZE);
+}
+
+Writer::Writer(std::ostream& output, const Writer& array_writer)
+	: output_(output)
+	, number_mode_(array_writer.number_mode_)
+	, indented_(array_writer.indented_)
+	, stack_(array_writer.stack_.size(), Frame{ false })
+	, root_written_(true)
+{
+	if (array_writer.stack_.empty() || array_writer.stack_.back().is_dict) {
+		throw std::logic_error("Items can be written only into an array!"s);
+	}
+	buffer_.reserve(2 * FLUSH_SIZE);
+}
+
+Writer::~Writer() {
+	Flush();
+}
+
+void Writer::Flush() {
+	output_.write(buffer_.data(), buffer_.size());
+	output_.flush();
+	buffer_.clear();
+}
+
+void Writer::MaybeFlush() {
+	if (buffer_.size() >= FLUSH_SIZE) {
+		Flush();
+	}
+}
+
+// Separator and indent before an array item or a dict key, as json::Print writes them
+void Writer::WriteItemPrefix() {
+	Frame& frame = stack_.back();
+	if (frame.is_first) {
+		frame.is_first = false;
+	}
+	else {
+		buffer_ += indented_ ? ",\n"sv : ","sv;
+	}
+	if (indented_) {
+		buffer_.append(stack_.size() * INDENT_STEP, ' ');
+	}
+}
+
+void Writer::BeforeValue(const char* command) {
+	if (stack_.empty()) {
+		if (root_written_) {
+			throw std::logic_error("Not correct call of command \""s + command + "\"!"s);
+		}
+		root_written_ = true;
+	}
+	else if (stack_.back().is_dict) {
+		if (!stack_.back().has_key) {
+			throw std::logic_error("Not correct call of command \""s + command + "\"!"s);
+		}
+		stack_.back().has_key = false;
+	}
+	else {
+		WriteItemPrefix();
+	}
+}
+
+void AppendEscaped(std::string& out, std::string_view value) {
+	size_t run = 0;
+	for (size_t i = 0; i < value.size(); ++i) {
+		const char c = value[i];
+		if (c != '\r' && c != '\n' && c != '"' && c != '\\') {
+			continue;
+		}
+		out.append(value.data() + run, i - run);
+		run = i + 1;
+		switch (c) {
+			case '\r':
+				out += "\\r"sv;
+				break;
+			case '\n':
+				out += "\\n"sv;
+				break;
+			default:
+				out.push_back('\\');
+				out.push_back(c);
+				break;
+		}
+	}
+	out.append(value.data() + run, value.size() - run);
+}
+
+void Writer::WriteString(std::string_view value) {
+	buffer_.push_back('"');
+	AppendEscaped(buffer_, value);
+	buffer_.push_back('"');
+}
+
+Writer& Writer::StartDict() {
+	BeforeValue("StartDict");
+	buffer_ += indented_ ? "{\n"sv : "{"sv;
+	stack_.push_back({ true });
+	return *this;
+}
+
+Writer& Writer::Key(std::string_view key) {
+	if (stack_.empty() || !stack_.back().is_dict || stack_.back().has_key) {
+		throw std::logic_error("Not correct call of command \"Key\"!"s);
+	}
+	WriteItemPrefix();
+	WriteString(key);
+	buffer_ += indented_ ? ": "sv : ":"sv;
+	stack_.back().has_key = true;
+	return *this;
+}
+
+void Writer::CloseContainer(bool is_dict, char bracket, const char* command) {
+	if (stack_.empty() || stack_.back().is_dict != is_dict || stack_.back().has_key) {
+		throw std::logic_error("Not correct call of command \""s + command + "\"!"s);
+	}
+	stack_.pop_back();
+	if (indented_) {
+		buffer_.push_back('\n');
+		buffer_.append(stack_.size() * INDENT_STEP, ' ');
+	}
+	buffer_.push_back(bracket);
+	MaybeFlush();
+}
+
+Writer& Writer::EndDict() {
+	CloseContainer(true, '}', "EndDict");
+	return *this;
+}
+
+Writer& Writer::StartArray() {
+	BeforeValue("StartArray");
+	buffer_ += indented_ ? "[\n"sv : "["sv;
+	stack_.push_back({ false });
+	return *this;
+}
+
+Writer& Writer::EndArray() {
+	CloseContainer(false, ']', "EndArray");
+	return *this;
+}
+
+Writer& Writer::Value(std::nullptr_t) {
+	BeforeValue("Value");
+	buffer_ += "null"sv;
+	MaybeFlush();
+	return *this;
+}
+
+Writer& Writer::Value(bool value) {
+	BeforeValue("Value");
+	buffer_ += value ? "true"sv : "false"sv;
+	MaybeFlush();
+	return *this;
+}
+
+Writer& Writer::Value(int value) {
+	BeforeValue("Value");
+	char number[number_format::MAX_SIZE];
+	buffer_.append(number, number_format::Format(number, value));
+	MaybeFlush();
+	return *this;
+}
+
+Writer& Writer::Value(double value) {
+	BeforeValue("Value");
+	char number[number_format::MAX_SIZE];
+	buffer_.append(number, number_format::Format(number, value, number_mode_));
+	MaybeFlush();
+	return *this;
+}
+
+Writer& Writer::Value(std::string_view value) {
+	BeforeValue("Value");
+	WriteString(value);
+	MaybeFlush();
+	return *this;
+}
+
+Writer& Writer::EscapedValue(std::string_view escaped) {
+	BeforeValue("Value");
+	buffer_.push_back('"');
+	buffer_ += escaped;
+	buffer_.push_back('"');
+	MaybeFlush();
+	return *this;
+}
+
+Writer& Writer::EscapedValue(std::string_view escaped_head, std::string_view escaped_tail) {
+	BeforeValue("Value");
+	buffer_.push_back('"');
+	buffer_ += escaped_head;
+	buffer_ += escaped_tail;
+	buffer_.push_back('"');
+	MaybeFlush();
+	return *this;
+}
+
+Writer& Writer::Value(const char* value) {
+	return Value(std::string_view(value));
+}
+
+Writer& Writer::Value(const std::string& value) {
+	return Value(std::string_view(value));
+}
+
+Writer& Writer::Value(const Node& node) {
+	if (node.IsArray()) {
+		StartArray();
+		for (const auto& item : node.AsArray()) {
+			Value(item);
+		}
+		return EndArray();
+	}
+	if (node.IsDict()) {
+		StartDict();
+		for (const auto& [key, value] : node.AsDict()) {
+			Key(key).Value(value);
+		}
+		return EndDict();
+	}
+	if (node.IsString()) {
+		return Value(node.AsString());
+	}
+	if (node.IsInt()) {
+		return Value(node.AsInt());
+	}
+	if (node.IsPureDouble()) {
+		return Value(node.AsDouble());
+	}
+	if (node.IsBool()) {
+		return Value(node.AsBool());
+	}
+	return Value(nullptr);
+}
+
+Writer& Writer::AppendItems(std::string_view items) {
+	if (stack_.empty() || stack_.back().is_dict) {
+		throw std::logic_error("Not correct call of command \"AppendItems\"!"s);
+	}
+	if (items.empty()) {
+		return *this;
+	}
+	Frame& frame = stack_.back();
+	if (frame.is_first) {
+		frame.is_first = false;
+	}
+	else {
+		buffer_ += indented_ ? ",\n"sv : ","sv;
+	}
+	buffer_ += items;
+	MaybeFlush();
+	return *this;
+}
+
+} //namespace json
\ No newline at end of file
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "json.h"
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace json {
+
+// Appends the characters of value as they are written between the quotes of a JSON string
+void AppendEscaped(std::string& out, std::string_view value);
+
+// Serializes straight into an output buffer with the formatting of json::Print.
+// The buffer is handed to the stream every FLUSH_SIZE bytes, so the beginning of
+// a long answer is out before its end is computed.
+// Dict keys are printed in the order they are written: to get the output of
+// json::Print, which sorts them, write them sorted.
+class Writer {
+public:
+	// COMPACT writes no line breaks and no indents: a whole answer stays on one line
+	enum class Layout {
+		INDENTED,
+		COMPACT
+	};
+
+	explicit Writer(std::ostream& output, number_format::Mode number_mode = number_format::Mode::SHORTEST,
+		Layout layout = Layout::INDENTED);
+	// Writes items of the array open in array_writer, formatted as array_writer would write them,
+	// but without the brackets. The text is added to that array with AppendItems,
+	// so a long array can be formatted in parts, e.g. on several threads
+	Writer(std::ostream& output, const Writer& array_writer);
+	Writer(const Writer&) = delete;
+	Writer& operator=(const Writer&) = delete;
+	~Writer();
+
+	Writer& StartDict();
+	Writer& Key(std::string_view key);
+	Writer& EndDict();
+	Writer& StartArray();
+	Writer& EndArray();
+
+	Writer& Value(std::nullptr_t);
+	Writer& Value(bool value);
+	Writer& Value(int value);
+	Writer& Value(double value);
+	Writer& Value(std::string_view value);
+	Writer& Value(const char* value);
+	Writer& Value(const std::string& value);
+	// string whose characters are already escaped by AppendEscaped
+	Writer& EscapedValue(std::string_view escaped);
+	// one string of two escaped parts, so a large cached head is not copied to be joined
+	Writer& EscapedValue(std::string_view escaped_head, std::string_view escaped_tail);
+	// whole subtree, formatted as by json::Print
+	Writer& Value(const Node& node);
+	// text of a writer constructed from this one; empty text adds no items
+	Writer& AppendItems(std::string_view items);
+
+	// hands the buffered text to the stream and flushes it
+	void Flush();
+private:
+	static constexpr size_t FLUSH_SIZE = 1 << 16;
+	static constexpr int INDENT_STEP = 4;
+
+	struct Frame {
+		bool is_dict;
+		bool is_first = true;
+		bool has_key = false;
+	};
+
+	std::ostream& output_;
+	number_format::Mode number_mode_;
+	bool indented_;
+	std::string buffer_;
+	std::vector<Frame> stack_;
+	bool root_written_ = false;
+
+	void BeforeValue(const char* command);
+	void WriteItemPrefix();
+	void WriteString(std::string_view value);
+	void CloseContainer(bool is_dict, char bracket, const char* command);
+	void MaybeFlush();
+};
+
+} //namespace json
\ No newline at end of file
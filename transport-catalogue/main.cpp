@@ -1,22 +1,92 @@
 ﻿#include "json_reader.h"
+#include "request_server.h"
 #include "serialization.h"
 //#include "tests.h"
 
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 #include <string>
 #include <fstream>
+#include <optional>
+#include <stdexcept>
+#include <thread>
 
 using namespace transport_catalogue;
 using namespace handle_iformation;
 using namespace geo;
 using namespace std::literals;
 
+// the largest --width of raster_map, so a mistyped width is rejected rather than allocated
+const size_t MAX_WIDTH = 16384;
+
 void PrintUsage(std::ostream& stream = std::cerr) {
-    stream << "Usage: transport_catalogue [make_base|process_requests]\n"sv;
+    stream << "Usage: transport_catalogue [make_base|process_requests|serve] [--legacy-numbers] [--render-map] [--threads N] [--socket PATH]\n"sv
+        << "       transport_catalogue raster_map --output PATH.png|PATH.ppm [--width PX] [--tile Z/X/Y] [--labels] [--threads N]\n"sv
+        << "       --width is from 1 to "sv << MAX_WIDTH << " px\n"sv;
+}
+
+// Image width of --width: 1 to MAX_WIDTH pixels
+std::optional<size_t> ParseWidth(std::string_view text) {
+    if (text.empty() || text.size() > 5 || !std::all_of(text.begin(), text.end(), [](char c) { return c >= '0' && c <= '9'; })) {
+        return std::nullopt;
+    }
+    const size_t width = std::stoul(std::string(text));
+    if (width == 0 || width > MAX_WIDTH) {
+        return std::nullopt;
+    }
+    return width;
+}
+
+// Z/X/Y of a tile inside the map
+std::optional<rendering::MapTile> ParseTile(std::string_view text) {
+    uint32_t parts[3];
+    for (size_t i = 0; i < 3; ++i) {
+        const size_t end = i < 2 ? text.find('/') : text.size();
+        if (end == 0 || end == std::string_view::npos || end > 2
+            || !std::all_of(text.begin(), text.begin() + end, [](char c) { return c >= '0' && c <= '9'; })) {
+            return std::nullopt;
+        }
+        parts[i] = static_cast<uint32_t>(std::stoul(std::string(text.substr(0, end))));
+        text.remove_prefix(std::min(text.size(), end + 1));
+    }
+    const auto [z, x, y] = parts;
+    if (z > rendering::MapTile::MAX_ZOOM || x >> z != 0 || y >> z != 0) {
+        return std::nullopt;
+    }
+    return rendering::MapTile{ z, x, y };
+}
+
+// Draws the map of the base named by serialization_settings of the input into a PNG or PPM file
+void RasterMap(std::istream& input, const std::string& output_path, size_t width,
+    const std::optional<rendering::MapTile>& tile, raster::RasterOptions options) {
+    const json::Document settings = json::Load(input);
+    const std::string file = settings.GetRoot().AsDict().at("serialization_settings"s).AsDict().at("file"s).AsString();
+    const auto snapshot = serialization::DeserializeSnapshot(file);
+    const rendering::MapRenderer& map_render = snapshot->map_render;
+    const auto& render_settings = map_render.GetRenderSettings();
+    rendering::MapRenderer::MapData map = map_render.PrepareMap(snapshot->tran_cat);
+    map_render.IndexMap(map);
+
+    const rendering::Viewport viewport = tile ? map_render.GetTileViewport(*tile)
+        : rendering::Viewport{ 0, 0, render_settings.width, render_settings.height };
+    options.width = width ? width : static_cast<size_t>(std::max(1l, std::lround(render_settings.width)));
+    const raster::Image image = map_render.RasterizeViewport(map, viewport, options);
+
+    std::ofstream output(output_path, std::ios::binary);
+    if (!output) {
+        throw std::runtime_error("Cannot open "s + output_path);
+    }
+    if (output_path.size() >= 4 && output_path.compare(output_path.size() - 4, 4, ".ppm"s) == 0) {
+        raster::WritePpm(output, image);
+    }
+    else {
+        raster::WritePng(output, image);
+    }
 }
 
 int main(int argc, char* argv[]) {
-    if (argc != 2) {
+    if (argc < 2) {
         PrintUsage();
         return 1;
     }
@@ -32,29 +102,98 @@ int main(int argc, char* argv[]) {
     std::fstream stream_output("opentest_myanswer.json");
     */
     const std::string_view mode(argv[1]);
+    // --legacy-numbers prints doubles exactly as std::ostream did, for byte-identical answers
+    auto number_mode = number_format::Mode::SHORTEST;
+    // --socket PATH makes serve listen on a Unix domain socket instead of reading stdin
+    std::string socket_path;
+    // --threads N answers stat_requests or draws raster_map bands on N worker threads, 0 is one per core;
+    // raster_map uses every core by default
+    size_t threads = mode == "raster_map"sv ? std::max(1u, std::thread::hardware_concurrency()) : 1;
+    // --render-map makes make_base store the rendered map, cut by bus and by stop, in the base file
+    bool render_map = false;
+    // raster_map: --output PATH writes PNG, or PPM for a .ppm name; --width PX is the image width,
+    // the map width by default, up to MAX_WIDTH; --tile Z/X/Y draws one tile; --labels draws texts as boxes
+    std::string output_path;
+    size_t width = 0;
+    std::optional<rendering::MapTile> tile;
+    bool label_boxes = false;
+    for (int i = 2; i < argc; ++i) {
+        if (argv[i] == "--legacy-numbers"sv) {
+            number_mode = number_format::Mode::STREAM_COMPATIBLE;
+        }
+        else if (argv[i] == "--threads"sv && (mode == "process_requests"sv || mode == "raster_map"sv) && i + 1 < argc) {
+            threads = std::stoul(argv[++i]);
+            if (threads == 0) {
+                threads = std::max(1u, std::thread::hardware_concurrency());
+            }
+        }
+        else if (argv[i] == "--render-map"sv && mode == "make_base"sv) {
+            render_map = true;
+        }
+        else if (argv[i] == "--socket"sv && mode == "serve"sv && i + 1 < argc) {
+            socket_path = argv[++i];
+        }
+        else if (argv[i] == "--output"sv && mode == "raster_map"sv && i + 1 < argc) {
+            output_path = argv[++i];
+        }
+        else if (argv[i] == "--width"sv && mode == "raster_map"sv && i + 1 < argc) {
+            const auto parsed = ParseWidth(argv[++i]);
+            if (!parsed) {
+                PrintUsage();
+                return 1;
+            }
+            width = *parsed;
+        }
+        else if (argv[i] == "--tile"sv && mode == "raster_map"sv && i + 1 < argc) {
+            tile = ParseTile(argv[++i]);
+            if (!tile) {
+                PrintUsage();
+                return 1;
+            }
+        }
+        else if (argv[i] == "--labels"sv && mode == "raster_map"sv) {
+            label_boxes = true;
+        }
+        else {
+            PrintUsage();
+            return 1;
+        }
+    }
 
     if (mode == "make_base"sv) {
-        auto data_doc = DataDocument::MakeDataDocument(stream_input);
-        MakeBase facade(data_doc.GetDocument());
+        StreamMakeBase facade(stream_input);
         TransportCatalogue tran_cat = facade.MakeTransportCatalogue();
         rendering::MapRenderer map_render = facade.MakeMapRenderer();
         transport_router::TransportRouter trant_router = facade.MakeTransportRouter(tran_cat);
-        serialization::SerializeFacade(tran_cat, map_render, trant_router, data_doc.GetSerializationFile());
+        std::optional<rendering::MapFragments> map_fragments;
+        if (render_map) {
+            map_fragments = rendering::MapCache::RenderFragments(map_render, tran_cat, number_mode);
+        }
+        serialization::SerializeFacade(tran_cat, map_render, trant_router, facade.GetSerializationFile(),
+            map_fragments ? &*map_fragments : nullptr);
     }
     else if (mode == "process_requests"sv) {
-        auto data_doc = DataDocument::MakeDataDocument(stream_input);
-        std::unique_ptr<transport_catalogue_serialize::Facade> proto_facade(serialization::DeserializeFacade(data_doc.GetSerializationFile()));
-        auto tran_cat = serialization::DeserializeTransportCatalogue(proto_facade->tran_cat());
-        auto map_render = rendering::MapRenderer{ serialization::DeserializeSerializeRenderSettings(proto_facade->render_settings()) };
-        auto transport_router = serialization::DeserializeRouteSettings(proto_facade->tran_router(),
-            tran_cat.GetStopnameToStop(), tran_cat.GetBusnameToBus());
-        ProcessRequests facade(data_doc.GetDocument()
-            , &tran_cat
-            , &map_render
-            , &transport_router);
-        //facade.SetTransportCatalogue(&tran_cat).SetMapRenderer(&map_render).SetTransportRouter(&transport_router);
+        StreamProcessRequests facade(stream_input, serialization::DeserializeSnapshot);
+        facade.SetNumberMode(number_mode);
+        facade.SetThreads(threads);
         facade.AsnwerRequests(stream_output);
     }
+    else if (mode == "serve"sv) {
+        RequestServer server(serialization::DeserializeSnapshot, std::cerr);
+        server.SetNumberMode(number_mode);
+        if (socket_path.empty()) {
+            server.Serve(stream_input, stream_output);
+        }
+        else {
+            server.ServeSocket(socket_path);
+        }
+    }
+    else if (mode == "raster_map"sv && !output_path.empty()) {
+        raster::RasterOptions options;
+        options.label_boxes = label_boxes;
+        options.threads = threads;
+        RasterMap(stream_input, output_path, width, tile, options);
+    }
     else {
         PrintUsage();
         return 1;
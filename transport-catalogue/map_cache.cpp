@@ -0,0 +1,192 @@
+#include "map_cache.h"
+#include "json_writer.h"
+
+#include <algorithm>
+#include <string>
+
+namespace transport_catalogue {
+namespace rendering {
+namespace {
+std::string_view GetFragment(const MapFragments& fragments, const std::vector<uint64_t>& offsets, uint32_t id) {
+	return std::string_view(fragments.text).substr(offsets[id], offsets[id + 1] - offsets[id]);
+}
+
+// escaped svg of the buses and the stops, both given in the order of the whole map
+std::string JoinFragments(const MapFragments& fragments, const std::vector<uint32_t>& bus_ids,
+	const std::vector<uint32_t>& stop_ids) {
+	std::string svg;
+	svg::CompactDocument::RenderBegin(svg);
+	std::string escaped_svg;
+	json::AppendEscaped(escaped_svg, svg);
+	for (const uint32_t id : bus_ids) {
+		escaped_svg += GetFragment(fragments, fragments.route_offsets, id);
+	}
+	for (const uint32_t id : bus_ids) {
+		escaped_svg += GetFragment(fragments, fragments.label_offsets, id);
+	}
+	for (const uint32_t id : stop_ids) {
+		escaped_svg += GetFragment(fragments, fragments.circle_offsets, id);
+	}
+	for (const uint32_t id : stop_ids) {
+		escaped_svg += GetFragment(fragments, fragments.stop_label_offsets, id);
+	}
+	svg.clear();
+	svg::CompactDocument::RenderEnd(svg);
+	json::AppendEscaped(escaped_svg, svg);
+	return escaped_svg;
+}
+} //namespace
+
+PrerenderedMap MapCache::Render(const MapRenderer& map_render, const TransportCatalogue& tran_cat,
+	number_format::Mode number_mode) {
+	std::string svg;
+	map_render.VisualiseRender(tran_cat, svg, number_mode);
+	PrerenderedMap map{ number_mode, {} };
+	json::AppendEscaped(map.escaped_svg, svg);
+	return map;
+}
+
+MapFragments MapCache::RenderFragments(const MapRenderer& map_render, const TransportCatalogue& tran_cat,
+	number_format::Mode number_mode) {
+	MapFragments fragments = map_render.RenderFragments(map_render.PrepareMap(tran_cat), number_mode);
+	MapFragments escaped{ number_mode, {}, {}, {}, {}, {} };
+	escaped.text.reserve(fragments.text.size());
+	const auto escape = [&](const std::vector<uint64_t>& offsets, std::vector<uint64_t>& escaped_offsets) {
+		escaped_offsets.reserve(offsets.size());
+		escaped_offsets.push_back(escaped.text.size());
+		for (size_t id = 0; id + 1 < offsets.size(); ++id) {
+			json::AppendEscaped(escaped.text, GetFragment(fragments, offsets, static_cast<uint32_t>(id)));
+			escaped_offsets.push_back(escaped.text.size());
+		}
+	};
+	escape(fragments.route_offsets, escaped.route_offsets);
+	escape(fragments.label_offsets, escaped.label_offsets);
+	escape(fragments.circle_offsets, escaped.circle_offsets);
+	escape(fragments.stop_label_offsets, escaped.stop_label_offsets);
+	return escaped;
+}
+
+const std::string& MapCache::Get(const MapRenderer& map_render, const TransportCatalogue& tran_cat,
+	number_format::Mode number_mode) const {
+	Entry& entry = entries_[static_cast<size_t>(number_mode)];
+	std::call_once(entry.once, [&] {
+		if (!entry.has_fragments) {
+			entry.escaped_svg = Render(map_render, tran_cat, number_mode).escaped_svg;
+			return;
+		}
+		std::vector<uint32_t> bus_ids;
+		bus_ids.reserve(tran_cat.GetBusnameToBus().size());
+		for (const auto& [busname, bus] : tran_cat.GetBusnameToBus()) {
+			bus_ids.push_back(static_cast<uint32_t>(bus->id));
+		}
+		entry.escaped_svg = JoinFragments(entry.fragments, bus_ids, tran_cat.GetLayout().valid_stop_ids);
+		});
+	return entry.escaped_svg;
+}
+
+void MapCache::Set(PrerenderedMap&& map) {
+	Entry& entry = entries_[static_cast<size_t>(map.number_mode)];
+	std::call_once(entry.once, [&] {
+		entry.escaped_svg = std::move(map.escaped_svg);
+		});
+}
+
+void MapCache::Set(MapFragments&& fragments) {
+	Entry& entry = entries_[static_cast<size_t>(fragments.number_mode)];
+	std::call_once(entry.fragments_once, [&] {
+		entry.fragments = std::move(fragments);
+		entry.has_fragments = true;
+		});
+}
+
+const MapFragments& MapCache::GetFragments(const MapRenderer& map_render, const TransportCatalogue& tran_cat,
+	number_format::Mode number_mode) const {
+	Entry& entry = entries_[static_cast<size_t>(number_mode)];
+	std::call_once(entry.fragments_once, [&] {
+		entry.fragments = RenderFragments(map_render, tran_cat, number_mode);
+		});
+	return entry.fragments;
+}
+
+std::string MapCache::GetBusesMap(const MapRenderer& map_render, const TransportCatalogue& tran_cat,
+	const std::vector<uint32_t>& bus_ids, number_format::Mode number_mode) const {
+	const auto& layout = tran_cat.GetLayout();
+	std::vector<uint32_t> stop_ids;
+	for (const uint32_t id : bus_ids) {
+		stop_ids.insert(stop_ids.end(), layout.bus_stop_ids.begin() + layout.bus_stop_offsets[id],
+			layout.bus_stop_ids.begin() + layout.bus_stop_offsets[id + 1]);
+	}
+	std::sort(stop_ids.begin(), stop_ids.end());
+	stop_ids.erase(std::unique(stop_ids.begin(), stop_ids.end()), stop_ids.end());
+	std::sort(stop_ids.begin(), stop_ids.end(), [&layout](uint32_t lhs, uint32_t rhs) {
+		return layout.stop_names[lhs] < layout.stop_names[rhs];
+		});
+	return JoinFragments(GetFragments(map_render, tran_cat, number_mode), bus_ids, stop_ids);
+}
+
+const MapRenderer::MapData& MapCache::GetMapData(const MapRenderer& map_render, const TransportCatalogue& tran_cat) const {
+	std::call_once(map_data_once_, [&] {
+		map_data_ = map_render.PrepareMap(tran_cat);
+		map_render.IndexMap(*map_data_);
+		});
+	return *map_data_;
+}
+
+std::string MapCache::GetViewport(const MapRenderer& map_render, const TransportCatalogue& tran_cat,
+	const Viewport& viewport, number_format::Mode number_mode) const {
+	std::string svg;
+	map_render.VisualiseViewport(GetMapData(map_render, tran_cat), viewport, svg, number_mode);
+	std::string escaped_svg;
+	json::AppendEscaped(escaped_svg, svg);
+	return escaped_svg;
+}
+
+std::shared_ptr<const std::string> MapCache::GetTile(const MapRenderer& map_render, const TransportCatalogue& tran_cat,
+	const MapTile& tile, number_format::Mode number_mode) const {
+	const uint64_t key = static_cast<uint64_t>(number_mode) << 62 | static_cast<uint64_t>(tile.z) << 56
+		| static_cast<uint64_t>(tile.x) << 28 | tile.y;
+	{
+		std::lock_guard guard(tiles_mutex_);
+		if (const auto it = tile_positions_.find(key); it != tile_positions_.end()) {
+			tiles_.splice(tiles_.begin(), tiles_, it->second);
+			return it->second->second;
+		}
+	}
+	auto escaped_svg = std::make_shared<const std::string>(
+		GetViewport(map_render, tran_cat, map_render.GetTileViewport(tile), number_mode));
+	std::lock_guard guard(tiles_mutex_);
+	// another request may have rendered the tile meanwhile
+	if (const auto it = tile_positions_.find(key); it != tile_positions_.end()) {
+		tiles_.splice(tiles_.begin(), tiles_, it->second);
+		return it->second->second;
+	}
+	if (escaped_svg->size() > MAX_TILE_BYTES) {
+		return escaped_svg;
+	}
+	tiles_.emplace_front(key, escaped_svg);
+	tile_positions_.emplace(key, tiles_.begin());
+	tile_bytes_ += escaped_svg->size();
+	// the least recently used tiles are dropped, requests still writing them keep their copies
+	while (tile_bytes_ > MAX_TILE_BYTES) {
+		tile_bytes_ -= tiles_.back().second->size();
+		tile_positions_.erase(tiles_.back().first);
+		tiles_.pop_back();
+	}
+	return escaped_svg;
+}
+
+std::pair<std::string_view, std::string> MapCache::GetRouteMap(const MapRenderer& map_render, const TransportCatalogue& tran_cat,
+	const FoundedRoute& route, uint32_t stop_to, number_format::Mode number_mode) const {
+	std::string svg;
+	map_render.VisualiseRouteOverlay(GetMapData(map_render, tran_cat), tran_cat, route, stop_to, svg, number_mode);
+	const size_t overlay_size = svg.size();
+	svg::CompactDocument::RenderEnd(svg);
+	// the end has no characters to escape, so it is the same at the end of the escaped map
+	std::string_view head = Get(map_render, tran_cat, number_mode);
+	head.remove_suffix(svg.size() - overlay_size);
+	std::string escaped_tail;
+	json::AppendEscaped(escaped_tail, svg);
+	return { head, std::move(escaped_tail) };
+}
+} //namespace rendering
+} //namespace transport_catalogue
\ No newline at end of file
@@ -0,0 +1,90 @@
+#pragma once
+#include "map_renderer.h"
+#include "transport_catalogue.h"
+
+#include <array>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace transport_catalogue {
+namespace rendering {
+
+// Map text ready to be written as a JSON string value, e.g. stored in the base file
+struct PrerenderedMap {
+	number_format::Mode number_mode = number_format::Mode::SHORTEST;
+	// the svg escaped by json::AppendEscaped
+	std::string escaped_svg;
+};
+
+// Map of one catalogue version. Every number mode is rendered and escaped on first use only,
+// so a Map answer is a copy of the text. Safe to use from several threads
+class MapCache {
+public:
+	static PrerenderedMap Render(const MapRenderer& map_render, const TransportCatalogue& tran_cat,
+		number_format::Mode number_mode);
+	// fragments with the text escaped by json::AppendEscaped
+	static MapFragments RenderFragments(const MapRenderer& map_render, const TransportCatalogue& tran_cat,
+		number_format::Mode number_mode);
+
+	const std::string& Get(const MapRenderer& map_render, const TransportCatalogue& tran_cat,
+		number_format::Mode number_mode) const;
+	// ignored if the map of this number mode is already there
+	void Set(PrerenderedMap&& map);
+	// escaped fragments, e.g. from the base file; the whole map of their number mode is then joined
+	// from them instead of being rendered. Ignored if the fragments of this number mode are already there
+	void Set(MapFragments&& fragments);
+
+	const MapFragments& GetFragments(const MapRenderer& map_render, const TransportCatalogue& tran_cat,
+		number_format::Mode number_mode) const;
+	// Escaped svg of the buses with these ids, in name order, and of the stops they go through.
+	// It is joined from the fragments, so it costs as much as its own text
+	std::string GetBusesMap(const MapRenderer& map_render, const TransportCatalogue& tran_cat,
+		const std::vector<uint32_t>& bus_ids, number_format::Mode number_mode) const;
+
+	// Escaped svg of a part of the map
+	std::string GetViewport(const MapRenderer& map_render, const TransportCatalogue& tran_cat,
+		const Viewport& viewport, number_format::Mode number_mode) const;
+	// Tiles are shared with the cache, which keeps the recently used ones up to MAX_TILE_BYTES of text
+	std::shared_ptr<const std::string> GetTile(const MapRenderer& map_render, const TransportCatalogue& tran_cat,
+		const MapTile& tile, number_format::Mode number_mode) const;
+	// Escaped svg of the whole map with the route drawn on top, in two parts: the cached map
+	// without its end and the overlay with the end. Only the overlay is drawn per request
+	std::pair<std::string_view, std::string> GetRouteMap(const MapRenderer& map_render, const TransportCatalogue& tran_cat,
+		const FoundedRoute& route, uint32_t stop_to, number_format::Mode number_mode) const;
+private:
+	static constexpr size_t MAX_TILE_BYTES = 64 << 20;
+
+	struct Entry {
+		std::once_flag once;
+		std::string escaped_svg;
+		std::once_flag fragments_once;
+		MapFragments fragments;
+		// the fragments are given by Set, the map is joined from them
+		bool has_fragments = false;
+	};
+
+	mutable std::array<Entry, 2> entries_;
+
+	// projected and indexed map for viewports
+	mutable std::once_flag map_data_once_;
+	mutable std::optional<MapRenderer::MapData> map_data_;
+
+	using TileList = std::list<std::pair<uint64_t, std::shared_ptr<const std::string>>>;
+
+	mutable std::mutex tiles_mutex_;
+	// number mode, z, x and y of a tile with its escaped svg, the most recently used first
+	mutable TileList tiles_;
+	mutable std::unordered_map<uint64_t, TileList::iterator> tile_positions_;
+	mutable size_t tile_bytes_ = 0;
+
+	const MapRenderer::MapData& GetMapData(const MapRenderer& map_render, const TransportCatalogue& tran_cat) const;
+};
+} //namespace rendering
+} //namespace transport_catalogue
\ No newline at end of file
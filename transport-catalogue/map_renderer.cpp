@@ -2,7 +2,13 @@
 #include "transport_catalogue.h"
 
 #include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <exception>
 #include <iterator>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
 
 namespace transport_catalogue {
 namespace rendering {
@@ -15,30 +21,28 @@ bool IsZero(double value) {
 
 class SphereProjector {
 public:
-    // points_begin  points_end       geo::Coordinates
-    template <typename PointInputIt>
-    SphereProjector(PointInputIt points_begin, PointInputIt points_end,
+    // stop_ids are indices into the coordinate arrays of CatalogueLayout
+    SphereProjector(const CatalogueLayout& layout, const std::vector<uint32_t>& stop_ids,
         double max_width, double max_height, double padding)
         : padding(padding) //
     {
         //      ,  
-        if (points_begin == points_end) {
+        if (stop_ids.empty()) {
             return;
         }
 
         //       
-        const auto [left_it, right_it] = std::minmax_element(
-            points_begin, points_end,
-            [](auto lhs, auto rhs) { return lhs->coordinates.lng < rhs->coordinates.lng; });
-        min_lon_ = (*left_it)->coordinates.lng;
-        const double max_lon = (*right_it)->coordinates.lng;
-
         //       
-        const auto [bottom_it, top_it] = std::minmax_element(
-            points_begin, points_end,
-            [](auto lhs, auto rhs) { return lhs->coordinates.lat < rhs->coordinates.lat; });
-        const double min_lat = (*bottom_it)->coordinates.lat;
-        max_lat_ = (*top_it)->coordinates.lat;
+        min_lon_ = layout.longitudes[stop_ids.front()];
+        double max_lon = min_lon_;
+        double min_lat = layout.latitudes[stop_ids.front()];
+        max_lat_ = min_lat;
+        for (const auto id : stop_ids) {
+            min_lon_ = std::min(min_lon_, layout.longitudes[id]);
+            max_lon = std::max(max_lon, layout.longitudes[id]);
+            min_lat = std::min(min_lat, layout.latitudes[id]);
+            max_lat_ = std::max(max_lat_, layout.latitudes[id]);
+        }
 
         //      x
         std::optional<double> width_zoom;
@@ -67,6 +71,18 @@ public:
         }
     }
 
+    double GetMinLon() const {
+        return min_lon_;
+    }
+
+    double GetMaxLat() const {
+        return max_lat_;
+    }
+
+    double GetZoomCoeff() const {
+        return zoom_coeff_;
+    }
+
     //        SVG-
     svg::Point operator()(geo::Coordinates coords) const {
         return {
@@ -82,17 +98,153 @@ private:
     double zoom_coeff_ = 0;
 };
 
-Polyline CreateRoute(const std::vector<const Stop*>& stops, const std::unordered_map<const Stop*, Point>& stop_to_coordinates, const TypeRoute type_route) {
-	Polyline polyline;
-    for (const auto& stop : stops) {
-        polyline.AddPoint(stop_to_coordinates.at(stop));
+double SegmentDistance(Point point, Point from, Point to) {
+    const double dx = to.x - from.x;
+    const double dy = to.y - from.y;
+    const double length2 = dx * dx + dy * dy;
+    const double t = length2 > 0 ? std::clamp(((point.x - from.x) * dx + (point.y - from.y) * dy) / length2, 0.0, 1.0) : 0.0;
+    return std::hypot(point.x - (from.x + t * dx), point.y - (from.y + t * dy));
+}
+
+// Douglas-Peucker over projected points; keeps its buffers between polylines
+class PolylineSimplifier {
+public:
+    explicit PolylineSimplifier(double tolerance)
+        : tolerance_(tolerance) {
+    }
+
+    // Marks which of the vertices point_at(0) .. point_at(count - 1) stay: both ends and every vertex
+    // farther than the tolerance from the line through the vertices kept around it
+    template <typename PointAt>
+    const std::vector<char>& Mark(size_t count, PointAt point_at) {
+        keep_.assign(count, tolerance_ <= 0);
+        if (count == 0 || tolerance_ <= 0) {
+            return keep_;
+        }
+        keep_.front() = true;
+        keep_.back() = true;
+        ranges_.clear();
+        if (count > 2) {
+            ranges_.push_back({ 0, count - 1 });
+        }
+        while (!ranges_.empty()) {
+            const auto [first, last] = ranges_.back();
+            ranges_.pop_back();
+            const Point from = point_at(first);
+            const Point to = point_at(last);
+            double max_distance = 0;
+            size_t farthest = first;
+            for (size_t i = first + 1; i < last; ++i) {
+                if (const double distance = SegmentDistance(point_at(i), from, to); distance > max_distance) {
+                    max_distance = distance;
+                    farthest = i;
+                }
+            }
+            if (max_distance > tolerance_) {
+                keep_[farthest] = true;
+                if (farthest - first > 1) {
+                    ranges_.push_back({ first, farthest });
+                }
+                if (last - farthest > 1) {
+                    ranges_.push_back({ farthest, last });
+                }
+            }
+        }
+        return keep_;
+    }
+
+private:
+    double tolerance_;
+    std::vector<char> keep_;
+    std::vector<std::pair<size_t, size_t>> ranges_;
+};
+
+void AddRoute(CompactDocument& render_doc, CompactDocument::StyleId style, const uint32_t* stops_begin, const uint32_t* stops_end,
+    const std::vector<Point>& stop_points, const TypeRoute type_route, PolylineSimplifier& simplifier) {
+    render_doc.StartPolyline(style);
+    const size_t count = stops_end - stops_begin;
+    // a line route goes back through the same vertices
+    const auto& keep = simplifier.Mark(count, [&](size_t i) {
+        return stop_points[stops_begin[i]];
+        });
+    for (size_t i = 0; i < count; ++i) {
+        if (keep[i]) {
+            render_doc.AddPoint(stop_points[stops_begin[i]]);
+        }
     }
     if (type_route == TypeRoute::line) {
-        for (auto it = std::next(stops.rbegin()); it != stops.rend(); ++it) {
-            polyline.AddPoint(stop_to_coordinates.at((*it)));
+        for (size_t i = count - 1; i-- > 0;) {
+            if (keep[i]) {
+                render_doc.AddPoint(stop_points[stops_begin[i]]);
+            }
+        }
+    }
+}
+
+// vertices of the polyline of a route: its stops, and for a line route the stops back
+size_t RouteSize(const CatalogueLayout& layout, const Bus& bus) {
+    const size_t stops = layout.bus_stop_offsets[bus.id + 1] - layout.bus_stop_offsets[bus.id];
+    return bus.type_route == TypeRoute::line ? 2 * stops - 1 : stops;
+}
+
+uint32_t RouteVertex(const CatalogueLayout& layout, const Bus& bus, size_t index) {
+    const uint32_t* stops = layout.bus_stop_ids.data() + layout.bus_stop_offsets[bus.id];
+    const size_t count = layout.bus_stop_offsets[bus.id + 1] - layout.bus_stop_offsets[bus.id];
+    return stops[index < count ? index : 2 * count - 2 - index];
+}
+
+bool Contains(const Viewport& viewport, Point point) {
+    return point.x >= viewport.min_x && point.x <= viewport.max_x && point.y >= viewport.min_y && point.y <= viewport.max_y;
+}
+
+Viewport Inflate(const Viewport& viewport, double margin) {
+    return { viewport.min_x - margin, viewport.min_y - margin, viewport.max_x + margin, viewport.max_y + margin };
+}
+
+// Liang-Barsky: clips the segment by every side of the viewport
+bool Touches(const Viewport& viewport, Point from, Point to) {
+    double enter = 0;
+    double leave = 1;
+    const auto clip = [&](double direction, double distance) {
+        if (direction == 0) {
+            return distance >= 0;
+        }
+        const double t = distance / direction;
+        if (direction < 0) {
+            enter = std::max(enter, t);
         }
+        else {
+            leave = std::min(leave, t);
+        }
+        return enter <= leave;
+    };
+    const double dx = to.x - from.x;
+    const double dy = to.y - from.y;
+    return clip(-dx, from.x - viewport.min_x) && clip(dx, viewport.max_x - from.x)
+        && clip(-dy, from.y - viewport.min_y) && clip(dy, viewport.max_y - from.y);
+}
+
+// Fills offsets and items of grid cells. visit(emit) calls emit(cell, item) for every item in every its cell
+// and is called twice: to count the items of each cell and to place them
+template <typename Item, typename Visit>
+void FillCells(size_t cells, std::vector<uint32_t>& offsets, std::vector<Item>& items, Visit visit) {
+    offsets.assign(cells + 1, 0);
+    visit([&offsets](size_t cell, const Item&) {
+        ++offsets[cell + 1];
+        });
+    for (size_t cell = 0; cell < cells; ++cell) {
+        offsets[cell + 1] += offsets[cell];
     }
-    return polyline;
+    items.resize(offsets.back());
+    std::vector<uint32_t> next(offsets.begin(), offsets.end() - 1);
+    visit([&next, &items](size_t cell, const Item& item) {
+        items[next[cell]++] = item;
+        });
+}
+
+size_t CellIndex(double coordinate, double cell_size, size_t cells) {
+    const double index = std::floor(coordinate / cell_size);
+    return index <= 0 ? 0 : std::min(cells - 1, static_cast<size_t>(index));
 }
 
 MapRenderer::MapRenderer() = default;
@@ -102,89 +254,525 @@ MapRenderer::MapRenderer(RenderSettings&& render_settings)
 {
 }
 
-Text MapRenderer::MakeRouteName(const Point& point, const std::string& name) {
-    using namespace std::literals;
-    const Text busname = Text().SetFontFamily("Verdana"s)
-        .SetFontWeight("bold"s)
-        .SetFontSize(render_settings_.bus_label_font_size)
-        .SetPosition(point)
-        .SetOffset({ render_settings_.bus_label_offset.first, render_settings_.bus_label_offset.second })
-        .SetData(name);
-    return busname;
+MapProjection MapRenderer::Project(const TransportCatalogue& tran_cat) const {
+    const auto& layout = tran_cat.GetLayout();
+    const auto& stops = layout.valid_stop_ids;
+    SphereProjector projector(layout, stops, render_settings_.width, render_settings_.height, render_settings_.padding);
+    MapProjection projection{ projector.GetMinLon(), projector.GetMaxLat(), projector.GetZoomCoeff(), stops, {} };
+    projection.stop_points.resize(layout.latitudes.size());
+    for (const auto id : stops) {
+        projection.stop_points[id] = projector({ layout.latitudes[id], layout.longitudes[id] });
+    }
+    return projection;
 }
 
-void MapRenderer::FillRenderPolylines(const std::unordered_map<const Stop*, Point>& stop_to_coordinates, std::vector<std::pair<Text, Color>>& busnames_to_draw,
-    const std::map<std::string_view, const Bus*>& busname_to_bus) {
-    using namespace std::literals;
+void MapRenderer::SetProjection(MapProjection&& projection) {
+    projection_ = std::move(projection);
+}
+
+MapRenderer::MapData MapRenderer::PrepareMap(const TransportCatalogue& tran_cat) const {
+    MapData map;
+    const auto& layout = tran_cat.GetLayout();
+    map.layout = &layout;
+    const auto& stops = layout.valid_stop_ids;
+    if (projection_ && projection_->stop_points.size() == layout.latitudes.size()) {
+        map.stop_points = projection_->stop_points;
+    }
+    else {
+        map.stop_points = Project(tran_cat).stop_points;
+    }
+
+    map.bus_labels.reserve(stops.size());
     size_t count = 0;
-    for (const auto& [busname, bus_ptr] : busname_to_bus) {
+    for (const auto& [busname, bus_ptr] : tran_cat.GetBusnameToBus()) {
         if (bus_ptr->stops.size()) {
             size_t index_color = count % render_settings_.color_palette.size();
-            render_doc_.Add(CreateRoute(bus_ptr->stops, stop_to_coordinates, bus_ptr->type_route).
-                SetStrokeWidth(render_settings_.line_width).SetStrokeLineCap(StrokeLineCap::ROUND).
-                SetStrokeLineJoin(StrokeLineJoin::ROUND).SetStrokeColor(render_settings_.color_palette[index_color]).
-                SetFillColor({}));
-
-            const Text busname_begin = MakeRouteName(stop_to_coordinates.at(bus_ptr->stops.front()), bus_ptr->name);
-            busnames_to_draw.push_back(std::make_pair(busname_begin, render_settings_.color_palette[index_color]));
+            map.routes.push_back({ bus_ptr, index_color });
 
+            const uint32_t* stops_begin = layout.bus_stop_ids.data() + layout.bus_stop_offsets[bus_ptr->id];
+            const uint32_t* stops_end = layout.bus_stop_ids.data() + layout.bus_stop_offsets[bus_ptr->id + 1];
+            map.bus_labels.push_back({ map.stop_points[*stops_begin], bus_ptr->name, index_color });
             if (bus_ptr->type_route == TypeRoute::line && bus_ptr->stops.front() != bus_ptr->stops.back()) {
-                const Text busname_end = MakeRouteName(stop_to_coordinates.at(bus_ptr->stops.back()), bus_ptr->name);
-                busnames_to_draw.push_back(std::make_pair(busname_end, render_settings_.color_palette[index_color]));
+                map.bus_labels.push_back({ map.stop_points[*std::prev(stops_end)], bus_ptr->name, index_color });
             }
             ++count;
         }
     }
+    return map;
+}
+
+void MapRenderer::IndexMap(MapData& map) const {
+    const auto& layout = *map.layout;
+    const auto& stops = layout.valid_stop_ids;
+    MapGrid& grid = map.grid;
+    grid.columns = std::min(MAX_GRID_SIDE, std::max<size_t>(1, static_cast<size_t>(std::sqrt(stops.size() / CELL_STOPS))));
+    grid.rows = grid.columns;
+    grid.cell_width = std::max(render_settings_.width, 1.0) / grid.columns;
+    grid.cell_height = std::max(render_settings_.height, 1.0) / grid.rows;
+    const auto cell_of = [&grid](Point point) {
+        return CellIndex(point.y, grid.cell_height, grid.rows) * grid.columns + CellIndex(point.x, grid.cell_width, grid.columns);
+    };
+    const size_t cells = grid.columns * grid.rows;
+
+    FillCells(cells, grid.stop_offsets, grid.stops, [&](auto emit) {
+        for (uint32_t i = 0; i < stops.size(); ++i) {
+            emit(cell_of(map.stop_points[stops[i]]), i);
+        }
+        });
+    FillCells(cells, grid.label_offsets, grid.labels, [&](auto emit) {
+        for (uint32_t i = 0; i < map.bus_labels.size(); ++i) {
+            emit(cell_of(map.bus_labels[i].position), i);
+        }
+        });
+    FillCells(cells, grid.segment_offsets, grid.segments, [&](auto emit) {
+        for (uint32_t route = 0; route < map.routes.size(); ++route) {
+            const Bus& bus = *map.routes[route].bus;
+            const size_t size = RouteSize(layout, bus);
+            for (uint32_t index = 0; index + 1 < size; ++index) {
+                const Point from = map.stop_points[RouteVertex(layout, bus, index)];
+                const Point to = map.stop_points[RouteVertex(layout, bus, index + 1)];
+                const size_t min_row = CellIndex(std::min(from.y, to.y), grid.cell_height, grid.rows);
+                const size_t max_row = CellIndex(std::max(from.y, to.y), grid.cell_height, grid.rows);
+                for (size_t row = min_row; row <= max_row; ++row) {
+                    // the part of the segment within the row, the outer rows reaching out of the map
+                    double min_x = std::min(from.x, to.x);
+                    double max_x = std::max(from.x, to.x);
+                    if (from.y != to.y) {
+                        const double low = row == 0 ? -INFINITY : row * grid.cell_height;
+                        const double high = row + 1 == grid.rows ? INFINITY : (row + 1) * grid.cell_height;
+                        const double slope = (to.x - from.x) / (to.y - from.y);
+                        const double x_low = from.x + (std::clamp(low, std::min(from.y, to.y), std::max(from.y, to.y)) - from.y) * slope;
+                        const double x_high = from.x + (std::clamp(high, std::min(from.y, to.y), std::max(from.y, to.y)) - from.y) * slope;
+                        min_x = std::min(x_low, x_high);
+                        max_x = std::max(x_low, x_high);
+                    }
+                    const size_t min_column = CellIndex(min_x, grid.cell_width, grid.columns);
+                    const size_t max_column = CellIndex(max_x, grid.cell_width, grid.columns);
+                    for (size_t column = min_column; column <= max_column; ++column) {
+                        emit(row * grid.columns + column, RouteSegment{ route, index });
+                    }
+                }
+            }
+        }
+        });
 }
 
-void MapRenderer::Render(const TransportCatalogue& tran_cat) {
+MapRenderer::MapStyles MapRenderer::AddStyles(CompactDocument& render_doc) const {
     using namespace std::literals;
-    
-    const auto stops = tran_cat.GetValidStops();
-    SphereProjector projector(stops.begin(), stops.end(), render_settings_.width, render_settings_.height, render_settings_.padding);
-    std::unordered_map<const Stop*, Point> stop_to_coordinates;
-    for (const auto& stop : stops) {
-        stop_to_coordinates[stop] = projector(stop->coordinates);
-    }
-    std::vector<std::pair<Text, Color>> busnames_to_draw;
-    busnames_to_draw.reserve(stops.size());
-
-    FillRenderPolylines(stop_to_coordinates, busnames_to_draw, tran_cat.GetBusnameToBus());
-
-    for (const auto& [busname, color] : busnames_to_draw) {
-        render_doc_.Add(Text{ busname }
-            .SetStrokeColor(render_settings_.underlayer_color)
-            .SetFillColor(render_settings_.underlayer_color)
-            .SetStrokeLineJoin(StrokeLineJoin::ROUND)
-            .SetStrokeLineCap(StrokeLineCap::ROUND)
-            .SetStrokeWidth(render_settings_.underlayer_width));
-        render_doc_.Add(Text{ busname }.SetFillColor(color));
-    }
-
-    for (const auto& stop : stops) {
-        const auto& center = stop_to_coordinates[stop];
-        render_doc_.Add(Circle().SetCenter(center).SetRadius(render_settings_.stop_radius).SetFillColor("white"s));
-    }
-
-    for (const auto& stop : stops) {
-        const auto& center = stop_to_coordinates[stop];
-        const Text stopname = Text().SetFontFamily("Verdana"s)
-            .SetFontSize(render_settings_.stop_label_font_size)
-            .SetPosition(center)
-            .SetOffset({ render_settings_.stop_label_offset.first, render_settings_.stop_label_offset.second })
-            .SetData(stop->name);
-        render_doc_.Add(Text{ stopname }
-            .SetStrokeColor(render_settings_.underlayer_color)
-            .SetFillColor(render_settings_.underlayer_color)
-            .SetStrokeLineJoin(StrokeLineJoin::ROUND)
-            .SetStrokeLineCap(StrokeLineCap::ROUND)
-            .SetStrokeWidth(render_settings_.underlayer_width));
-        render_doc_.Add(Text{ stopname }.SetFillColor("black"s));
-    }
-}
-
-void MapRenderer::VisualiseRender(std::ostream& thread) const {
-    render_doc_.Render(thread);
+    MapStyles styles;
+    styles.routes.reserve(render_settings_.color_palette.size());
+    for (const auto& color : render_settings_.color_palette) {
+        styles.routes.push_back(render_doc.AddStyle(PathStyle().SetStrokeWidth(render_settings_.line_width)
+            .SetStrokeLineCap(StrokeLineCap::ROUND).SetStrokeLineJoin(StrokeLineJoin::ROUND)
+            .SetStrokeColor(color).SetFillColor({})));
+    }
+
+    const TextStyle busname = TextStyle().SetFontFamily("Verdana"s)
+        .SetFontWeight("bold"s)
+        .SetFontSize(render_settings_.bus_label_font_size)
+        .SetOffset({ render_settings_.bus_label_offset.first, render_settings_.bus_label_offset.second });
+    styles.busname_underlayer = render_doc.AddStyle(TextStyle{ busname }
+        .SetStrokeColor(render_settings_.underlayer_color)
+        .SetFillColor(render_settings_.underlayer_color)
+        .SetStrokeLineJoin(StrokeLineJoin::ROUND)
+        .SetStrokeLineCap(StrokeLineCap::ROUND)
+        .SetStrokeWidth(render_settings_.underlayer_width));
+    styles.busnames.reserve(render_settings_.color_palette.size());
+    for (const auto& color : render_settings_.color_palette) {
+        styles.busnames.push_back(render_doc.AddStyle(TextStyle{ busname }.SetFillColor(color)));
+    }
+
+    styles.stop_circle = render_doc.AddStyle(PathStyle().SetFillColor("white"s));
+
+    const TextStyle stopname = TextStyle().SetFontFamily("Verdana"s)
+        .SetFontSize(render_settings_.stop_label_font_size)
+        .SetOffset({ render_settings_.stop_label_offset.first, render_settings_.stop_label_offset.second });
+    styles.stopname_underlayer = render_doc.AddStyle(TextStyle{ stopname }
+        .SetStrokeColor(render_settings_.underlayer_color)
+        .SetFillColor(render_settings_.underlayer_color)
+        .SetStrokeLineJoin(StrokeLineJoin::ROUND)
+        .SetStrokeLineCap(StrokeLineCap::ROUND)
+        .SetStrokeWidth(render_settings_.underlayer_width));
+    styles.stopname = render_doc.AddStyle(TextStyle{ stopname }.SetFillColor("black"s));
+    return styles;
+}
+
+size_t MapRenderer::LayerSize(const MapData& map, Layer layer) {
+    switch (layer) {
+    case Layer::ROUTES: return map.routes.size();
+    case Layer::BUS_LABELS: return map.bus_labels.size();
+    default: return map.layout->valid_stop_ids.size();
+    }
+}
+
+void MapRenderer::DrawLayer(const MapData& map, const MapStyles& styles, Layer layer, size_t begin, size_t end,
+    CompactDocument& render_doc) const {
+    const auto& layout = *map.layout;
+    PolylineSimplifier simplifier(render_settings_.polyline_tolerance);
+    for (size_t i = begin; i < end; ++i) {
+        switch (layer) {
+        case Layer::ROUTES: {
+            const Route& route = map.routes[i];
+            const uint32_t* stops_begin = layout.bus_stop_ids.data() + layout.bus_stop_offsets[route.bus->id];
+            const uint32_t* stops_end = layout.bus_stop_ids.data() + layout.bus_stop_offsets[route.bus->id + 1];
+            AddRoute(render_doc, styles.routes[route.index_color], stops_begin, stops_end, map.stop_points, route.bus->type_route,
+                simplifier);
+            break;
+        }
+        case Layer::BUS_LABELS: {
+            const BusLabel& label = map.bus_labels[i];
+            render_doc.AddText(label.position, label.busname, styles.busname_underlayer);
+            render_doc.AddText(label.position, label.busname, styles.busnames[label.index_color]);
+            break;
+        }
+        case Layer::STOP_CIRCLES:
+            render_doc.AddCircle(map.stop_points[layout.valid_stop_ids[i]], render_settings_.stop_radius, styles.stop_circle);
+            break;
+        case Layer::STOP_LABELS: {
+            const auto id = layout.valid_stop_ids[i];
+            render_doc.AddText(map.stop_points[id], layout.stop_names[id], styles.stopname_underlayer);
+            render_doc.AddText(map.stop_points[id], layout.stop_names[id], styles.stopname);
+            break;
+        }
+        }
+    }
+}
+
+CompactDocument MapRenderer::Render(const TransportCatalogue& tran_cat) const {
+    const MapData map = PrepareMap(tran_cat);
+    CompactDocument render_doc;
+    const MapStyles styles = AddStyles(render_doc);
+    for (const Layer layer : LAYERS) {
+        DrawLayer(map, styles, layer, 0, LayerSize(map, layer), render_doc);
+    }
+    return render_doc;
+}
+
+void MapRenderer::VisualiseRender(const TransportCatalogue& tran_cat, std::ostream& thread, number_format::Mode number_mode) const {
+    std::string out;
+    VisualiseRender(tran_cat, out, number_mode);
+    thread.write(out.data(), out.size());
+}
+
+void MapRenderer::VisualiseRender(const TransportCatalogue& tran_cat, std::string& out, number_format::Mode number_mode) const {
+    VisualiseRender(PrepareMap(tran_cat), out, number_mode);
+}
+
+void MapRenderer::VisualiseRender(const MapData& map, std::string& out, number_format::Mode number_mode) const {
+    struct Part {
+        Layer layer;
+        size_t begin;
+        size_t end;
+        std::string text;
+    };
+    std::vector<Part> parts;
+    for (const Layer layer : LAYERS) {
+        const size_t size = LayerSize(map, layer);
+        for (size_t begin = 0; begin < size; begin += PART_SIZE) {
+            parts.push_back({ layer, begin, std::min(size, begin + PART_SIZE), {} });
+        }
+    }
+
+    std::atomic<size_t> next_part = 0;
+    std::mutex error_mutex;
+    std::exception_ptr error;
+    const auto draw_parts = [&] {
+        try {
+            CompactDocument render_doc;
+            for (size_t i = next_part++; i < parts.size(); i = next_part++) {
+                render_doc.Clear();
+                DrawLayer(map, AddStyles(render_doc), parts[i].layer, parts[i].begin, parts[i].end, render_doc);
+                render_doc.RenderObjects(parts[i].text, number_mode);
+            }
+        }
+        catch (...) {
+            std::lock_guard guard(error_mutex);
+            error = std::current_exception();
+        }
+    };
+    std::vector<std::thread> workers;
+    const size_t threads = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), parts.size());
+    for (size_t i = 1; i < threads; ++i) {
+        workers.emplace_back(draw_parts);
+    }
+    draw_parts();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+
+    size_t size = out.size();
+    for (const auto& part : parts) {
+        size += part.text.size();
+    }
+    // and the header and the footer
+    out.reserve(size + 128);
+    CompactDocument::RenderBegin(out);
+    for (const auto& part : parts) {
+        out += part.text;
+    }
+    CompactDocument::RenderEnd(out);
+}
+
+void MapRenderer::VisualiseViewport(const MapData& map, const Viewport& viewport, std::string& out,
+    number_format::Mode number_mode) const {
+    const CompactDocument render_doc = DrawViewport(map, viewport);
+    CompactDocument::RenderBegin(out, { viewport.min_x, viewport.min_y },
+        viewport.max_x - viewport.min_x, viewport.max_y - viewport.min_y, number_mode);
+    render_doc.RenderObjects(out, number_mode);
+    CompactDocument::RenderEnd(out);
+}
+
+CompactDocument MapRenderer::DrawViewport(const MapData& map, const Viewport& viewport) const {
+    const auto& layout = *map.layout;
+    const MapGrid& grid = map.grid;
+    // a circle or a line is visible if it touches the viewport with its edge
+    const Viewport stop_viewport = Inflate(viewport, render_settings_.stop_radius);
+    const Viewport route_viewport = Inflate(viewport, render_settings_.line_width / 2);
+    const Viewport cells = Inflate(viewport, std::max(render_settings_.stop_radius, render_settings_.line_width / 2));
+    const size_t min_column = CellIndex(cells.min_x, grid.cell_width, grid.columns);
+    const size_t max_column = CellIndex(cells.max_x, grid.cell_width, grid.columns);
+    const size_t min_row = CellIndex(cells.min_y, grid.cell_height, grid.rows);
+    const size_t max_row = CellIndex(cells.max_y, grid.cell_height, grid.rows);
+
+    std::vector<uint32_t> stops;
+    std::vector<uint32_t> labels;
+    std::vector<RouteSegment> segments;
+    for (size_t row = min_row; row <= max_row; ++row) {
+        for (size_t column = min_column; column <= max_column; ++column) {
+            const size_t cell = row * grid.columns + column;
+            for (uint32_t i = grid.stop_offsets[cell]; i < grid.stop_offsets[cell + 1]; ++i) {
+                if (Contains(stop_viewport, map.stop_points[layout.valid_stop_ids[grid.stops[i]]])) {
+                    stops.push_back(grid.stops[i]);
+                }
+            }
+            for (uint32_t i = grid.label_offsets[cell]; i < grid.label_offsets[cell + 1]; ++i) {
+                if (Contains(viewport, map.bus_labels[grid.labels[i]].position)) {
+                    labels.push_back(grid.labels[i]);
+                }
+            }
+            segments.insert(segments.end(), grid.segments.begin() + grid.segment_offsets[cell],
+                grid.segments.begin() + grid.segment_offsets[cell + 1]);
+        }
+    }
+    // back to the order of the whole map
+    std::sort(stops.begin(), stops.end());
+    std::sort(labels.begin(), labels.end());
+    const auto segment_order = [](const RouteSegment& lhs, const RouteSegment& rhs) {
+        return std::pair(lhs.route, lhs.index) < std::pair(rhs.route, rhs.index);
+    };
+    std::sort(segments.begin(), segments.end(), segment_order);
+    segments.erase(std::unique(segments.begin(), segments.end(), [](const RouteSegment& lhs, const RouteSegment& rhs) {
+        return lhs.route == rhs.route && lhs.index == rhs.index;
+        }), segments.end());
+
+    segments.erase(std::remove_if(segments.begin(), segments.end(), [&](const RouteSegment& segment) {
+        const Bus& bus = *map.routes[segment.route].bus;
+        return !Touches(route_viewport, map.stop_points[RouteVertex(layout, bus, segment.index)],
+            map.stop_points[RouteVertex(layout, bus, segment.index + 1)]);
+        }), segments.end());
+
+    CompactDocument render_doc;
+    const MapStyles styles = AddStyles(render_doc);
+    // the viewport is shown at the size of the whole map
+    const double zoom = std::min(render_settings_.width / (viewport.max_x - viewport.min_x),
+        render_settings_.height / (viewport.max_y - viewport.min_y));
+    PolylineSimplifier simplifier(render_settings_.polyline_tolerance / zoom);
+    // visible segments of a route following one another make one polyline
+    for (size_t begin = 0; begin < segments.size();) {
+        size_t end = begin + 1;
+        while (end < segments.size() && segments[end].route == segments[begin].route
+            && segments[end].index == segments[end - 1].index + 1) {
+            ++end;
+        }
+        const Route& route = map.routes[segments[begin].route];
+        const uint32_t first = segments[begin].index;
+        const auto point_at = [&](size_t i) {
+            return map.stop_points[RouteVertex(layout, *route.bus, first + i)];
+        };
+        const size_t count = end - begin + 1;
+        const auto& keep = simplifier.Mark(count, point_at);
+        render_doc.StartPolyline(styles.routes[route.index_color]);
+        for (size_t i = 0; i < count; ++i) {
+            if (keep[i]) {
+                render_doc.AddPoint(point_at(i));
+            }
+        }
+        begin = end;
+    }
+    for (const uint32_t i : labels) {
+        const BusLabel& label = map.bus_labels[i];
+        render_doc.AddText(label.position, label.busname, styles.busname_underlayer);
+        render_doc.AddText(label.position, label.busname, styles.busnames[label.index_color]);
+    }
+    for (const uint32_t i : stops) {
+        render_doc.AddCircle(map.stop_points[layout.valid_stop_ids[i]], render_settings_.stop_radius, styles.stop_circle);
+    }
+    for (const uint32_t i : stops) {
+        const auto id = layout.valid_stop_ids[i];
+        render_doc.AddText(map.stop_points[id], layout.stop_names[id], styles.stopname_underlayer);
+        render_doc.AddText(map.stop_points[id], layout.stop_names[id], styles.stopname);
+    }
+    return render_doc;
+}
+
+raster::Image MapRenderer::RasterizeViewport(const MapData& map, const Viewport& viewport,
+    raster::RasterOptions options) const {
+    using namespace std::literals;
+    const double width = viewport.max_x - viewport.min_x;
+    const double height = viewport.max_y - viewport.min_y;
+    if (!(width > 0 && height > 0) || options.width == 0) {
+        throw std::invalid_argument("Empty raster viewport!"s);
+    }
+    options.view_min = { viewport.min_x, viewport.min_y };
+    options.scale = options.width / width;
+    options.height = std::max<size_t>(1, static_cast<size_t>(std::lround(height * options.scale)));
+    return raster::Rasterize(DrawViewport(map, viewport), options);
+}
+
+Viewport MapRenderer::GetTileViewport(const MapTile& tile) const {
+    const double tiles = std::ldexp(1.0, static_cast<int>(tile.z));
+    const double width = render_settings_.width / tiles;
+    const double height = render_settings_.height / tiles;
+    return { tile.x * width, tile.y * height, (tile.x + 1) * width, (tile.y + 1) * height };
+}
+
+MapFragments MapRenderer::RenderFragments(const MapData& map, number_format::Mode number_mode) const {
+    const auto& layout = *map.layout;
+    CompactDocument render_doc;
+    const MapStyles styles = AddStyles(render_doc);
+    for (const Layer layer : LAYERS) {
+        DrawLayer(map, styles, layer, 0, LayerSize(map, layer), render_doc);
+    }
+    std::string svg;
+    std::vector<size_t> object_ends;
+    render_doc.RenderObjects(svg, number_mode, &object_ends);
+
+    // [begin, end) in svg of the objects of every bus and every stop
+    const size_t buses = layout.bus_stop_offsets.size() - 1;
+    const size_t stops = layout.stop_names.size();
+    std::vector<std::pair<size_t, size_t>> routes(buses);
+    std::vector<std::pair<size_t, size_t>> labels(buses);
+    std::vector<std::pair<size_t, size_t>> circles(stops);
+    std::vector<std::pair<size_t, size_t>> stop_labels(stops);
+    size_t object = 0;
+    // takes the next count objects
+    const auto take = [&](size_t count) {
+        const size_t begin = object == 0 ? 0 : object_ends[object - 1];
+        object += count;
+        return std::pair(begin, object_ends[object - 1]);
+    };
+    for (const Route& route : map.routes) {
+        routes[route.bus->id] = take(1);
+    }
+    // labels of a bus follow one another, two texts each
+    for (size_t i = 0, label = 0; i < map.routes.size(); ++i) {
+        size_t count = 0;
+        while (label < map.bus_labels.size() && map.bus_labels[label].busname == map.routes[i].bus->name) {
+            ++label;
+            ++count;
+        }
+        labels[map.routes[i].bus->id] = take(2 * count);
+    }
+    for (const auto id : layout.valid_stop_ids) {
+        circles[id] = take(1);
+    }
+    for (const auto id : layout.valid_stop_ids) {
+        stop_labels[id] = take(2);
+    }
+
+    MapFragments fragments;
+    fragments.number_mode = number_mode;
+    fragments.text.reserve(svg.size());
+    const auto append = [&](const std::vector<std::pair<size_t, size_t>>& ranges, std::vector<uint64_t>& offsets) {
+        offsets.reserve(ranges.size() + 1);
+        offsets.push_back(fragments.text.size());
+        for (const auto& [begin, end] : ranges) {
+            fragments.text.append(svg, begin, end - begin);
+            offsets.push_back(fragments.text.size());
+        }
+    };
+    append(routes, fragments.route_offsets);
+    append(labels, fragments.label_offsets);
+    append(circles, fragments.circle_offsets);
+    append(stop_labels, fragments.stop_label_offsets);
+    return fragments;
+}
+
+void MapRenderer::VisualiseRouteOverlay(const MapData& map, const TransportCatalogue& tran_cat, const FoundedRoute& route,
+    uint32_t stop_to, std::string& out, number_format::Mode number_mode) const {
+    using namespace std::literals;
+    const auto& layout = *map.layout;
+    CompactDocument render_doc;
+    const auto add_route_style = [&render_doc](const Color& color, double width) {
+        return render_doc.AddStyle(PathStyle().SetStrokeLineCap(StrokeLineCap::ROUND).SetStrokeLineJoin(StrokeLineJoin::ROUND)
+            .SetFillColor({}).SetStrokeColor(color).SetStrokeWidth(width));
+    };
+    const auto halo = add_route_style(render_settings_.underlayer_color,
+        render_settings_.line_width + 2 * render_settings_.underlayer_width);
+    const auto transfer = render_doc.AddStyle(PathStyle().SetFillColor("white"s).SetStrokeColor("black"s)
+        .SetStrokeWidth(render_settings_.stop_radius / 2));
+
+    // a ride is the vertices [first, first + span] of the polyline of the route
+    struct Ride {
+        const Route* route;
+        size_t first;
+        size_t span;
+    };
+    std::vector<Ride> rides;
+    std::vector<uint32_t> transfers;
+    uint32_t stop = stop_to;
+    const auto& items = route.elements;
+    for (size_t i = 0; i < items.size(); ++i) {
+        if (items[i]->type == ActionType::WAIT) {
+            stop = static_cast<uint32_t>(tran_cat.FindStop(items[i]->name)->id);
+            transfers.push_back(stop);
+            continue;
+        }
+        // the ride ends where the next wait is or at the end of the route
+        const uint32_t next_stop = i + 1 < items.size() && items[i + 1]->type == ActionType::WAIT
+            ? static_cast<uint32_t>(tran_cat.FindStop(items[i + 1]->name)->id) : stop_to;
+        const size_t span = items[i]->span_count.value();
+        // routes are in name order
+        const auto it = std::lower_bound(map.routes.begin(), map.routes.end(), items[i]->name,
+            [](const Route& lhs, std::string_view busname) {
+                return lhs.bus->name < busname;
+            });
+        if (it != map.routes.end() && it->bus->name == items[i]->name) {
+            const size_t size = RouteSize(layout, *it->bus);
+            for (size_t first = 0; first + span < size; ++first) {
+                if (RouteVertex(layout, *it->bus, first) == stop && RouteVertex(layout, *it->bus, first + span) == next_stop) {
+                    rides.push_back({ &*it, first, span });
+                    break;
+                }
+            }
+        }
+        stop = next_stop;
+    }
+    // a route from a stop to itself is empty and shows nothing
+    if (!items.empty()) {
+        transfers.push_back(stop_to);
+    }
+
+    for (const Ride& ride : rides) {
+        render_doc.StartPolyline(halo);
+        for (size_t i = ride.first; i <= ride.first + ride.span; ++i) {
+            render_doc.AddPoint(map.stop_points[RouteVertex(layout, *ride.route->bus, i)]);
+        }
+    }
+    for (const Ride& ride : rides) {
+        render_doc.StartPolyline(add_route_style(render_settings_.color_palette[ride.route->index_color],
+            render_settings_.line_width));
+        for (size_t i = ride.first; i <= ride.first + ride.span; ++i) {
+            render_doc.AddPoint(map.stop_points[RouteVertex(layout, *ride.route->bus, i)]);
+        }
+    }
+    for (const uint32_t id : transfers) {
+        render_doc.AddCircle(map.stop_points[id], render_settings_.stop_radius, transfer);
+    }
+    render_doc.RenderObjects(out, number_mode);
 }
 
 const RenderSettings& MapRenderer::GetRenderSettings() const {
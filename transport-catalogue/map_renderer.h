@@ -1,7 +1,12 @@
 #pragma once
+#include "raster.h"
 #include "svg.h"
 #include "transport_catalogue.h"
 
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
 #include <utility>
 #include <vector>
 
@@ -21,26 +26,172 @@ struct RenderSettings {
 	svg::Color underlayer_color;
 	double underlayer_width;
 	std::vector<svg::Color> color_palette;
+	// Bus lines are simplified: vertices closer than this many pixels to the simplified line are dropped.
+	// A viewport is simplified at its own zoom. 0 keeps every vertex
+	double polyline_tolerance = 0;
 };
+// Part of the map, in svg coordinates of the whole map
+struct Viewport {
+	double min_x = 0;
+	double min_y = 0;
+	double max_x = 0;
+	double max_y = 0;
+};
+
+// The map rectangle is cut into 2^z x 2^z tiles; x goes right and y goes down from the tile 0/0 at the top left
+struct MapTile {
+	static constexpr uint32_t MAX_ZOOM = 24;
+
+	uint32_t z = 0;
+	uint32_t x = 0;
+	uint32_t y = 0;
+};
+
+// Stops projected to the map, e.g. by make_base: a map of the same catalogue starts from them
+struct MapProjection {
+	double min_lon = 0;
+	double max_lat = 0;
+	double zoom_coeff = 0;
+	// stops passed by at least one bus, sorted by name
+	std::vector<uint32_t> valid_stop_ids;
+	// by stop id, the stops not in valid_stop_ids are at 0, 0
+	std::vector<svg::Point> stop_points;
+};
+
+// Svg text of the map objects of every bus and every stop, each in the order of the whole map.
+// The route of the bus with id b is text[route_offsets[b], route_offsets[b + 1]), its labels are
+// text[label_offsets[b], label_offsets[b + 1]); circles and labels of stops are found by stop id the same way.
+// A bus without stops and a stop without buses have no text
+struct MapFragments {
+	number_format::Mode number_mode = number_format::Mode::SHORTEST;
+	std::string text;
+	std::vector<uint64_t> route_offsets;
+	std::vector<uint64_t> label_offsets;
+	std::vector<uint64_t> circle_offsets;
+	std::vector<uint64_t> stop_label_offsets;
+};
+
 class MapRenderer {
 public:
+	struct BusLabel {
+		svg::Point position;
+		std::string_view busname;
+		size_t index_color;
+	};
+
+	struct Route {
+		const Bus* bus;
+		size_t index_color;
+	};
+
+	// segment from the vertex index to index + 1 of the polyline of routes[route]
+	struct RouteSegment {
+		uint32_t route;
+		uint32_t index;
+	};
+
+	// Uniform grid over the map; items of cell c are items[offsets[c] .. offsets[c + 1]).
+	// A stop and a label are in the cell of their point, a segment is in every cell it crosses
+	struct MapGrid {
+		size_t columns = 0;
+		size_t rows = 0;
+		double cell_width = 0;
+		double cell_height = 0;
+		// positions in valid_stop_ids
+		std::vector<uint32_t> stop_offsets;
+		std::vector<uint32_t> stops;
+		// indices in bus_labels
+		std::vector<uint32_t> label_offsets;
+		std::vector<uint32_t> labels;
+		std::vector<uint32_t> segment_offsets;
+		std::vector<RouteSegment> segments;
+	};
+
+	// projected stops and everything the map is drawn from; only read while drawing
+	struct MapData {
+		const CatalogueLayout* layout;
+		// by stop id
+		std::vector<svg::Point> stop_points;
+		// buses with stops, in name order
+		std::vector<Route> routes;
+		std::vector<BusLabel> bus_labels;
+		// filled by IndexMap
+		MapGrid grid;
+	};
+
 	explicit MapRenderer();
 	explicit MapRenderer(RenderSettings&& render_settings);
-	void Render(const TransportCatalogue& tran_cat);
-	void VisualiseRender(std::ostream& thread) const;
+	svg::CompactDocument Render(const TransportCatalogue& tran_cat) const;
+	void VisualiseRender(const TransportCatalogue& tran_cat, std::ostream& thread,
+		number_format::Mode number_mode = number_format::Mode::SHORTEST) const;
+	// Appends the svg to out. Every layer is cut into parts of PART_SIZE objects; the parts are drawn
+	// and rendered on up to hardware_concurrency threads and joined in z-order
+	void VisualiseRender(const TransportCatalogue& tran_cat, std::string& out,
+		number_format::Mode number_mode = number_format::Mode::SHORTEST) const;
+	void VisualiseRender(const MapData& map, std::string& out,
+		number_format::Mode number_mode = number_format::Mode::SHORTEST) const;
+
+	MapProjection Project(const TransportCatalogue& tran_cat) const;
+	// the projection of the catalogue the map is drawn for, so PrepareMap does not project it again
+	void SetProjection(MapProjection&& projection);
+	MapData PrepareMap(const TransportCatalogue& tran_cat) const;
+	// fills map.grid for VisualiseViewport
+	void IndexMap(MapData& map) const;
+	// Appends the svg of the objects touching the viewport, with the viewport as its viewBox.
+	// Objects are found through the grid, so the cost depends on what is visible, not on the map size
+	void VisualiseViewport(const MapData& map, const Viewport& viewport, std::string& out,
+		number_format::Mode number_mode = number_format::Mode::SHORTEST) const;
+	// the objects VisualiseViewport renders
+	svg::CompactDocument DrawViewport(const MapData& map, const Viewport& viewport) const;
+	// Raster image of the viewport drawn by DrawViewport, options.width pixels wide and as high as the viewport
+	// proportions ask; view_min, scale and height of the options are set from the viewport
+	raster::Image RasterizeViewport(const MapData& map, const Viewport& viewport, raster::RasterOptions options) const;
+	Viewport GetTileViewport(const MapTile& tile) const;
+	// The objects of the whole map cut by bus and by stop: a map of some buses is joined from them
+	MapFragments RenderFragments(const MapData& map, number_format::Mode number_mode = number_format::Mode::SHORTEST) const;
+	// Appends the svg objects, without the document begin and end, that mark the route on top of the map:
+	// every bus ride as a line with a halo and the stops where the route changes buses.
+	// The cost depends on the route and the buses it rides, not on the map size
+	void VisualiseRouteOverlay(const MapData& map, const TransportCatalogue& tran_cat, const FoundedRoute& route,
+		uint32_t stop_to, std::string& out, number_format::Mode number_mode = number_format::Mode::SHORTEST) const;
 
 	// for serialization
 	const RenderSettings& GetRenderSettings() const;
 
 protected:
-	void FillRenderPolylines(const std::unordered_map<const Stop*, svg::Point>& stop_to_coordinates, std::vector<std::pair<svg::Text, svg::Color>>& busnames_to_draw,
-		const std::map<std::string_view, const Bus*>& busname_to_bus);
-	svg::Text MakeRouteName(const svg::Point& point, const std::string& name);
+	// in z-order
+	enum class Layer {
+		ROUTES,
+		BUS_LABELS,
+		STOP_CIRCLES,
+		STOP_LABELS
+	};
+	static constexpr Layer LAYERS[] = { Layer::ROUTES, Layer::BUS_LABELS, Layer::STOP_CIRCLES, Layer::STOP_LABELS };
+
+	// styles of every kind of object on the map, added to one document
+	struct MapStyles {
+		std::vector<svg::CompactDocument::StyleId> routes;
+		svg::CompactDocument::StyleId busname_underlayer;
+		std::vector<svg::CompactDocument::StyleId> busnames;
+		svg::CompactDocument::StyleId stop_circle;
+		svg::CompactDocument::StyleId stopname_underlayer;
+		svg::CompactDocument::StyleId stopname;
+	};
+
+	MapStyles AddStyles(svg::CompactDocument& render_doc) const;
+	static size_t LayerSize(const MapData& map, Layer layer);
+	// draws the objects [begin, end) of the layer
+	void DrawLayer(const MapData& map, const MapStyles& styles, Layer layer, size_t begin, size_t end,
+		svg::CompactDocument& render_doc) const;
 
 private:
-	RenderSettings render_settings_;
+	static constexpr size_t PART_SIZE = 4096;
+	// stops per grid cell on average
+	static constexpr size_t CELL_STOPS = 4;
+	static constexpr size_t MAX_GRID_SIDE = 1024;
 
-	svg::Document render_doc_;
+	RenderSettings render_settings_;
+	std::optional<MapProjection> projection_;
 };
 } //namespace rendering
 } //namespace transport_catalogue
\ No newline at end of file
@@ -0,0 +1,28 @@
+#include "number_format.h"
+
+#include <charconv>
+
+namespace number_format {
+
+char* Format(char* buffer, double value, Mode mode) {
+    const auto result = mode == Mode::SHORTEST
+        ? std::to_chars(buffer, buffer + MAX_SIZE, value)
+        : std::to_chars(buffer, buffer + MAX_SIZE, value, std::chars_format::general, 6);
+    return result.ptr;
+}
+
+char* Format(char* buffer, int value) {
+    return std::to_chars(buffer, buffer + MAX_SIZE, value).ptr;
+}
+
+void Write(std::ostream& out, double value, Mode mode) {
+    char buffer[MAX_SIZE];
+    out.write(buffer, Format(buffer, value, mode) - buffer);
+}
+
+void Write(std::ostream& out, int value) {
+    char buffer[MAX_SIZE];
+    out.write(buffer, Format(buffer, value) - buffer);
+}
+
+}  // namespace number_format
\ No newline at end of file
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <iostream>
+
+namespace number_format {
+
+enum class Mode {
+    // shortest text that reads back to the same double
+    SHORTEST,
+    // what std::ostream << double prints with default flags: %g, 6 significant digits
+    STREAM_COMPATIBLE
+};
+
+// enough for "-2.2250738585072014e-308" and for any int
+inline constexpr size_t MAX_SIZE = 32;
+
+// Locale-free std::to_chars output into a buffer of MAX_SIZE chars; returns the end of the text
+char* Format(char* buffer, double value, Mode mode);
+char* Format(char* buffer, int value);
+
+// The same, written to the stream without going through its num_put
+void Write(std::ostream& out, double value, Mode mode);
+void Write(std::ostream& out, int value);
+
+}  // namespace number_format
\ No newline at end of file
@@ -0,0 +1,866 @@
+#include "raster.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <exception>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+namespace raster {
+using namespace std::literals;
+
+namespace {
+struct NamedColor {
+    std::string_view name;
+    uint32_t rgb;
+};
+
+// CSS colour names, sorted for the binary search
+constexpr NamedColor NAMED_COLORS[] = {
+    { "aliceblue"sv, 0xF0F8FF }, { "antiquewhite"sv, 0xFAEBD7 }, { "aqua"sv, 0x00FFFF },
+    { "aquamarine"sv, 0x7FFFD4 }, { "azure"sv, 0xF0FFFF }, { "beige"sv, 0xF5F5DC }, { "bisque"sv, 0xFFE4C4 },
+    { "black"sv, 0x000000 }, { "blanchedalmond"sv, 0xFFEBCD }, { "blue"sv, 0x0000FF },
+    { "blueviolet"sv, 0x8A2BE2 }, { "brown"sv, 0xA52A2A }, { "burlywood"sv, 0xDEB887 },
+    { "cadetblue"sv, 0x5F9EA0 }, { "chartreuse"sv, 0x7FFF00 }, { "chocolate"sv, 0xD2691E },
+    { "coral"sv, 0xFF7F50 }, { "cornflowerblue"sv, 0x6495ED }, { "cornsilk"sv, 0xFFF8DC },
+    { "crimson"sv, 0xDC143C }, { "cyan"sv, 0x00FFFF }, { "darkblue"sv, 0x00008B }, { "darkcyan"sv, 0x008B8B },
+    { "darkgoldenrod"sv, 0xB8860B }, { "darkgray"sv, 0xA9A9A9 }, { "darkgreen"sv, 0x006400 },
+    { "darkgrey"sv, 0xA9A9A9 }, { "darkkhaki"sv, 0xBDB76B }, { "darkmagenta"sv, 0x8B008B },
+    { "darkolivegreen"sv, 0x556B2F }, { "darkorange"sv, 0xFF8C00 }, { "darkorchid"sv, 0x9932CC },
+    { "darkred"sv, 0x8B0000 }, { "darksalmon"sv, 0xE9967A }, { "darkseagreen"sv, 0x8FBC8F },
+    { "darkslateblue"sv, 0x483D8B }, { "darkslategray"sv, 0x2F4F4F }, { "darkslategrey"sv, 0x2F4F4F },
+    { "darkturquoise"sv, 0x00CED1 }, { "darkviolet"sv, 0x9400D3 }, { "deeppink"sv, 0xFF1493 },
+    { "deepskyblue"sv, 0x00BFFF }, { "dimgray"sv, 0x696969 }, { "dimgrey"sv, 0x696969 },
+    { "dodgerblue"sv, 0x1E90FF }, { "firebrick"sv, 0xB22222 }, { "floralwhite"sv, 0xFFFAF0 },
+    { "forestgreen"sv, 0x228B22 }, { "fuchsia"sv, 0xFF00FF }, { "gainsboro"sv, 0xDCDCDC },
+    { "ghostwhite"sv, 0xF8F8FF }, { "gold"sv, 0xFFD700 }, { "goldenrod"sv, 0xDAA520 }, { "gray"sv, 0x808080 },
+    { "green"sv, 0x008000 }, { "greenyellow"sv, 0xADFF2F }, { "grey"sv, 0x808080 },
+    { "honeydew"sv, 0xF0FFF0 }, { "hotpink"sv, 0xFF69B4 }, { "indianred"sv, 0xCD5C5C },
+    { "indigo"sv, 0x4B0082 }, { "ivory"sv, 0xFFFFF0 }, { "khaki"sv, 0xF0E68C }, { "lavender"sv, 0xE6E6FA },
+    { "lavenderblush"sv, 0xFFF0F5 }, { "lawngreen"sv, 0x7CFC00 }, { "lemonchiffon"sv, 0xFFFACD },
+    { "lightblue"sv, 0xADD8E6 }, { "lightcoral"sv, 0xF08080 }, { "lightcyan"sv, 0xE0FFFF },
+    { "lightgoldenrodyellow"sv, 0xFAFAD2 }, { "lightgray"sv, 0xD3D3D3 }, { "lightgreen"sv, 0x90EE90 },
+    { "lightgrey"sv, 0xD3D3D3 }, { "lightpink"sv, 0xFFB6C1 }, { "lightsalmon"sv, 0xFFA07A },
+    { "lightseagreen"sv, 0x20B2AA }, { "lightskyblue"sv, 0x87CEFA }, { "lightslategray"sv, 0x778899 },
+    { "lightslategrey"sv, 0x778899 }, { "lightsteelblue"sv, 0xB0C4DE }, { "lightyellow"sv, 0xFFFFE0 },
+    { "lime"sv, 0x00FF00 }, { "limegreen"sv, 0x32CD32 }, { "linen"sv, 0xFAF0E6 }, { "magenta"sv, 0xFF00FF },
+    { "maroon"sv, 0x800000 }, { "mediumaquamarine"sv, 0x66CDAA }, { "mediumblue"sv, 0x0000CD },
+    { "mediumorchid"sv, 0xBA55D3 }, { "mediumpurple"sv, 0x9370DB }, { "mediumseagreen"sv, 0x3CB371 },
+    { "mediumslateblue"sv, 0x7B68EE }, { "mediumspringgreen"sv, 0x00FA9A }, { "mediumturquoise"sv, 0x48D1CC },
+    { "mediumvioletred"sv, 0xC71585 }, { "midnightblue"sv, 0x191970 }, { "mintcream"sv, 0xF5FFFA },
+    { "mistyrose"sv, 0xFFE4E1 }, { "moccasin"sv, 0xFFE4B5 }, { "navajowhite"sv, 0xFFDEAD },
+    { "navy"sv, 0x000080 }, { "oldlace"sv, 0xFDF5E6 }, { "olive"sv, 0x808000 }, { "olivedrab"sv, 0x6B8E23 },
+    { "orange"sv, 0xFFA500 }, { "orangered"sv, 0xFF4500 }, { "orchid"sv, 0xDA70D6 },
+    { "palegoldenrod"sv, 0xEEE8AA }, { "palegreen"sv, 0x98FB98 }, { "paleturquoise"sv, 0xAFEEEE },
+    { "palevioletred"sv, 0xDB7093 }, { "papayawhip"sv, 0xFFEFD5 }, { "peachpuff"sv, 0xFFDAB9 },
+    { "peru"sv, 0xCD853F }, { "pink"sv, 0xFFC0CB }, { "plum"sv, 0xDDA0DD }, { "powderblue"sv, 0xB0E0E6 },
+    { "purple"sv, 0x800080 }, { "rebeccapurple"sv, 0x663399 }, { "red"sv, 0xFF0000 },
+    { "rosybrown"sv, 0xBC8F8F }, { "royalblue"sv, 0x4169E1 }, { "saddlebrown"sv, 0x8B4513 },
+    { "salmon"sv, 0xFA8072 }, { "sandybrown"sv, 0xF4A460 }, { "seagreen"sv, 0x2E8B57 },
+    { "seashell"sv, 0xFFF5EE }, { "sienna"sv, 0xA0522D }, { "silver"sv, 0xC0C0C0 }, { "skyblue"sv, 0x87CEEB },
+    { "slateblue"sv, 0x6A5ACD }, { "slategray"sv, 0x708090 }, { "slategrey"sv, 0x708090 },
+    { "snow"sv, 0xFFFAFA }, { "springgreen"sv, 0x00FF7F }, { "steelblue"sv, 0x4682B4 }, { "tan"sv, 0xD2B48C },
+    { "teal"sv, 0x008080 }, { "thistle"sv, 0xD8BFD8 }, { "tomato"sv, 0xFF6347 }, { "turquoise"sv, 0x40E0D0 },
+    { "violet"sv, 0xEE82EE }, { "wheat"sv, 0xF5DEB3 }, { "white"sv, 0xFFFFFF }, { "whitesmoke"sv, 0xF5F5F5 },
+    { "yellow"sv, 0xFFFF00 }, { "yellowgreen"sv, 0x9ACD32 }
+};
+
+int HexDigit(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+std::optional<Rgba8> ParseColor(std::string_view text) {
+    if (!text.empty() && text[0] == '#') {
+        text.remove_prefix(1);
+        if (text.size() != 3 && text.size() != 6) {
+            return std::nullopt;
+        }
+        std::array<int, 6> digits{};
+        for (size_t i = 0; i < text.size(); ++i) {
+            digits[i] = HexDigit(text[i]);
+            if (digits[i] < 0) {
+                return std::nullopt;
+            }
+        }
+        if (text.size() == 3) {
+            return Rgba8{ static_cast<uint8_t>(digits[0] * 17), static_cast<uint8_t>(digits[1] * 17),
+                static_cast<uint8_t>(digits[2] * 17), 255 };
+        }
+        return Rgba8{ static_cast<uint8_t>(digits[0] * 16 + digits[1]), static_cast<uint8_t>(digits[2] * 16 + digits[3]),
+            static_cast<uint8_t>(digits[4] * 16 + digits[5]), 255 };
+    }
+    // names are case-insensitive and none of them is longer than this
+    char name[24];
+    if (text.size() > sizeof(name)) {
+        return std::nullopt;
+    }
+    std::transform(text.begin(), text.end(), name, [](char c) {
+        return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+        });
+    const std::string_view lower(name, text.size());
+    const auto it = std::lower_bound(std::begin(NAMED_COLORS), std::end(NAMED_COLORS), lower,
+        [](const NamedColor& color, std::string_view value) {
+            return color.name < value;
+        });
+    if (it == std::end(NAMED_COLORS) || it->name != lower) {
+        return std::nullopt;
+    }
+    return Rgba8{ static_cast<uint8_t>(it->rgb >> 16), static_cast<uint8_t>(it->rgb >> 8 & 0xFF),
+        static_cast<uint8_t>(it->rgb & 0xFF), 255 };
+}
+
+// A shape in pixels. The pixels of one shape are found per row as spans, merged and blended once
+struct Shape {
+    enum class Kind : uint8_t {
+        // segments of points [first, last), radius is half the stroke width
+        POLYLINE,
+        // centre at points[first]
+        DISK,
+        // centre at points[first], between inner_radius and radius
+        RING,
+        BOX,
+    };
+
+    Kind kind;
+    Rgba8 color;
+    uint32_t first = 0;
+    uint32_t last = 0;
+    double radius = 0;
+    double inner_radius = 0;
+    double min_x = 0;
+    double min_y = 0;
+    double max_x = 0;
+    double max_y = 0;
+};
+
+// a shape or one segment of a polyline, in the rows [row_begin, row_end) of the image
+struct Piece {
+    uint32_t shape;
+    uint32_t segment;
+    uint32_t row_begin;
+    uint32_t row_end;
+};
+
+// columns [begin, end) of one row
+struct Span {
+    int64_t begin;
+    int64_t end;
+};
+
+// Turns the document objects into shapes in pixels
+class ShapeCollector {
+public:
+    explicit ShapeCollector(const RasterOptions& options)
+        : options_(options) {
+    }
+
+    void Circle(svg::Point center, double radius, const svg::PathStyle& style) {
+        const svg::Point pixel = ToPixel(center);
+        radius *= options_.scale;
+        // the fill of svg is black by default
+        const std::optional<Rgba8> fill = style.GetFillColor() ? ToRgba(*style.GetFillColor()) : Rgba8{ 0, 0, 0, 255 };
+        if (fill && radius > 0) {
+            AddRound(Shape::Kind::DISK, *fill, pixel, radius, 0);
+        }
+        const double half_width = GetHalfStrokeWidth(style);
+        if (const auto stroke = GetStrokeColor(style); stroke && half_width > 0) {
+            AddRound(Shape::Kind::RING, *stroke, pixel, radius + half_width, radius - half_width);
+        }
+    }
+
+    void Polyline(const svg::Point* first, const svg::Point* last, const svg::PathStyle& style) {
+        const double half_width = GetHalfStrokeWidth(style);
+        const auto stroke = GetStrokeColor(style);
+        if (!stroke || half_width <= 0 || first == last) {
+            return;
+        }
+        Shape shape{ Shape::Kind::POLYLINE, *stroke };
+        shape.first = static_cast<uint32_t>(points_.size());
+        shape.radius = half_width;
+        shape.min_x = shape.min_y = std::numeric_limits<double>::max();
+        shape.max_x = shape.max_y = std::numeric_limits<double>::lowest();
+        for (const svg::Point* point = first; point != last; ++point) {
+            const svg::Point pixel = ToPixel(*point);
+            points_.push_back(pixel);
+            shape.min_x = std::min(shape.min_x, pixel.x - half_width);
+            shape.min_y = std::min(shape.min_y, pixel.y - half_width);
+            shape.max_x = std::max(shape.max_x, pixel.x + half_width);
+            shape.max_y = std::max(shape.max_y, pixel.y + half_width);
+        }
+        shape.last = static_cast<uint32_t>(points_.size());
+        shapes_.push_back(shape);
+    }
+
+    void Text(svg::Point position, std::string_view data, const svg::TextStyle& style) {
+        if (!options_.label_boxes) {
+            return;
+        }
+        // an entity and a multibyte character are one character
+        size_t characters = 0;
+        for (size_t i = 0; i < data.size(); ++i) {
+            if (data[i] == '&') {
+                i = std::min(data.size(), data.find(';', i));
+            }
+            else if ((static_cast<uint8_t>(data[i]) & 0xC0) == 0x80) {
+                continue;
+            }
+            ++characters;
+        }
+        if (characters == 0) {
+            return;
+        }
+        const double size = style.GetFontSize();
+        const svg::Point offset = style.GetOffset();
+        const svg::Point top_left = ToPixel({ position.x + offset.x, position.y + offset.y - 0.8 * size });
+        const svg::Point bottom_right = ToPixel({ position.x + offset.x + 0.6 * size * characters,
+            position.y + offset.y + 0.2 * size });
+        // the stroke is a box grown by half its width under the fill
+        const double half_width = GetHalfStrokeWidth(style);
+        if (const auto stroke = GetStrokeColor(style); stroke && half_width > 0) {
+            AddBox(*stroke, top_left, bottom_right, half_width);
+        }
+        const std::optional<Rgba8> fill = style.GetFillColor() ? ToRgba(*style.GetFillColor()) : Rgba8{ 0, 0, 0, 255 };
+        if (fill) {
+            AddBox(*fill, top_left, bottom_right, 0);
+        }
+    }
+
+    const std::vector<Shape>& GetShapes() const {
+        return shapes_;
+    }
+
+    const std::vector<svg::Point>& GetPoints() const {
+        return points_;
+    }
+private:
+    const RasterOptions& options_;
+    std::vector<Shape> shapes_;
+    std::vector<svg::Point> points_;
+
+    svg::Point ToPixel(svg::Point point) const {
+        return { (point.x - options_.view_min.x) * options_.scale, (point.y - options_.view_min.y) * options_.scale };
+    }
+
+    template <typename Style>
+    double GetHalfStrokeWidth(const Style& style) const {
+        return style.GetStrokeWidth() ? *style.GetStrokeWidth() * options_.scale / 2 : 0;
+    }
+
+    template <typename Style>
+    static std::optional<Rgba8> GetStrokeColor(const Style& style) {
+        return style.GetStrokeColor() ? ToRgba(*style.GetStrokeColor()) : std::nullopt;
+    }
+
+    void AddRound(Shape::Kind kind, Rgba8 color, svg::Point center, double radius, double inner_radius) {
+        Shape shape{ kind, color };
+        shape.first = static_cast<uint32_t>(points_.size());
+        shape.radius = radius;
+        shape.inner_radius = inner_radius;
+        shape.min_x = center.x - radius;
+        shape.min_y = center.y - radius;
+        shape.max_x = center.x + radius;
+        shape.max_y = center.y + radius;
+        points_.push_back(center);
+        shapes_.push_back(shape);
+    }
+
+    void AddBox(Rgba8 color, svg::Point top_left, svg::Point bottom_right, double margin) {
+        Shape shape{ Shape::Kind::BOX, color };
+        shape.min_x = top_left.x - margin;
+        shape.min_y = top_left.y - margin;
+        shape.max_x = bottom_right.x + margin;
+        shape.max_y = bottom_right.y + margin;
+        shapes_.push_back(shape);
+    }
+};
+
+// rows [begin, end) whose pixel centres are in [min_y, max_y]
+std::pair<int64_t, int64_t> CoveredRange(double min, double max, size_t size) {
+    const double begin = std::max(0.0, std::ceil(min - 0.5));
+    const double end = std::min(static_cast<double>(size), std::floor(max - 0.5) + 1);
+    if (!(begin < end)) {
+        return { 0, 0 };
+    }
+    return { static_cast<int64_t>(begin), static_cast<int64_t>(end) };
+}
+
+void AddInterval(std::vector<Span>& spans, double min_x, double max_x, size_t width) {
+    const auto [begin, end] = CoveredRange(min_x, max_x, width);
+    if (begin < end) {
+        spans.push_back({ begin, end });
+    }
+}
+
+// x of the disk at the row y, if it crosses it
+bool DiskInterval(svg::Point center, double radius, double y, double& min_x, double& max_x) {
+    const double dy = y - center.y;
+    if (std::abs(dy) > radius) {
+        return false;
+    }
+    const double half = std::sqrt(radius * radius - dy * dy);
+    min_x = center.x - half;
+    max_x = center.x + half;
+    return true;
+}
+
+// x of the points at the row y not farther than radius from the segment; the capsule is convex,
+// so they are the hull of the end disks and the body rectangle
+bool CapsuleInterval(svg::Point a, svg::Point b, double radius, double y, double& min_x, double& max_x) {
+    min_x = std::numeric_limits<double>::max();
+    max_x = std::numeric_limits<double>::lowest();
+    double from = 0;
+    double to = 0;
+    if (DiskInterval(a, radius, y, from, to)) {
+        min_x = std::min(min_x, from);
+        max_x = std::max(max_x, to);
+    }
+    if (DiskInterval(b, radius, y, from, to)) {
+        min_x = std::min(min_x, from);
+        max_x = std::max(max_x, to);
+    }
+    const double dx = b.x - a.x;
+    const double dy = b.y - a.y;
+    const double length = std::hypot(dx, dy);
+    if (length > 0) {
+        const double nx = -dy / length * radius;
+        const double ny = dx / length * radius;
+        const svg::Point corners[] = { { a.x + nx, a.y + ny }, { b.x + nx, b.y + ny },
+            { b.x - nx, b.y - ny }, { a.x - nx, a.y - ny } };
+        for (size_t i = 0; i < 4; ++i) {
+            const svg::Point& p = corners[i];
+            const svg::Point& q = corners[(i + 1) % 4];
+            if ((p.y <= y && y <= q.y) || (q.y <= y && y <= p.y)) {
+                const double x = p.y == q.y ? p.x : p.x + (y - p.y) / (q.y - p.y) * (q.x - p.x);
+                min_x = std::min({ min_x, x, p.y == q.y ? q.x : x });
+                max_x = std::max({ max_x, x, p.y == q.y ? q.x : x });
+            }
+        }
+    }
+    return min_x <= max_x;
+}
+
+void Blend(uint8_t* pixel, Rgba8 color) {
+    if (color.alpha == 255 || pixel[3] == 0) {
+        pixel[0] = color.red;
+        pixel[1] = color.green;
+        pixel[2] = color.blue;
+        pixel[3] = color.alpha;
+        return;
+    }
+    const uint32_t alpha = color.alpha;
+    // the general case below with an opaque pixel, divided by a constant
+    if (pixel[3] == 255) {
+        pixel[0] = static_cast<uint8_t>((color.red * alpha + pixel[0] * (255 - alpha) + 127) / 255);
+        pixel[1] = static_cast<uint8_t>((color.green * alpha + pixel[1] * (255 - alpha) + 127) / 255);
+        pixel[2] = static_cast<uint8_t>((color.blue * alpha + pixel[2] * (255 - alpha) + 127) / 255);
+        return;
+    }
+    const uint32_t below = pixel[3] * (255 - alpha) / 255;
+    const uint32_t result = alpha + below;
+    pixel[0] = static_cast<uint8_t>((color.red * alpha + pixel[0] * below + result / 2) / result);
+    pixel[1] = static_cast<uint8_t>((color.green * alpha + pixel[1] * below + result / 2) / result);
+    pixel[2] = static_cast<uint8_t>((color.blue * alpha + pixel[2] * below + result / 2) / result);
+    pixel[3] = static_cast<uint8_t>(result);
+}
+
+class Rasterizer {
+public:
+    Rasterizer(const ShapeCollector& collector, const RasterOptions& options, Image& image)
+        : shapes_(collector.GetShapes())
+        , points_(collector.GetPoints())
+        , options_(options)
+        , image_(image) {
+        BinPieces();
+    }
+
+    size_t GetBands() const {
+        return band_offsets_.size() - 1;
+    }
+
+    void DrawBand(size_t band) {
+        const int64_t band_begin = static_cast<int64_t>(band * BAND_ROWS);
+        const int64_t band_end = std::min<int64_t>(band_begin + BAND_ROWS, options_.height);
+        const size_t end = band_offsets_[band + 1];
+        for (size_t begin = band_offsets_[band]; begin < end;) {
+            size_t shape_end = begin + 1;
+            int64_t row_begin = pieces_[begin].row_begin;
+            int64_t row_end = pieces_[begin].row_end;
+            while (shape_end < end && pieces_[shape_end].shape == pieces_[begin].shape) {
+                row_begin = std::min<int64_t>(row_begin, pieces_[shape_end].row_begin);
+                row_end = std::max<int64_t>(row_end, pieces_[shape_end].row_end);
+                ++shape_end;
+            }
+            for (int64_t row = std::max(row_begin, band_begin); row < std::min(row_end, band_end); ++row) {
+                DrawRow(begin, shape_end, row);
+            }
+            begin = shape_end;
+        }
+    }
+private:
+    const std::vector<Shape>& shapes_;
+    const std::vector<svg::Point>& points_;
+    const RasterOptions& options_;
+    Image& image_;
+    // pieces of the band b are pieces_[band_offsets_[b] .. band_offsets_[b + 1]), in the document order
+    std::vector<size_t> band_offsets_;
+    std::vector<Piece> pieces_;
+    // per thread: spans of the row being drawn
+    static thread_local std::vector<Span> spans_;
+
+    // calls add(piece) for the pieces of every shape touching the image
+    template <typename AddPiece>
+    void ForEachPiece(AddPiece add) const {
+        const auto add_covered = [&](uint32_t shape, uint32_t segment, double min_x, double min_y, double max_x, double max_y) {
+            if (max_x < 0 || min_x > static_cast<double>(options_.width)) {
+                return;
+            }
+            const auto [begin, end] = CoveredRange(min_y, max_y, options_.height);
+            if (begin < end) {
+                add(Piece{ shape, segment, static_cast<uint32_t>(begin), static_cast<uint32_t>(end) });
+            }
+        };
+        for (uint32_t i = 0; i < shapes_.size(); ++i) {
+            const Shape& shape = shapes_[i];
+            if (shape.kind != Shape::Kind::POLYLINE || shape.last - shape.first == 1) {
+                add_covered(i, 0, shape.min_x, shape.min_y, shape.max_x, shape.max_y);
+                continue;
+            }
+            for (uint32_t segment = 0; segment + 1 < shape.last - shape.first; ++segment) {
+                const svg::Point& a = points_[shape.first + segment];
+                const svg::Point& b = points_[shape.first + segment + 1];
+                add_covered(i, segment, std::min(a.x, b.x) - shape.radius, std::min(a.y, b.y) - shape.radius,
+                    std::max(a.x, b.x) + shape.radius, std::max(a.y, b.y) + shape.radius);
+            }
+        }
+    }
+
+    void BinPieces() {
+        const size_t bands = (options_.height + BAND_ROWS - 1) / BAND_ROWS;
+        band_offsets_.assign(bands + 1, 0);
+        ForEachPiece([&](const Piece& piece) {
+            for (size_t band = piece.row_begin / BAND_ROWS; band <= (piece.row_end - 1) / BAND_ROWS; ++band) {
+                ++band_offsets_[band + 1];
+            }
+            });
+        for (size_t band = 0; band < bands; ++band) {
+            band_offsets_[band + 1] += band_offsets_[band];
+        }
+        pieces_.resize(band_offsets_.back());
+        std::vector<size_t> next(band_offsets_.begin(), band_offsets_.end() - 1);
+        ForEachPiece([&](const Piece& piece) {
+            for (size_t band = piece.row_begin / BAND_ROWS; band <= (piece.row_end - 1) / BAND_ROWS; ++band) {
+                pieces_[next[band]++] = piece;
+            }
+            });
+    }
+
+    // blends the pieces [begin, end) of one shape into the row
+    void DrawRow(size_t begin, size_t end, int64_t row) {
+        const Shape& shape = shapes_[pieces_[begin].shape];
+        const double y = row + 0.5;
+        const size_t width = options_.width;
+        double min_x = 0;
+        double max_x = 0;
+        std::vector<Span>& spans = spans_;
+        spans.clear();
+        switch (shape.kind) {
+        case Shape::Kind::POLYLINE:
+            for (size_t i = begin; i < end; ++i) {
+                if (row < pieces_[i].row_begin || row >= pieces_[i].row_end) {
+                    continue;
+                }
+                const svg::Point& a = points_[shape.first + pieces_[i].segment];
+                const svg::Point& b = shape.last - shape.first == 1 ? a : points_[shape.first + pieces_[i].segment + 1];
+                if (CapsuleInterval(a, b, shape.radius, y, min_x, max_x)) {
+                    AddInterval(spans, min_x, max_x, width);
+                }
+            }
+            break;
+        case Shape::Kind::DISK:
+            if (DiskInterval(points_[shape.first], shape.radius, y, min_x, max_x)) {
+                AddInterval(spans, min_x, max_x, width);
+            }
+            break;
+        case Shape::Kind::RING:
+            if (DiskInterval(points_[shape.first], shape.radius, y, min_x, max_x)) {
+                double inner_min_x = 0;
+                double inner_max_x = 0;
+                if (shape.inner_radius > 0 && DiskInterval(points_[shape.first], shape.inner_radius, y, inner_min_x, inner_max_x)) {
+                    const auto [outer_begin, outer_end] = CoveredRange(min_x, max_x, width);
+                    const auto [inner_begin, inner_end] = CoveredRange(inner_min_x, inner_max_x, width);
+                    if (inner_begin < inner_end) {
+                        spans.push_back({ outer_begin, inner_begin });
+                        spans.push_back({ inner_end, outer_end });
+                    }
+                    else {
+                        spans.push_back({ outer_begin, outer_end });
+                    }
+                }
+                else {
+                    AddInterval(spans, min_x, max_x, width);
+                }
+            }
+            break;
+        case Shape::Kind::BOX:
+            AddInterval(spans, shape.min_x, shape.max_x, width);
+            break;
+        }
+
+        std::sort(spans.begin(), spans.end(), [](const Span& lhs, const Span& rhs) {
+            return lhs.begin < rhs.begin;
+            });
+        uint8_t* pixels = image_.GetRow(static_cast<size_t>(row));
+        for (size_t i = 0; i < spans.size();) {
+            const int64_t span_begin = spans[i].begin;
+            int64_t span_end = spans[i].end;
+            for (++i; i < spans.size() && spans[i].begin <= span_end; ++i) {
+                span_end = std::max(span_end, spans[i].end);
+            }
+            for (int64_t x = span_begin; x < span_end; ++x) {
+                Blend(pixels + x * 4, shape.color);
+            }
+        }
+    }
+};
+
+thread_local std::vector<Span> Rasterizer::spans_;
+
+class Crc32 {
+public:
+    Crc32() {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t value = i;
+            for (int bit = 0; bit < 8; ++bit) {
+                value = value & 1 ? 0xEDB88320u ^ (value >> 1) : value >> 1;
+            }
+            table_[i] = value;
+        }
+    }
+
+    uint32_t operator()(std::string_view data) const {
+        uint32_t crc = 0xFFFFFFFFu;
+        for (const char c : data) {
+            crc = table_[(crc ^ static_cast<uint8_t>(c)) & 0xFF] ^ (crc >> 8);
+        }
+        return crc ^ 0xFFFFFFFFu;
+    }
+private:
+    std::array<uint32_t, 256> table_;
+};
+
+uint32_t Adler32(const std::string& data) {
+    constexpr uint32_t MOD = 65521;
+    // the sums fit in 32 bits for this many bytes
+    constexpr size_t BLOCK = 5552;
+    uint32_t a = 1;
+    uint32_t b = 0;
+    for (size_t begin = 0; begin < data.size(); begin += BLOCK) {
+        const size_t end = std::min(data.size(), begin + BLOCK);
+        for (size_t i = begin; i < end; ++i) {
+            a += static_cast<uint8_t>(data[i]);
+            b += a;
+        }
+        a %= MOD;
+        b %= MOD;
+    }
+    return b << 16 | a;
+}
+
+void AppendBigEndian(std::string& out, uint32_t value) {
+    out += static_cast<char>(value >> 24);
+    out += static_cast<char>(value >> 16 & 0xFF);
+    out += static_cast<char>(value >> 8 & 0xFF);
+    out += static_cast<char>(value & 0xFF);
+}
+
+// Deflate stream of one block with the fixed Huffman codes
+class FixedDeflater {
+public:
+    explicit FixedDeflater(std::string& out)
+        : out_(out) {
+        // the last block, fixed codes
+        WriteBits(1, 1);
+        WriteBits(1, 2);
+    }
+
+    void Compress(const std::string& data) {
+        std::vector<int32_t> head(HASH_SIZE, -1);
+        std::vector<int32_t> previous(WINDOW_SIZE, -1);
+        const auto hash = [&data](size_t i) {
+            const uint32_t value = static_cast<uint8_t>(data[i]) | static_cast<uint8_t>(data[i + 1]) << 8
+                | static_cast<uint8_t>(data[i + 2]) << 16;
+            return (value * 2654435761u) >> (32 - HASH_BITS);
+        };
+        const auto insert = [&](size_t i) {
+            const uint32_t key = hash(i);
+            previous[i & (WINDOW_SIZE - 1)] = head[key];
+            head[key] = static_cast<int32_t>(i);
+        };
+        size_t i = 0;
+        while (i < data.size()) {
+            size_t best_length = 0;
+            size_t best_distance = 0;
+            if (i + MIN_MATCH <= data.size()) {
+                const size_t max_length = std::min(MAX_MATCH, data.size() - i);
+                int32_t candidate = head[hash(i)];
+                for (size_t chain = 0; candidate >= 0 && i - candidate <= WINDOW_SIZE - 1 && chain < MAX_CHAIN; ++chain) {
+                    size_t length = 0;
+                    while (length < max_length && data[candidate + length] == data[i + length]) {
+                        ++length;
+                    }
+                    if (length > best_length) {
+                        best_length = length;
+                        best_distance = i - candidate;
+                        if (length == max_length) {
+                            break;
+                        }
+                    }
+                    candidate = previous[candidate & (WINDOW_SIZE - 1)];
+                }
+            }
+            if (best_length >= MIN_MATCH) {
+                WriteMatch(best_length, best_distance);
+                // the last bytes have no 3 bytes to hash
+                const size_t end = i + best_length;
+                for (; i < std::min(end, data.size() - MIN_MATCH + 1); ++i) {
+                    insert(i);
+                }
+                i = end;
+                continue;
+            }
+            if (i + MIN_MATCH <= data.size()) {
+                insert(i);
+            }
+            WriteSymbol(static_cast<uint8_t>(data[i]));
+            ++i;
+        }
+    }
+
+    void Finish() {
+        WriteSymbol(END_OF_BLOCK);
+        if (bit_count_ > 0) {
+            out_ += static_cast<char>(bit_buffer_ & 0xFF);
+        }
+        bit_buffer_ = 0;
+        bit_count_ = 0;
+    }
+private:
+    static constexpr size_t WINDOW_SIZE = 1 << 15;
+    static constexpr uint32_t HASH_BITS = 16;
+    static constexpr size_t HASH_SIZE = 1 << HASH_BITS;
+    static constexpr size_t MIN_MATCH = 3;
+    static constexpr size_t MAX_MATCH = 258;
+    static constexpr size_t MAX_CHAIN = 16;
+    static constexpr uint32_t END_OF_BLOCK = 256;
+
+    static constexpr uint16_t LENGTH_BASES[] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+        35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+    static constexpr uint8_t LENGTH_EXTRA_BITS[] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+        3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+    static constexpr uint16_t DISTANCE_BASES[] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+        257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+    static constexpr uint8_t DISTANCE_EXTRA_BITS[] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+        7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+    std::string& out_;
+    uint64_t bit_buffer_ = 0;
+    uint32_t bit_count_ = 0;
+
+    // the first bit of the value goes first
+    void WriteBits(uint32_t value, uint32_t count) {
+        bit_buffer_ |= static_cast<uint64_t>(value) << bit_count_;
+        bit_count_ += count;
+        while (bit_count_ >= 8) {
+            out_ += static_cast<char>(bit_buffer_ & 0xFF);
+            bit_buffer_ >>= 8;
+            bit_count_ -= 8;
+        }
+    }
+
+    // Huffman codes go from their highest bit
+    void WriteCode(uint32_t code, uint32_t count) {
+        uint32_t reversed = 0;
+        for (uint32_t bit = 0; bit < count; ++bit) {
+            reversed |= (code >> bit & 1) << (count - 1 - bit);
+        }
+        WriteBits(reversed, count);
+    }
+
+    void WriteSymbol(uint32_t symbol) {
+        if (symbol < 144) {
+            WriteCode(0x30 + symbol, 8);
+        }
+        else if (symbol < 256) {
+            WriteCode(0x190 + symbol - 144, 9);
+        }
+        else if (symbol < 280) {
+            WriteCode(symbol - 256, 7);
+        }
+        else {
+            WriteCode(0xC0 + symbol - 280, 8);
+        }
+    }
+
+    void WriteMatch(size_t length, size_t distance) {
+        const size_t length_code = std::upper_bound(std::begin(LENGTH_BASES), std::end(LENGTH_BASES), length)
+            - std::begin(LENGTH_BASES) - 1;
+        WriteSymbol(static_cast<uint32_t>(257 + length_code));
+        WriteBits(static_cast<uint32_t>(length - LENGTH_BASES[length_code]), LENGTH_EXTRA_BITS[length_code]);
+        const size_t distance_code = std::upper_bound(std::begin(DISTANCE_BASES), std::end(DISTANCE_BASES), distance)
+            - std::begin(DISTANCE_BASES) - 1;
+        WriteCode(static_cast<uint32_t>(distance_code), 5);
+        WriteBits(static_cast<uint32_t>(distance - DISTANCE_BASES[distance_code]), DISTANCE_EXTRA_BITS[distance_code]);
+    }
+};
+
+void WriteChunk(std::ostream& out, std::string_view type, std::string_view data) {
+    static const Crc32 crc32;
+    std::string chunk;
+    AppendBigEndian(chunk, static_cast<uint32_t>(data.size()));
+    chunk += type;
+    chunk += data;
+    AppendBigEndian(chunk, crc32(std::string_view(chunk).substr(4)));
+    out.write(chunk.data(), chunk.size());
+}
+} //namespace
+
+std::optional<Rgba8> ToRgba(const svg::Color& color) {
+    if (const auto* name = std::get_if<std::string>(&color)) {
+        if (*name == "none"sv || *name == "transparent"sv) {
+            return std::nullopt;
+        }
+        return ParseColor(*name);
+    }
+    if (const auto* rgb = std::get_if<svg::Rgb>(&color)) {
+        return Rgba8{ rgb->red, rgb->green, rgb->blue, 255 };
+    }
+    if (const auto* rgba = std::get_if<svg::Rgba>(&color)) {
+        const auto alpha = static_cast<uint8_t>(std::lround(std::clamp(rgba->opacity, 0.0, 1.0) * 255));
+        if (alpha == 0) {
+            return std::nullopt;
+        }
+        return Rgba8{ rgba->red, rgba->green, rgba->blue, alpha };
+    }
+    return std::nullopt;
+}
+
+Image::Image(size_t width, size_t height)
+    : width_(width)
+    , height_(height)
+    , pixels_(width * height * 4, 0) {
+}
+
+size_t Image::GetWidth() const {
+    return width_;
+}
+
+size_t Image::GetHeight() const {
+    return height_;
+}
+
+uint8_t* Image::GetRow(size_t y) {
+    return pixels_.data() + y * width_ * 4;
+}
+
+const uint8_t* Image::GetRow(size_t y) const {
+    return pixels_.data() + y * width_ * 4;
+}
+
+Image Rasterize(const svg::CompactDocument& document, const RasterOptions& options) {
+    Image image(options.width, options.height);
+    ShapeCollector collector(options);
+    document.VisitObjects(collector);
+    Rasterizer rasterizer(collector, options, image);
+
+    std::atomic<size_t> next_band = 0;
+    std::mutex error_mutex;
+    std::exception_ptr error;
+    const auto draw_bands = [&] {
+        try {
+            for (size_t band = next_band++; band < rasterizer.GetBands(); band = next_band++) {
+                rasterizer.DrawBand(band);
+            }
+        }
+        catch (...) {
+            std::lock_guard guard(error_mutex);
+            error = std::current_exception();
+        }
+    };
+    std::vector<std::thread> workers;
+    const size_t threads = std::min<size_t>(options.threads ? options.threads : std::max(1u, std::thread::hardware_concurrency()),
+        rasterizer.GetBands());
+    for (size_t i = 1; i < threads; ++i) {
+        workers.emplace_back(draw_bands);
+    }
+    draw_bands();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+    return image;
+}
+
+void WritePng(std::ostream& out, const Image& image) {
+    static constexpr std::string_view SIGNATURE = "\x89PNG\r\n\x1A\n"sv;
+    out.write(SIGNATURE.data(), SIGNATURE.size());
+
+    std::string header;
+    AppendBigEndian(header, static_cast<uint32_t>(image.GetWidth()));
+    AppendBigEndian(header, static_cast<uint32_t>(image.GetHeight()));
+    // 8 bits, RGBA, deflate, adaptive filters, no interlace
+    header += "\x08\x06\x00\x00\x00"sv;
+    WriteChunk(out, "IHDR"sv, header);
+
+    // every row with the Sub filter: a byte minus the same byte of the pixel to the left
+    const size_t row_size = image.GetWidth() * 4;
+    std::string filtered;
+    filtered.reserve((row_size + 1) * image.GetHeight());
+    for (size_t y = 0; y < image.GetHeight(); ++y) {
+        const uint8_t* row = image.GetRow(y);
+        filtered += '\x01';
+        for (size_t i = 0; i < row_size; ++i) {
+            filtered += static_cast<char>(i < 4 ? row[i] : static_cast<uint8_t>(row[i] - row[i - 4]));
+        }
+    }
+
+    // zlib: deflate with a 32K window, no dictionary
+    std::string compressed = "\x78\x01"s;
+    FixedDeflater deflater(compressed);
+    deflater.Compress(filtered);
+    deflater.Finish();
+    AppendBigEndian(compressed, Adler32(filtered));
+    WriteChunk(out, "IDAT"sv, compressed);
+    WriteChunk(out, "IEND"sv, {});
+}
+
+void WritePpm(std::ostream& out, const Image& image) {
+    out << "P6\n"sv << image.GetWidth() << ' ' << image.GetHeight() << "\n255\n"sv;
+    std::string row(image.GetWidth() * 3, '\0');
+    for (size_t y = 0; y < image.GetHeight(); ++y) {
+        const uint8_t* pixels = image.GetRow(y);
+        for (size_t x = 0; x < image.GetWidth(); ++x) {
+            const uint32_t alpha = pixels[x * 4 + 3];
+            for (size_t c = 0; c < 3; ++c) {
+                row[x * 3 + c] = static_cast<char>((pixels[x * 4 + c] * alpha + 255 * (255 - alpha) + 127) / 255);
+            }
+        }
+        out.write(row.data(), row.size());
+    }
+}
+} //namespace raster
\ No newline at end of file
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "svg.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <optional>
+#include <vector>
+
+namespace raster {
+
+struct Rgba8 {
+    uint8_t red = 0;
+    uint8_t green = 0;
+    uint8_t blue = 0;
+    uint8_t alpha = 0;
+};
+
+// Colour of a shape: CSS colour names, #rgb, #rrggbb, Rgb and Rgba.
+// nullopt for none, transparent and colours it cannot read; such a part of a shape is not drawn
+std::optional<Rgba8> ToRgba(const svg::Color& color);
+
+// RGBA pixels, not premultiplied, rows from the top; a new image is transparent
+class Image {
+public:
+    Image() = default;
+    Image(size_t width, size_t height);
+
+    size_t GetWidth() const;
+    size_t GetHeight() const;
+    // 4 bytes per pixel
+    uint8_t* GetRow(size_t y);
+    const uint8_t* GetRow(size_t y) const;
+private:
+    size_t width_ = 0;
+    size_t height_ = 0;
+    std::vector<uint8_t> pixels_;
+};
+
+struct RasterOptions {
+    // the document point at the top left corner of the image
+    svg::Point view_min;
+    // pixels per document unit
+    double scale = 1;
+    size_t width = 0;
+    size_t height = 0;
+    // texts are drawn as boxes of their approximate size, there are no glyphs
+    bool label_boxes = false;
+    // 0 is one per core
+    size_t threads = 0;
+};
+
+inline constexpr size_t BAND_ROWS = 32;
+
+// Draws the document in its order: polyline strokes with round caps and joins, circles with fill
+// and stroke, label boxes if asked. A pixel is covered if its centre is, there is no antialiasing.
+// Polylines are not filled. Every shape is blended once per pixel even where it covers itself,
+// as in svg. The image is cut into bands of BAND_ROWS rows drawn on several threads
+Image Rasterize(const svg::CompactDocument& document, const RasterOptions& options);
+
+// PNG, 8 bits per channel RGBA, compressed with fixed Huffman codes
+void WritePng(std::ostream& out, const Image& image);
+// binary PPM over a white background
+void WritePpm(std::ostream& out, const Image& image);
+} //namespace raster
\ No newline at end of file
@@ -0,0 +1,160 @@
+#include "request_pool.h"
+
+#include <sstream>
+#include <utility>
+
+namespace transport_catalogue {
+namespace handle_iformation {
+
+RequestPool::RequestPool(const ProcessRequests& facade, json::Writer& writer, size_t threads)
+	: facade_(facade)
+	, writer_(writer)
+{
+	if (threads > 1) {
+		workers_.reserve(threads);
+		for (size_t i = 0; i < threads; ++i) {
+			workers_.emplace_back([this] { WorkerLoop(); });
+		}
+	}
+}
+
+RequestPool::~RequestPool() {
+	{
+		std::lock_guard guard(mutex_);
+		is_stopped_ = true;
+		queue_.clear();
+	}
+	work_ready_.notify_all();
+	for (auto& worker : workers_) {
+		worker.join();
+	}
+}
+
+void RequestPool::Add(const StatRequest& request) {
+	if (workers_.empty()) {
+		facade_.AnswerRequest(request, writer_);
+		return;
+	}
+	pending_.requests.push_back(request);
+	AddToPending();
+}
+
+bool RequestPool::Read(json::Reader& reader) {
+	if (workers_.empty()) {
+		if (reader.Peek() == json::Event::END_ARRAY) {
+			reader.Next();
+			return false;
+		}
+		facade_.AnswerRequest(reader.ReadValue().AsDict(), writer_);
+		return true;
+	}
+	if (!reader.ReadRawValue(pending_.texts)) {
+		return false;
+	}
+	pending_.text_ends.push_back(pending_.texts.size());
+	AddToPending();
+	return true;
+}
+
+void RequestPool::AddToPending() {
+	if (pending_.requests.size() + pending_.text_ends.size() == CHUNK_SIZE) {
+		Dispatch();
+	}
+}
+
+void RequestPool::Finish() {
+	if (workers_.empty()) {
+		return;
+	}
+	if (!pending_.requests.empty() || !pending_.text_ends.empty()) {
+		Dispatch();
+	}
+	while (true) {
+		{
+			std::lock_guard guard(mutex_);
+			if (chunks_.empty()) {
+				break;
+			}
+		}
+		WriteDone(true);
+	}
+}
+
+void RequestPool::Dispatch() {
+	size_t in_flight;
+	{
+		std::lock_guard guard(mutex_);
+		chunks_.push_back(std::move(pending_));
+		queue_.push_back(&chunks_.back());
+		in_flight = chunks_.size();
+	}
+	work_ready_.notify_one();
+	pending_ = Chunk();
+	WriteDone(in_flight > CHUNKS_PER_THREAD * workers_.size());
+}
+
+void RequestPool::WorkerLoop() {
+	while (true) {
+		Chunk* chunk;
+		{
+			std::unique_lock lock(mutex_);
+			work_ready_.wait(lock, [this] {
+				return is_stopped_ || !queue_.empty();
+				});
+			if (queue_.empty()) {
+				return;
+			}
+			chunk = queue_.front();
+			queue_.pop_front();
+		}
+		AnswerChunk(*chunk);
+		chunk_done_.notify_all();
+	}
+}
+
+void RequestPool::AnswerChunk(Chunk& chunk) {
+	std::ostringstream out;
+	std::exception_ptr error;
+	try {
+		json::Writer items(out, writer_);
+		for (const auto& request : chunk.requests) {
+			facade_.AnswerRequest(request, items);
+		}
+		size_t begin = 0;
+		for (const size_t end : chunk.text_ends) {
+			const auto document = json::Load(std::string_view(chunk.texts).substr(begin, end - begin));
+			facade_.AnswerRequest(document.GetRoot().AsDict(), items);
+			begin = end;
+		}
+	}
+	catch (...) {
+		error = std::current_exception();
+	}
+	std::vector<StatRequest>().swap(chunk.requests);
+	std::string().swap(chunk.texts);
+	std::lock_guard guard(mutex_);
+	chunk.answers = out.str();
+	chunk.error = error;
+	chunk.is_done = true;
+}
+
+void RequestPool::WriteDone(bool wait_oldest) {
+	std::unique_lock lock(mutex_);
+	if (wait_oldest && !chunks_.empty()) {
+		chunk_done_.wait(lock, [this] {
+			return chunks_.front().is_done;
+			});
+	}
+	while (!chunks_.empty() && chunks_.front().is_done) {
+		Chunk chunk = std::move(chunks_.front());
+		chunks_.pop_front();
+		lock.unlock();
+		if (chunk.error) {
+			std::rethrow_exception(chunk.error);
+		}
+		writer_.AppendItems(chunk.answers);
+		lock.lock();
+	}
+}
+} //namespace handle_iformation
+} //namespace transport_catalogue
\ No newline at end of file
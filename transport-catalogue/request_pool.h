@@ -0,0 +1,72 @@
+#pragma once
+
+#include "json_reader.h"
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace transport_catalogue {
+namespace handle_iformation {
+
+// Answers stat_requests into the array open in the writer, on worker threads.
+// Requests are cut into chunks of CHUNK_SIZE; chunks are answered in any order
+// and added to the writer in input order as soon as all chunks before them are done,
+// so the output is the same as of the sequential ProcessRequests::AnswerRequest calls.
+// With one thread requests are answered right in Add or Read.
+// The requests of one pool are added either all by Add or all by Read.
+class RequestPool {
+public:
+	RequestPool(const ProcessRequests& facade, json::Writer& writer, size_t threads);
+	RequestPool(const RequestPool&) = delete;
+	RequestPool& operator=(const RequestPool&) = delete;
+	~RequestPool();
+
+	void Add(const StatRequest& request);
+	// Reads the next request of the array open in the reader; false at the end of the array.
+	// With worker threads the request is only cut out of the input and is parsed by a worker
+	bool Read(json::Reader& reader);
+	// waits for all added requests and writes their answers; rethrows the first error of a request
+	void Finish();
+private:
+	static constexpr size_t CHUNK_SIZE = 256;
+	// chunks dispatched and not yet written, per thread; bounds the memory of a long stream
+	static constexpr size_t CHUNKS_PER_THREAD = 4;
+
+	struct Chunk {
+		std::vector<StatRequest> requests;
+		// requests added by Read, one after another
+		std::string texts;
+		std::vector<size_t> text_ends;
+		std::string answers;
+		std::exception_ptr error;
+		bool is_done = false;
+	};
+
+	const ProcessRequests& facade_;
+	json::Writer& writer_;
+	Chunk pending_;
+
+	std::mutex mutex_;
+	std::condition_variable work_ready_;
+	std::condition_variable chunk_done_;
+	// in input order, from the oldest chunk not yet written
+	std::deque<Chunk> chunks_;
+	// dispatched chunks not yet taken by a worker
+	std::deque<Chunk*> queue_;
+	bool is_stopped_ = false;
+	std::vector<std::thread> workers_;
+
+	void AddToPending();
+	void Dispatch();
+	void WorkerLoop();
+	void AnswerChunk(Chunk& chunk);
+	// writes the done chunks at the front; with wait_oldest waits for the oldest one first
+	void WriteDone(bool wait_oldest);
+};
+} //namespace handle_iformation
+} //namespace transport_catalogue
\ No newline at end of file
@@ -0,0 +1,278 @@
+#include "request_server.h"
+
+#include <chrono>
+#include <cerrno>
+#include <cstring>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <streambuf>
+#include <thread>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace transport_catalogue {
+namespace handle_iformation {
+using namespace std::literals;
+
+namespace {
+// Buffered stream over a connected socket; owns the descriptor
+class SocketBuffer : public std::streambuf {
+public:
+	explicit SocketBuffer(int fd)
+		: fd_(fd)
+	{
+		setg(input_, input_, input_);
+		setp(output_, output_ + BUFFER_SIZE);
+	}
+	SocketBuffer(const SocketBuffer&) = delete;
+	SocketBuffer& operator=(const SocketBuffer&) = delete;
+
+	~SocketBuffer() override {
+		sync();
+		close(fd_);
+	}
+protected:
+	int_type underflow() override {
+		ssize_t size;
+		do {
+			size = recv(fd_, input_, BUFFER_SIZE, 0);
+		} while (size < 0 && errno == EINTR);
+		if (size <= 0) {
+			return traits_type::eof();
+		}
+		setg(input_, input_, input_ + size);
+		return traits_type::to_int_type(*gptr());
+	}
+
+	int_type overflow(int_type c) override {
+		if (sync() != 0) {
+			return traits_type::eof();
+		}
+		if (!traits_type::eq_int_type(c, traits_type::eof())) {
+			*pptr() = traits_type::to_char_type(c);
+			pbump(1);
+		}
+		return traits_type::not_eof(c);
+	}
+
+	int sync() override {
+		const char* data = pbase();
+		while (data != pptr()) {
+			// MSG_NOSIGNAL: a client gone away is an error of its connection, not SIGPIPE for the server
+			const ssize_t size = send(fd_, data, pptr() - data, MSG_NOSIGNAL);
+			if (size < 0 && errno == EINTR) {
+				continue;
+			}
+			if (size <= 0) {
+				setp(output_, output_ + BUFFER_SIZE);
+				return -1;
+			}
+			data += size;
+		}
+		setp(output_, output_ + BUFFER_SIZE);
+		return 0;
+	}
+private:
+	static constexpr size_t BUFFER_SIZE = 1 << 16;
+
+	int fd_;
+	char input_[BUFFER_SIZE];
+	char output_[BUFFER_SIZE];
+};
+
+std::runtime_error SystemError(const std::string& call) {
+	return std::runtime_error(call + ": "s + std::strerror(errno));
+}
+} //namespace
+
+RequestServer::RequestServer(StreamProcessRequests::SnapshotLoader loader, std::ostream& log)
+	: loader_(std::move(loader))
+	, log_(log)
+	, publisher_(std::make_unique<CatalogueSnapshot>())
+{
+}
+
+void RequestServer::SetNumberMode(number_format::Mode number_mode) {
+	number_mode_ = number_mode;
+}
+
+SnapshotPublisher::ReadGuard RequestServer::PinSnapshot(const json::flat::Dict& batch) {
+	std::string file;
+	if (const auto* settings = batch.Find("serialization_settings"sv)) {
+		file = settings->AsDict().at("file"sv).AsString();
+	}
+	std::optional<CatalogueUpdate> update;
+	if (const auto* base_requests = batch.Find("base_requests"sv)) {
+		update = ReadCatalogueUpdate(base_requests->AsArray());
+	}
+
+	std::unique_ptr<CatalogueSnapshot> loaded;
+	while (true) {
+		std::optional<SnapshotPublisher::ReadGuard> pinned;
+		pinned.emplace(publisher_.Acquire());
+		// the name is published with the snapshot, so batches naming the current base take no lock
+		if (!file.empty() && (*pinned)->base_file != file) {
+			if (!loaded) {
+				loaded = loader_(file);
+				loaded->base_file = file;
+			}
+			const uint64_t version = (*pinned)->version;
+			pinned.reset();
+			auto published = publisher_.TryPublish(version, loaded);
+			if (!published) {
+				continue;
+			}
+			pinned.emplace(std::move(*published));
+		}
+		if ((*pinned)->base_file.empty()) {
+			throw std::invalid_argument("serialization_settings are not set!"s);
+		}
+		if (!update) {
+			return std::move(*pinned);
+		}
+		auto next = MakeNextSnapshot(**pinned, *update);
+		const uint64_t version = (*pinned)->version;
+		pinned.reset();
+		if (auto published = publisher_.TryPublish(version, next)) {
+			return std::move(*published);
+		}
+	}
+}
+
+size_t RequestServer::AnswerBatch(const std::string& line, std::string& answer) {
+	// a batch is read once and decoded straight into requests, it needs no std::map tree
+	const json::flat::Document document = json::flat::Load(line);
+	const json::flat::Dict batch = document.GetRoot().AsDict();
+	const auto snapshot = PinSnapshot(batch);
+	ProcessRequests facade(&snapshot->tran_cat, &snapshot->map_render, &snapshot->transport_router);
+	facade.SetNumberMode(number_mode_);
+	facade.SetMapCache(snapshot->map_cache.get());
+
+	size_t count = 0;
+	std::ostringstream out;
+	{
+		json::Writer writer(out, number_mode_, json::Writer::Layout::COMPACT);
+		writer.StartArray();
+		if (const auto* stat_requests = batch.Find("stat_requests"sv)) {
+			for (const auto& request : stat_requests->AsArray()) {
+				facade.AnswerRequest(request.AsDict(), writer);
+				++count;
+			}
+		}
+		writer.EndArray();
+	}
+	answer = out.str();
+	return count;
+}
+
+void RequestServer::Serve(std::istream& input, std::ostream& output) {
+	std::string line;
+	std::string answer;
+	while (std::getline(input, line)) {
+		if (line.find_first_not_of(" \t\r"sv) == std::string::npos) {
+			continue;
+		}
+		const auto start = std::chrono::steady_clock::now();
+		size_t count = 0;
+		std::optional<std::string> error;
+		try {
+			count = AnswerBatch(line, answer);
+		}
+		catch (const std::exception& e) {
+			error = e.what();
+		}
+		catch (...) {
+			// the catalogue throws strings and character arrays as well
+			error = "unknown error"s;
+		}
+		if (error) {
+			std::ostringstream out;
+			{
+				json::Writer writer(out, number_mode_, json::Writer::Layout::COMPACT);
+				writer.StartDict().Key("error_message"sv).Value(*error).EndDict();
+			}
+			answer = out.str();
+		}
+		output << answer << '\n';
+		output.flush();
+		const std::chrono::duration<double, std::milli> latency = std::chrono::steady_clock::now() - start;
+
+		const uint64_t number = ++batch_count_;
+		std::lock_guard guard(log_mutex_);
+		log_ << "batch "sv << number << ": "sv << count << " requests, "sv << latency.count() << " ms"sv;
+		if (error) {
+			log_ << ", error: "sv << *error;
+		}
+		log_ << std::endl;
+	}
+}
+
+void RequestServer::ServeSocket(const std::string& path) {
+	sockaddr_un address{};
+	address.sun_family = AF_UNIX;
+	if (path.size() >= sizeof(address.sun_path)) {
+		throw std::invalid_argument("Socket path is too long!"s);
+	}
+	std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+	const int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listener < 0) {
+		throw SystemError("socket"s);
+	}
+	// a socket left by the previous run is replaced, any other file is not touched
+	struct stat file_stat;
+	if (stat(path.c_str(), &file_stat) == 0 && S_ISSOCK(file_stat.st_mode)) {
+		unlink(path.c_str());
+	}
+	if (bind(listener, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+		throw SystemError("bind"s);
+	}
+	if (listen(listener, SOMAXCONN) != 0) {
+		throw SystemError("listen"s);
+	}
+	{
+		std::lock_guard guard(log_mutex_);
+		log_ << "listening on "sv << path << std::endl;
+	}
+
+	while (true) {
+		{
+			std::unique_lock guard(connections_mutex_);
+			connections_cv_.wait(guard, [this] {
+				return connection_count_ < MAX_CONNECTIONS;
+				});
+		}
+		const int connection = accept(listener, nullptr, nullptr);
+		if (connection < 0) {
+			if (errno == EINTR || errno == ECONNABORTED) {
+				continue;
+			}
+			throw SystemError("accept"s);
+		}
+		{
+			std::lock_guard guard(connections_mutex_);
+			++connection_count_;
+		}
+		std::thread([this, connection] {
+			try {
+				SocketBuffer buffer(connection);
+				std::istream input(&buffer);
+				std::ostream output(&buffer);
+				Serve(input, output);
+			}
+			catch (...) {
+				std::lock_guard guard(log_mutex_);
+				log_ << "connection closed on an error"sv << std::endl;
+			}
+			std::lock_guard guard(connections_mutex_);
+			--connection_count_;
+			connections_cv_.notify_one();
+		}).detach();
+	}
+}
+} //namespace handle_iformation
+} //namespace transport_catalogue
\ No newline at end of file
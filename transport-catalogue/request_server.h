@@ -0,0 +1,63 @@
+#pragma once
+
+#include "json_reader.h"
+#include "catalogue_snapshot.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace transport_catalogue {
+namespace handle_iformation {
+
+// serve mode: the base is deserialized once and answers any number of request batches.
+// A batch is one line of input holding a process_requests document, e.g.
+// {"serialization_settings": {"file": "base.db"}, "stat_requests": [...]};
+// serialization_settings may be left out once a base is loaded. A batch naming another file
+// loads it and publishes it as the next snapshot, batches already being answered keep the old one.
+// A batch may hold base_requests, Stop and Bus requests as make_base reads them: they update the loaded
+// catalogue, which is published as the next snapshot before the stat_requests of the batch are answered.
+// Every batch is answered with one line: the array of answers, or {"error_message": ...}
+// if the batch could not be answered. Latency of every batch is reported to the log.
+class RequestServer {
+public:
+	RequestServer(StreamProcessRequests::SnapshotLoader loader, std::ostream& log);
+	RequestServer(const RequestServer&) = delete;
+	RequestServer& operator=(const RequestServer&) = delete;
+
+	void SetNumberMode(number_format::Mode number_mode);
+
+	// answers batches from the input until it ends
+	void Serve(std::istream& input, std::ostream& output);
+	// accepts connections on a Unix domain socket, every connection is served by its own thread;
+	// while MAX_CONNECTIONS are served, new ones wait in the listen queue
+	void ServeSocket(const std::string& path);
+
+	static constexpr size_t MAX_CONNECTIONS = 64;
+private:
+	StreamProcessRequests::SnapshotLoader loader_;
+	std::ostream& log_;
+	number_format::Mode number_mode_ = number_format::Mode::SHORTEST;
+
+	// starts with an empty snapshot: no base is loaded yet
+	SnapshotPublisher publisher_;
+	std::mutex log_mutex_;
+	std::atomic<uint64_t> batch_count_{ 0 };
+
+	std::mutex connections_mutex_;
+	std::condition_variable connections_cv_;
+	size_t connection_count_ = 0;
+
+	// Pins the snapshot the batch is answered from: of the base the batch names, loaded and published
+	// unless it is current, with the base_requests of the batch applied. Publishing is compared against
+	// the pinned version, so a base published by another connection meanwhile makes the batch retry
+	SnapshotPublisher::ReadGuard PinSnapshot(const json::flat::Dict& batch);
+	// returns the number of answered requests
+	size_t AnswerBatch(const std::string& line, std::string& answer);
+};
+} //namespace handle_iformation
+} //namespace transport_catalogue
\ No newline at end of file
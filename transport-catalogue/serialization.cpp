@@ -1,11 +1,14 @@
 
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 #include <memory>
+#include <stdexcept>
 
 #include "serialization.h"
 
 using namespace transport_catalogue;
+using namespace std::literals;
 
 namespace serialization {
 transport_catalogue_serialize::TransportCatalogue* SerializeTransportCatalogue(const transport_catalogue::TransportCatalogue& tran_cat) {
@@ -41,6 +44,19 @@ transport_catalogue_serialize::TransportCatalogue* SerializeTransportCatalogue(c
 		*proto_distance_stops->mutable_stop_to() = stops.second->name;
 		proto_distance_stops->set_distance(distance);
 	}
+	const auto& stops_index = tran_cat.GetStopsIndex();
+	if (!stops_index.IsEmpty()) {
+		auto proto_stops_index = proto_tran_cat->mutable_stops_index();
+		const auto& grid = stops_index.GetGrid();
+		proto_stops_index->set_min_lat(grid.min_lat);
+		proto_stops_index->set_min_lng(grid.min_lng);
+		proto_stops_index->set_cell_lat(grid.cell_lat);
+		proto_stops_index->set_cell_lng(grid.cell_lng);
+		proto_stops_index->set_rows(grid.rows);
+		proto_stops_index->set_cols(grid.cols);
+		*proto_stops_index->mutable_cell_offsets() = { stops_index.GetCellOffsets().begin(), stops_index.GetCellOffsets().end() };
+		*proto_stops_index->mutable_stop_ids() = { stops_index.GetStopIds().begin(), stops_index.GetStopIds().end() };
+	}
 	return proto_tran_cat;
 }
 
@@ -97,6 +113,7 @@ rendering_serialize::RenderSettings* SerializeMapRender(const transport_catalogu
 		auto proto_color = proto_render_settings->mutable_color_palette()->Add();
 		SetProtoColor(color, proto_color);
 	}
+	proto_render_settings->set_polyline_tolerance(render_settings.polyline_tolerance);
 	return proto_render_settings;
 }
 
@@ -117,6 +134,34 @@ void SetProtoItem(graph_serialize::Item* proto_item, const transport_catalogue::
 	}
 }
 
+// Edges entering every vertex, in id order: the edges of the vertex v are edge_ids[offsets[v] .. offsets[v + 1]).
+// index is the position of an edge among the edges of its vertex
+struct IncomingEdges {
+	std::vector<size_t> offsets;
+	std::vector<graph::EdgeId> edge_ids;
+	std::vector<uint32_t> index;
+};
+
+IncomingEdges MakeIncomingEdges(const graph::DirectedWeightedGraph<transport_catalogue::Item>& graph) {
+	IncomingEdges incoming;
+	incoming.offsets.assign(graph.GetVertexCount() + 1, 0);
+	for (const auto& edge : graph.GetEdges()) {
+		++incoming.offsets[edge.to + 1];
+	}
+	for (size_t vertex = 0; vertex < graph.GetVertexCount(); ++vertex) {
+		incoming.offsets[vertex + 1] += incoming.offsets[vertex];
+	}
+	incoming.edge_ids.resize(graph.GetEdgeCount());
+	incoming.index.resize(graph.GetEdgeCount());
+	std::vector<size_t> next(incoming.offsets.begin(), incoming.offsets.end() - 1);
+	for (graph::EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+		const auto to = graph.GetEdge(edge_id).to;
+		incoming.index[edge_id] = static_cast<uint32_t>(next[to] - incoming.offsets[to]);
+		incoming.edge_ids[next[to]++] = edge_id;
+	}
+	return incoming;
+}
+
 transport_router_serialize::TransportRouter* SerializeTransportRouter(const transport_router::TransportRouter& tran_router) {
 	auto proto_tran_router = new transport_router_serialize::TransportRouter;
 	{ //RouteSettings
@@ -150,28 +195,32 @@ transport_router_serialize::TransportRouter* SerializeTransportRouter(const tran
 	} //Graph
 	
 	{ //Router
-		auto proto_router = new transport_router_serialize::Router;
-		const auto& router = tran_router.GetRouter();
-		const auto& routes_internal_data = router.GetRoutesInternalData();
-		for (const auto& route_internal : routes_internal_data) {
-			auto proto_route_internal = proto_router->mutable_routesinternaldata()->Add();
-			for (const auto& data : route_internal) {
-				auto proto_data = proto_route_internal->mutable_values()->Add();
-				proto_data->Clear();
+		auto proto_router = proto_tran_router->mutable_packed_router();
+		const auto& graph = tran_router.GetGraph();
+		const IncomingEdges incoming = MakeIncomingEdges(graph);
+		const auto& routes_internal_data = tran_router.GetRouter().GetRoutesInternalData();
+		proto_router->mutable_prev_edges()->Reserve(static_cast<int>(routes_internal_data.size() * routes_internal_data.size()));
+		for (graph::VertexId from = 0; from < routes_internal_data.size(); ++from) {
+			const auto& row = routes_internal_data[from];
+			for (const auto& data : row) {
 				if (!data.has_value()) {
-					continue;
+					proto_router->add_prev_edges(0);
+				}
+				// only the route from a vertex to itself has no edges
+				else if (!data->prev_edge.has_value()) {
+					proto_router->add_prev_edges(1);
 				}
-				auto proto_item = new graph_serialize::Item;
-				SetProtoItem(proto_item, data->weight);
-				proto_data->set_allocated_weight(proto_item);
-				if (data->prev_edge.has_value()) {
-					auto proto_edge_id = new transport_router_serialize::EdgeId;
-					proto_edge_id->set_value(*data->prev_edge);
-					proto_data->set_allocated_prev_edge(proto_edge_id);
+				else {
+					const auto& edge = graph.GetEdge(*data->prev_edge);
+					// the router sums the parts of a route in its own order, which can round differently
+					const bool stored = row[edge.from]->weight.time + edge.weight.time != data->weight.time;
+					proto_router->add_prev_edges(2 + 2 * incoming.index[*data->prev_edge] + (stored ? 1 : 0));
+					if (stored) {
+						proto_router->add_times(data->weight.time);
+					}
 				}
 			}
 		}
-		proto_tran_router->set_allocated_router(proto_router);
 	} //Router
 
 	{ //StopnamesToVertex
@@ -188,20 +237,33 @@ transport_router_serialize::TransportRouter* SerializeTransportRouter(const tran
 void SerializeFacade(const TransportCatalogue& tran_cat,
 	const rendering::MapRenderer& map_render,
 	const transport_router::TransportRouter& transport_router,
-	const std::string& filename) {
+	const std::string& filename,
+	const rendering::MapFragments* map_fragments) {
 	std::ofstream out_file(filename, std::ios::binary);
 	auto proto_tran_cat = serialization::SerializeTransportCatalogue(tran_cat);
 	auto proto_render_settings = serialization::SerializeMapRender(map_render.GetRenderSettings());
+	proto_render_settings->set_allocated_projection(serialization::SerializeProjection(map_render.Project(tran_cat)));
 	auto proto_tran_router = serialization::SerializeTransportRouter(transport_router);
 
 	transport_catalogue_serialize::Facade proto_facade;
 	proto_facade.set_allocated_tran_cat(proto_tran_cat);
 	proto_facade.set_allocated_render_settings(proto_render_settings);
 	proto_facade.set_allocated_tran_router(proto_tran_router);
+	if (map_fragments) {
+		auto proto_fragments = proto_facade.mutable_map_fragments();
+		proto_fragments->set_legacy_numbers(map_fragments->number_mode == number_format::Mode::STREAM_COMPATIBLE);
+		proto_fragments->set_escaped_text(map_fragments->text);
+		*proto_fragments->mutable_route_offsets() = { map_fragments->route_offsets.begin(), map_fragments->route_offsets.end() };
+		*proto_fragments->mutable_label_offsets() = { map_fragments->label_offsets.begin(), map_fragments->label_offsets.end() };
+		*proto_fragments->mutable_circle_offsets() = { map_fragments->circle_offsets.begin(), map_fragments->circle_offsets.end() };
+		*proto_fragments->mutable_stop_label_offsets() = { map_fragments->stop_label_offsets.begin(),
+			map_fragments->stop_label_offsets.end() };
+	}
 	proto_facade.SerializeToOstream(&out_file);
 }
 
-transport_catalogue::TransportCatalogue DeserializeTransportCatalogue(const transport_catalogue_serialize::TransportCatalogue& proto_tran_cat) {
+transport_catalogue::TransportCatalogue DeserializeTransportCatalogue(const transport_catalogue_serialize::TransportCatalogue& proto_tran_cat,
+	std::vector<uint32_t>&& valid_stop_ids) {
 	transport_catalogue::TransportCatalogue tran_cat{};
 	for (int i = 0; i < proto_tran_cat.stops_size(); ++i) {
 		const auto& proto_stop = proto_tran_cat.stops(i);
@@ -226,6 +288,40 @@ transport_catalogue::TransportCatalogue DeserializeTransportCatalogue(const tran
 		}
 		tran_cat.AddBus({ std::string(proto_bus.name()), std::move(stops), std::move(type_route), std::move(unique_stops) });
 	}
+	if (valid_stop_ids.empty()) {
+		tran_cat.Freeze();
+	}
+	else {
+		tran_cat.Freeze(std::move(valid_stop_ids));
+	}
+	if (proto_tran_cat.has_stops_index()) {
+		const auto& proto_stops_index = proto_tran_cat.stops_index();
+		StopsIndex::Grid grid{ proto_stops_index.min_lat(), proto_stops_index.min_lng(),
+			proto_stops_index.cell_lat(), proto_stops_index.cell_lng(),
+			proto_stops_index.rows(), proto_stops_index.cols() };
+		std::vector<uint32_t> cell_offsets(proto_stops_index.cell_offsets().begin(), proto_stops_index.cell_offsets().end());
+		std::vector<uint32_t> stop_ids(proto_stops_index.stop_ids().begin(), proto_stops_index.stop_ids().end());
+		// the index is scanned without bounds checks, so every stop must be in exactly one cell
+		const size_t stop_count = tran_cat.GetDequeStops().size();
+		bool broken = grid.rows == 0 || grid.cols == 0 || !(grid.cell_lat > 0) || !(grid.cell_lng > 0)
+			|| cell_offsets.size() != static_cast<size_t>(grid.rows) * grid.cols + 1
+			|| cell_offsets.front() != 0 || cell_offsets.back() != stop_ids.size()
+			|| !std::is_sorted(cell_offsets.begin(), cell_offsets.end()) || stop_ids.size() != stop_count;
+		std::vector<bool> indexed(stop_count);
+		for (size_t i = 0; !broken && i < stop_ids.size(); ++i) {
+			broken = stop_ids[i] >= stop_count || indexed[stop_ids[i]];
+			if (!broken) {
+				indexed[stop_ids[i]] = true;
+			}
+		}
+		if (broken) {
+			throw std::invalid_argument("The stops index of the base file is broken!"s);
+		}
+		tran_cat.SetStopsIndex(StopsIndex(grid, std::move(cell_offsets), std::move(stop_ids), tran_cat.GetDequeStops()));
+	}
+	else {
+		tran_cat.BuildStopsIndex();
+	}
 	return tran_cat;
 }
 
@@ -245,7 +341,7 @@ svg::Color MakeColor(const svg_serialize::Color& proto_color) {
 	return color;
 }
 
-transport_catalogue::rendering::RenderSettings DeserializeSerializeRenderSettings(const rendering_serialize::RenderSettings proto_render_settings) {
+transport_catalogue::rendering::RenderSettings DeserializeSerializeRenderSettings(const rendering_serialize::RenderSettings& proto_render_settings) {
 	transport_catalogue::rendering::RenderSettings render_settings{};
 	render_settings.width = proto_render_settings.width();
 	render_settings.height = proto_render_settings.height();
@@ -268,10 +364,36 @@ transport_catalogue::rendering::RenderSettings DeserializeSerializeRenderSetting
 		color_palette.push_back(MakeColor(proto_render_settings.color_palette(i)));
 	}
 	render_settings.color_palette = std::move(color_palette);
+	render_settings.polyline_tolerance = proto_render_settings.polyline_tolerance();
 
 	return render_settings;
 }
 
+rendering_serialize::Projection* SerializeProjection(const transport_catalogue::rendering::MapProjection& projection) {
+	auto proto_projection = new rendering_serialize::Projection;
+	proto_projection->set_min_lon(projection.min_lon);
+	proto_projection->set_max_lat(projection.max_lat);
+	proto_projection->set_zoom_coeff(projection.zoom_coeff);
+	*proto_projection->mutable_valid_stop_ids() = { projection.valid_stop_ids.begin(), projection.valid_stop_ids.end() };
+	auto proto_points = proto_projection->mutable_stop_points();
+	proto_points->Reserve(static_cast<int>(2 * projection.stop_points.size()));
+	for (const auto& point : projection.stop_points) {
+		proto_points->Add(point.x);
+		proto_points->Add(point.y);
+	}
+	return proto_projection;
+}
+
+transport_catalogue::rendering::MapProjection DeserializeProjection(const rendering_serialize::Projection& proto_projection) {
+	transport_catalogue::rendering::MapProjection projection{ proto_projection.min_lon(), proto_projection.max_lat(),
+		proto_projection.zoom_coeff(), { proto_projection.valid_stop_ids().begin(), proto_projection.valid_stop_ids().end() }, {} };
+	projection.stop_points.reserve(proto_projection.stop_points_size() / 2);
+	for (int i = 0; i + 1 < proto_projection.stop_points_size(); i += 2) {
+		projection.stop_points.push_back({ proto_projection.stop_points(i), proto_projection.stop_points(i + 1) });
+	}
+	return projection;
+}
+
 transport_catalogue::Item MakeItem(const graph_serialize::Item& proto_item,
 	const std::unordered_map<std::string_view, const Stop*>& stopname_to_stop,
 	const std::map<std::string_view, const Bus*>& busname_to_bus) {
@@ -280,6 +402,8 @@ transport_catalogue::Item MakeItem(const graph_serialize::Item& proto_item,
 	if (proto_item.type() == graph_serialize::ACTION_TYPE_BUS) {
 		item.type = transport_catalogue::ActionType::BUS;
 		item.name = busname_to_bus.at(proto_item.name())->name;
+		// only a ride has a span count, as in the graph the base was built with
+		item.span_count = proto_item.span_count();
 	}
 	else if (proto_item.type() == graph_serialize::ACTION_TYPE_WAIT) {
 		item.type = transport_catalogue::ActionType::WAIT;
@@ -288,10 +412,82 @@ transport_catalogue::Item MakeItem(const graph_serialize::Item& proto_item,
 	else {
 		item.type = transport_catalogue::ActionType::ITEM;
 	}
-	item.span_count = proto_item.span_count();
 	return item;
 }
 
+graph::Router<transport_catalogue::Item>::RoutesInternalData DeserializePackedRouter(const transport_router_serialize::PackedRouter& proto_router,
+	const graph::DirectedWeightedGraph<transport_catalogue::Item>& graph) {
+	using RouteInternalData = graph::Router<transport_catalogue::Item>::RouteInternalData;
+	const auto broken = [] {
+		return std::invalid_argument("The router table of the base file is broken!"s);
+	};
+	const size_t vertex_count = graph.GetVertexCount();
+	if (static_cast<size_t>(proto_router.prev_edges_size()) != vertex_count * vertex_count) {
+		throw broken();
+	}
+	const IncomingEdges incoming = MakeIncomingEdges(graph);
+	graph::Router<transport_catalogue::Item>::RoutesInternalData routes_internal_data(vertex_count,
+		std::vector<std::optional<RouteInternalData>>(vertex_count));
+	const uint32_t* value = proto_router.prev_edges().data();
+	int time = 0;
+	// routes whose time is summed from the route to the start of their last edge
+	std::vector<bool> summed(vertex_count);
+	std::vector<graph::VertexId> chain;
+	for (graph::VertexId from = 0; from < vertex_count; ++from) {
+		auto& row = routes_internal_data[from];
+		for (graph::VertexId to = 0; to < vertex_count; ++to, ++value) {
+			summed[to] = false;
+			if (*value == 0) {
+				continue;
+			}
+			if (*value == 1) {
+				row[to] = RouteInternalData{ transport_catalogue::Item{}, std::nullopt };
+				continue;
+			}
+			const size_t k = (*value - 2) / 2;
+			if (k >= incoming.offsets[to + 1] - incoming.offsets[to]) {
+				throw broken();
+			}
+			const graph::EdgeId edge_id = incoming.edge_ids[incoming.offsets[to] + k];
+			const auto& edge = graph.GetEdge(edge_id);
+			// a route of one edge weighs as much as the edge, with its name and span count
+			if (edge.from == from) {
+				row[to] = RouteInternalData{ edge.weight, edge_id };
+			}
+			else if ((*value - 2) % 2 == 1) {
+				if (time == proto_router.times_size()) {
+					throw broken();
+				}
+				row[to] = RouteInternalData{ transport_catalogue::Item(proto_router.times(time++)), edge_id };
+			}
+			else {
+				row[to] = RouteInternalData{ transport_catalogue::Item{}, edge_id };
+				summed[to] = true;
+			}
+		}
+		// a time is summed after the time of the route to the start of the last edge
+		for (graph::VertexId to = 0; to < vertex_count; ++to) {
+			for (graph::VertexId vertex = to; summed[vertex]; vertex = graph.GetEdge(*row[vertex]->prev_edge).from) {
+				if (chain.size() == vertex_count || !row[graph.GetEdge(*row[vertex]->prev_edge).from]) {
+					throw broken();
+				}
+				chain.push_back(vertex);
+			}
+			for (; !chain.empty(); chain.pop_back()) {
+				auto& data = *row[chain.back()];
+				const auto& edge = graph.GetEdge(*data.prev_edge);
+				data.weight = transport_catalogue::Item(row[edge.from]->weight.time + edge.weight.time);
+				summed[chain.back()] = false;
+			}
+		}
+	}
+	// every stored time belongs to a route
+	if (time != proto_router.times_size()) {
+		throw broken();
+	}
+	return routes_internal_data;
+}
+
 transport_router::TransportRouter DeserializeRouteSettings(const transport_router_serialize::TransportRouter& proto_tran_router,
 	const std::unordered_map<std::string_view, const Stop*>& stopname_to_stop,
 	const std::map<std::string_view, const Bus*>& busname_to_bus) {
@@ -320,13 +516,18 @@ transport_router::TransportRouter DeserializeRouteSettings(const transport_route
 	// Graph
 	
 	// StopnamesToVertex
-	std::map<std::string, transport_router::VertexId> valid_stopname_to_vertex;
+	transport_router::StopnameToVertex valid_stopname_to_vertex;
 	for (int i = 0; i < proto_tran_router.stopnames_to_vertex_size(); ++i) {
 		valid_stopname_to_vertex[proto_tran_router.stopnames_to_vertex(i).stopname()] = proto_tran_router.stopnames_to_vertex(i).vertex();
 	}
 	// StopnamesToVertex
 
 	// Router
+	if (proto_tran_router.has_packed_router()) {
+		auto router = std::make_unique<graph::Router<transport_catalogue::Item>>(*graph,
+			DeserializePackedRouter(proto_tran_router.packed_router(), *graph));
+		return { std::move(route_settings), std::move(graph), std::move(router), std::move(valid_stopname_to_vertex) };
+	}
 	auto& proto_router = proto_tran_router.router();
 	std::vector<std::vector<std::optional<graph::Router<transport_catalogue::Item>::RouteInternalData>>> routes_internal_data;
 	for (int i = 0; i < proto_router.routesinternaldata_size(); ++i) {
@@ -359,4 +560,46 @@ transport_catalogue_serialize::Facade* DeserializeFacade(std::string filename) {
 	}
 	return proto_facade;
 }
+
+std::unique_ptr<transport_catalogue::CatalogueSnapshot> DeserializeSnapshot(const std::string& filename) {
+	auto proto_facade = std::make_unique<transport_catalogue_serialize::Facade>();
+	std::ifstream in_file(filename, std::ios::binary);
+	// a server must not swap its base for an empty one because of a wrong file name
+	if (!in_file || !proto_facade->ParseFromIstream(&in_file)) {
+		throw std::invalid_argument("The base file \""s + filename + "\" can't be read!"s);
+	}
+	auto snapshot = std::make_unique<transport_catalogue::CatalogueSnapshot>();
+	const auto& proto_render_settings = proto_facade->render_settings();
+	// the projection keeps the valid stops in name order, so Freeze does not sort them again
+	std::vector<uint32_t> valid_stop_ids;
+	if (proto_render_settings.has_projection()) {
+		valid_stop_ids.assign(proto_render_settings.projection().valid_stop_ids().begin(),
+			proto_render_settings.projection().valid_stop_ids().end());
+	}
+	snapshot->tran_cat = DeserializeTransportCatalogue(proto_facade->tran_cat(), std::move(valid_stop_ids));
+	snapshot->map_render = rendering::MapRenderer{ DeserializeSerializeRenderSettings(proto_render_settings) };
+	if (proto_render_settings.has_projection()) {
+		snapshot->map_render.SetProjection(DeserializeProjection(proto_render_settings.projection()));
+	}
+	snapshot->transport_router = DeserializeRouteSettings(proto_facade->tran_router(),
+		snapshot->tran_cat.GetStopnameToStop(), snapshot->tran_cat.GetBusnameToBus());
+	if (proto_facade->has_prerendered_map()) {
+		auto proto_map = proto_facade->mutable_prerendered_map();
+		snapshot->map_cache->Set(rendering::PrerenderedMap{ proto_map->legacy_numbers() ? number_format::Mode::STREAM_COMPATIBLE : number_format::Mode::SHORTEST,
+			std::move(*proto_map->mutable_escaped_svg()) });
+	}
+	if (proto_facade->has_map_fragments()) {
+		auto proto_fragments = proto_facade->mutable_map_fragments();
+		rendering::MapFragments fragments;
+		fragments.number_mode = proto_fragments->legacy_numbers() ? number_format::Mode::STREAM_COMPATIBLE : number_format::Mode::SHORTEST;
+		fragments.text = std::move(*proto_fragments->mutable_escaped_text());
+		fragments.route_offsets.assign(proto_fragments->route_offsets().begin(), proto_fragments->route_offsets().end());
+		fragments.label_offsets.assign(proto_fragments->label_offsets().begin(), proto_fragments->label_offsets().end());
+		fragments.circle_offsets.assign(proto_fragments->circle_offsets().begin(), proto_fragments->circle_offsets().end());
+		fragments.stop_label_offsets.assign(proto_fragments->stop_label_offsets().begin(),
+			proto_fragments->stop_label_offsets().end());
+		snapshot->map_cache->Set(std::move(fragments));
+	}
+	return snapshot;
+}
 } //serialization
\ No newline at end of file
@@ -3,14 +3,23 @@
 
 #include "transport_catalogue.h"
 #include "map_renderer.h"
+#include "map_cache.h"
 #include "transport_router.h"
+#include "catalogue_snapshot.h"
+
+#include <memory>
+#include <vector>
 
 namespace serialization {
 transport_catalogue_serialize::TransportCatalogue* SerializeTransportCatalogue(const transport_catalogue::TransportCatalogue& tran_cat);
-transport_catalogue::TransportCatalogue DeserializeTransportCatalogue(const transport_catalogue_serialize::TransportCatalogue& proto_tran_cat);
+// valid_stop_ids in name order if they are known, e.g. stored with the projection; empty ones are found by Freeze
+transport_catalogue::TransportCatalogue DeserializeTransportCatalogue(const transport_catalogue_serialize::TransportCatalogue& proto_tran_cat,
+	std::vector<uint32_t>&& valid_stop_ids = {});
 
 rendering_serialize::RenderSettings* SerializeMapRender(const transport_catalogue::rendering::RenderSettings& render_settings);
-transport_catalogue::rendering::RenderSettings DeserializeSerializeRenderSettings(const rendering_serialize::RenderSettings proto_render_settings);
+transport_catalogue::rendering::RenderSettings DeserializeSerializeRenderSettings(const rendering_serialize::RenderSettings& proto_render_settings);
+rendering_serialize::Projection* SerializeProjection(const transport_catalogue::rendering::MapProjection& projection);
+transport_catalogue::rendering::MapProjection DeserializeProjection(const rendering_serialize::Projection& proto_projection);
 
 transport_router_serialize::TransportRouter* SerializeTransportRouter(const transport_router::TransportRouter& tran_router);
 transport_router::TransportRouter DeserializeRouteSettings(const transport_router_serialize::TransportRouter& proto_tran_router,
@@ -20,6 +29,9 @@ transport_router::TransportRouter DeserializeRouteSettings(const transport_route
 void SerializeFacade(const transport_catalogue::TransportCatalogue& tran_cat,
 	const transport_catalogue::rendering::MapRenderer& map_render,
 	const transport_router::TransportRouter& transport_router,
-	const std::string& filename);
+	const std::string& filename,
+	const transport_catalogue::rendering::MapFragments* map_fragments = nullptr);
 transport_catalogue_serialize::Facade* DeserializeFacade(std::string filename);
+// throws std::invalid_argument if the file is missing or is not a base
+std::unique_ptr<transport_catalogue::CatalogueSnapshot> DeserializeSnapshot(const std::string& filename);
 } //serialization
\ No newline at end of file
@@ -0,0 +1,257 @@
+#define _USE_MATH_DEFINES
+#include "stops_index.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+namespace transport_catalogue {
+
+namespace {
+const double EARTH_RADIUS = 6371000;
+const double DR = M_PI / 180.;
+// about two stops per cell on average
+const double STOPS_PER_CELL = 2.;
+
+bool CompareByDistance(const NearbyStop& lhs, const NearbyStop& rhs) {
+	return lhs.distance < rhs.distance;
+}
+} //namespace
+
+StopsIndex::StopsIndex(const std::deque<Stop>& stops) {
+	if (stops.empty()) {
+		return;
+	}
+	double min_lat = stops.front().coordinates.lat, max_lat = min_lat;
+	double min_lng = stops.front().coordinates.lng, max_lng = min_lng;
+	for (const auto& stop : stops) {
+		min_lat = std::min(min_lat, stop.coordinates.lat);
+		max_lat = std::max(max_lat, stop.coordinates.lat);
+		min_lng = std::min(min_lng, stop.coordinates.lng);
+		max_lng = std::max(max_lng, stop.coordinates.lng);
+	}
+	const uint32_t side = static_cast<uint32_t>(std::ceil(std::sqrt(stops.size() / STOPS_PER_CELL)));
+	grid_.min_lat = min_lat;
+	grid_.min_lng = min_lng;
+	grid_.rows = std::max<uint32_t>(side, 1);
+	grid_.cols = grid_.rows;
+	// the upper bound must fall into the last cell, so the cell is slightly widened
+	grid_.cell_lat = std::max((max_lat - min_lat) / grid_.rows, 1e-9) * (1 + 1e-9);
+	grid_.cell_lng = std::max((max_lng - min_lng) / grid_.cols, 1e-9) * (1 + 1e-9);
+
+	const size_t cells = static_cast<size_t>(grid_.rows) * grid_.cols;
+	std::vector<uint32_t> stop_cells;
+	stop_cells.reserve(stops.size());
+	cell_offsets_.assign(cells + 1, 0);
+	for (const auto& stop : stops) {
+		const uint32_t cell = GetRow(stop.coordinates.lat) * grid_.cols + GetCol(stop.coordinates.lng);
+		stop_cells.push_back(cell);
+		++cell_offsets_[cell + 1];
+	}
+	for (size_t i = 1; i <= cells; ++i) {
+		cell_offsets_[i] += cell_offsets_[i - 1];
+	}
+	stop_ids_.resize(stops.size());
+	std::vector<uint32_t> fill(cell_offsets_.begin(), std::prev(cell_offsets_.end()));
+	for (uint32_t id = 0; id < stop_cells.size(); ++id) {
+		stop_ids_[fill[stop_cells[id]]++] = id;
+	}
+	FillCellData(stops);
+}
+
+StopsIndex::StopsIndex(Grid grid, std::vector<uint32_t>&& cell_offsets, std::vector<uint32_t>&& stop_ids, const std::deque<Stop>& stops)
+	: grid_(grid)
+	, cell_offsets_(std::move(cell_offsets))
+	, stop_ids_(std::move(stop_ids))
+{
+	FillCellData(stops);
+}
+
+void StopsIndex::FillCellData(const std::deque<Stop>& stops) {
+	coordinates_.Reserve(stop_ids_.size());
+	stops_.reserve(stop_ids_.size());
+	max_abs_lat_ = 0;
+	for (const auto id : stop_ids_) {
+		const Stop& stop = stops.at(id);
+		coordinates_.Add(stop.trig);
+		stops_.push_back(&stop);
+		max_abs_lat_ = std::max(max_abs_lat_, std::abs(stop.coordinates.lat));
+	}
+}
+
+bool StopsIndex::IsEmpty() const {
+	return stop_ids_.empty();
+}
+
+uint32_t StopsIndex::GetRow(double lat) const {
+	const double row = std::floor((lat - grid_.min_lat) / grid_.cell_lat);
+	return static_cast<uint32_t>(std::clamp(row, 0., grid_.rows - 1.));
+}
+
+uint32_t StopsIndex::GetCol(double lng) const {
+	const double col = std::floor((lng - grid_.min_lng) / grid_.cell_lng);
+	return static_cast<uint32_t>(std::clamp(col, 0., grid_.cols - 1.));
+}
+
+void StopsIndex::ScanCell(uint32_t row, uint32_t col, const geo::CoordinatesTrig& center, double radius,
+	std::vector<double>& distances, std::vector<NearbyStop>& result) const {
+	const uint32_t cell = row * grid_.cols + col;
+	const uint32_t begin = cell_offsets_[cell];
+	const uint32_t size = cell_offsets_[cell + 1] - begin;
+	distances.resize(size);
+	geo::ComputeDistances(center, coordinates_.sin_lat.data() + begin, coordinates_.cos_lat.data() + begin,
+		coordinates_.lng.data() + begin, size, distances.data());
+	for (uint32_t i = 0; i < size; ++i) {
+		if (distances[i] <= radius) {
+			result.push_back({ stops_[begin + i], distances[i] });
+		}
+	}
+}
+
+double StopsIndex::GetColumnGap(uint32_t col, double lng) const {
+	const double from = grid_.min_lng + col * grid_.cell_lng;
+	// east of the column start, modulo the full circle
+	const double offset = lng - from - 360. * std::floor((lng - from) / 360.);
+	if (offset <= grid_.cell_lng) {
+		return 0;
+	}
+	// west to the column end or east round to its start
+	return std::min(offset - grid_.cell_lng, 360. - offset);
+}
+
+// Every stop outside the rings 0..ring around the center cell differs from the center
+// by more than ring cells in latitude or in the longitude gap of GetColumnGap
+double StopsIndex::GetRingLowerBound(uint32_t ring, double center_lat) const {
+	const double by_lat = EARTH_RADIUS * ring * grid_.cell_lat * DR;
+	const double max_lat = std::min(std::max(max_abs_lat_, std::abs(center_lat)), 90.);
+	const double half_lng = std::min(ring * grid_.cell_lng * DR / 2, M_PI / 2);
+	const double by_lng = EARTH_RADIUS * 2 * std::asin(std::cos(max_lat * DR) * std::sin(half_lng));
+	return std::min(by_lat, by_lng);
+}
+
+std::vector<NearbyStop> StopsIndex::FindInRadius(geo::Coordinates center, double radius) const {
+	std::vector<NearbyStop> result;
+	if (IsEmpty() || radius < 0) {
+		return result;
+	}
+	const double angle = radius / EARTH_RADIUS;
+	const double lat_delta = angle / DR;
+	const double max_lat = std::max(std::abs(center.lat - lat_delta), std::abs(center.lat + lat_delta));
+	std::vector<std::pair<uint32_t, uint32_t>> col_ranges;
+	// hav(d) >= cos^2(lat) * hav(dlng), so the longitude window is bounded unless it reaches a pole
+	const double sin_ratio = std::sin(std::min(angle, M_PI) / 2) / std::cos(std::min(max_lat, 90.) * DR);
+	if (max_lat < 90. && sin_ratio < 1.) {
+		const double lng_delta = 2 * std::asin(sin_ratio) / DR;
+		// the window is narrower than the circle, so it reaches the grid in one turn or, across the 180th meridian, in two
+		const double max_lng = grid_.min_lng + grid_.cols * grid_.cell_lng;
+		for (const double turn : { -360., 0., 360. }) {
+			const double from = center.lng - lng_delta + turn;
+			const double to = center.lng + lng_delta + turn;
+			if (to < grid_.min_lng || from > max_lng) {
+				continue;
+			}
+			// turns crossing the 180th meridian end in the edge columns, where they may meet
+			if (!col_ranges.empty() && col_ranges.back().second >= GetCol(from)) {
+				col_ranges.back().second = GetCol(to);
+			}
+			else {
+				col_ranges.push_back({ GetCol(from), GetCol(to) });
+			}
+		}
+	}
+	else {
+		col_ranges.push_back({ 0, grid_.cols - 1 });
+	}
+	const uint32_t row_from = GetRow(center.lat - lat_delta);
+	const uint32_t row_to = GetRow(center.lat + lat_delta);
+	const auto center_trig = geo::PrecomputeTrig(center);
+	std::vector<double> distances;
+	for (uint32_t row = row_from; row <= row_to; ++row) {
+		for (const auto& [col_from, col_to] : col_ranges) {
+			for (uint32_t col = col_from; col <= col_to; ++col) {
+				ScanCell(row, col, center_trig, radius, distances, result);
+			}
+		}
+	}
+	std::sort(result.begin(), result.end(), CompareByDistance);
+	return result;
+}
+
+std::vector<NearbyStop> StopsIndex::FindNearest(geo::Coordinates center, size_t count) const {
+	std::vector<NearbyStop> heap;
+	if (IsEmpty() || count == 0) {
+		return heap;
+	}
+	const int64_t center_row = GetRow(center.lat);
+	// Columns in the order of their ring: the number of cells of the longitude gap to the center,
+	// taken the short way round, so the columns across the 180th meridian are as near as they are on the Earth
+	std::vector<std::pair<uint32_t, uint32_t>> col_rings(grid_.cols);
+	for (uint32_t col = 0; col < grid_.cols; ++col) {
+		const double gap = GetColumnGap(col, center.lng);
+		col_rings[col] = { static_cast<uint32_t>(std::ceil(gap / grid_.cell_lng)), col };
+	}
+	std::sort(col_rings.begin(), col_rings.end());
+	const int64_t max_ring = std::max<int64_t>(grid_.rows, col_rings.back().first);
+	const auto center_trig = geo::PrecomputeTrig(center);
+	std::vector<double> distances;
+	std::vector<NearbyStop> candidates;
+	auto scan = [&](int64_t row, uint32_t col) {
+		if (row < 0 || row >= grid_.rows) {
+			return;
+		}
+		const double radius = heap.size() < count ? std::numeric_limits<double>::infinity() : heap.front().distance;
+		candidates.clear();
+		ScanCell(static_cast<uint32_t>(row), col, center_trig, radius, distances, candidates);
+		for (const auto& candidate : candidates) {
+			if (heap.size() < count) {
+				heap.push_back(candidate);
+				std::push_heap(heap.begin(), heap.end(), CompareByDistance);
+			}
+			else if (candidate.distance < heap.front().distance) {
+				std::pop_heap(heap.begin(), heap.end(), CompareByDistance);
+				heap.back() = candidate;
+				std::push_heap(heap.begin(), heap.end(), CompareByDistance);
+			}
+		}
+	};
+	// columns of the rings before the current one are col_rings[0 .. ring_from)
+	size_t ring_from = 0;
+	for (int64_t ring = 0; ring <= max_ring; ++ring) {
+		size_t ring_to = ring_from;
+		while (ring_to < col_rings.size() && col_rings[ring_to].first == ring) {
+			++ring_to;
+		}
+		// the top and bottom rows of the ring take every column up to it, the rows between only its own
+		for (size_t i = 0; i < ring_to; ++i) {
+			scan(center_row - ring, col_rings[i].second);
+			if (ring > 0) {
+				scan(center_row + ring, col_rings[i].second);
+			}
+		}
+		for (int64_t row = center_row - ring + 1; row < center_row + ring; ++row) {
+			for (size_t i = ring_from; i < ring_to; ++i) {
+				scan(row, col_rings[i].second);
+			}
+		}
+		ring_from = ring_to;
+		if (heap.size() == count && GetRingLowerBound(static_cast<uint32_t>(ring), center.lat) >= heap.front().distance) {
+			break;
+		}
+	}
+	std::sort_heap(heap.begin(), heap.end(), CompareByDistance);
+	return heap;
+}
+
+const StopsIndex::Grid& StopsIndex::GetGrid() const {
+	return grid_;
+}
+
+const std::vector<uint32_t>& StopsIndex::GetCellOffsets() const {
+	return cell_offsets_;
+}
+
+const std::vector<uint32_t>& StopsIndex::GetStopIds() const {
+	return stop_ids_;
+}
+} //namespace transport_catalogue
@@ -0,0 +1,62 @@
+#pragma once
+#include "geo.h"
+#include "domain.h"
+
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+namespace transport_catalogue {
+
+struct NearbyStop {
+	const Stop* stop;
+	double distance;
+};
+
+// Uniform lat/lng grid over the stops. Cells are stored as a compressed list:
+// stops of cell c are stop_ids_[cell_offsets_[c] .. cell_offsets_[c + 1]).
+// Candidates found through the grid are refined with geo::ComputeDistance.
+class StopsIndex {
+public:
+	struct Grid {
+		double min_lat = 0;
+		double min_lng = 0;
+		double cell_lat = 1;
+		double cell_lng = 1;
+		uint32_t rows = 0;
+		uint32_t cols = 0;
+	};
+
+	StopsIndex() = default;
+	explicit StopsIndex(const std::deque<Stop>& stops);
+	StopsIndex(Grid grid, std::vector<uint32_t>&& cell_offsets, std::vector<uint32_t>&& stop_ids, const std::deque<Stop>& stops);
+
+	bool IsEmpty() const;
+	// stops within radius meters of center, sorted by distance
+	std::vector<NearbyStop> FindInRadius(geo::Coordinates center, double radius) const;
+	// count stops closest to center, sorted by distance
+	std::vector<NearbyStop> FindNearest(geo::Coordinates center, size_t count) const;
+
+	// for serialization
+	const Grid& GetGrid() const;
+	const std::vector<uint32_t>& GetCellOffsets() const;
+	const std::vector<uint32_t>& GetStopIds() const;
+private:
+	Grid grid_;
+	std::vector<uint32_t> cell_offsets_;
+	std::vector<uint32_t> stop_ids_;
+	// copies of stop data in cell order, so a cell scan touches contiguous memory
+	geo::CoordinatesBatch coordinates_;
+	std::vector<const Stop*> stops_;
+	double max_abs_lat_ = 0;
+
+	void FillCellData(const std::deque<Stop>& stops);
+	uint32_t GetRow(double lat) const;
+	uint32_t GetCol(double lng) const;
+	// degrees of longitude from lng to the nearest edge of the column the short way round, 0 inside it
+	double GetColumnGap(uint32_t col, double lng) const;
+	void ScanCell(uint32_t row, uint32_t col, const geo::CoordinatesTrig& center, double radius,
+		std::vector<double>& distances, std::vector<NearbyStop>& result) const;
+	double GetRingLowerBound(uint32_t ring, double center_lat) const;
+};
+} //namespace transport_catalogue
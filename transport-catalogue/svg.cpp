@@ -2,26 +2,40 @@
 
 namespace svg {
  using namespace std::literals;
-std::ostream& operator<<(std::ostream& out, const StrokeLineCap line_cap) {
+std::string_view GetName(StrokeLineCap line_cap) {
     switch (line_cap) {
-    case StrokeLineCap::BUTT: return out << "butt"sv;
-    case StrokeLineCap::ROUND: return out << "round"sv;
-    case StrokeLineCap::SQUARE: return out << "square"sv;
-    default: return out << (int)line_cap;
+    case StrokeLineCap::BUTT: return "butt"sv;
+    case StrokeLineCap::ROUND: return "round"sv;
+    case StrokeLineCap::SQUARE: return "square"sv;
+    default: return {};
     }
 }
 
-std::ostream& operator<<(std::ostream& out, const StrokeLineJoin line_join) {
+std::string_view GetName(StrokeLineJoin line_join) {
     switch (line_join) {
-    case StrokeLineJoin::ARCS: return out << "arcs"sv;
-    case StrokeLineJoin::BEVEL: return out << "bevel"sv;
-    case StrokeLineJoin::MITER: return out << "miter"sv;
-    case StrokeLineJoin::MITER_CLIP: return out << "miter-clip"sv;
-    case StrokeLineJoin::ROUND: return out << "round"sv;
-    default: return out << (int)line_join;
+    case StrokeLineJoin::ARCS: return "arcs"sv;
+    case StrokeLineJoin::BEVEL: return "bevel"sv;
+    case StrokeLineJoin::MITER: return "miter"sv;
+    case StrokeLineJoin::MITER_CLIP: return "miter-clip"sv;
+    case StrokeLineJoin::ROUND: return "round"sv;
+    default: return {};
     }
 }
 
+std::ostream& operator<<(std::ostream& out, const StrokeLineCap line_cap) {
+    if (const auto name = GetName(line_cap); !name.empty()) {
+        return out << name;
+    }
+    return out << (int)line_cap;
+}
+
+std::ostream& operator<<(std::ostream& out, const StrokeLineJoin line_join) {
+    if (const auto name = GetName(line_join); !name.empty()) {
+        return out << name;
+    }
+    return out << (int)line_join;
+}
+
 Rgb::Rgb() = default;
 
 Rgb::Rgb(uint8_t red_in, uint8_t green_in, uint8_t blue_in)
@@ -50,11 +64,81 @@ void ColorPrinter::operator()(Rgb color) const {
 }
 
 void ColorPrinter::operator()(Rgba color) const {
-    out << "rgba("sv << static_cast<int>(color.red) << ","sv << static_cast<int>(color.green) << ","sv << static_cast<int>(color.blue) << ","sv << color.opacity << ")"sv;
+    out << "rgba("sv << static_cast<int>(color.red) << ","sv << static_cast<int>(color.green) << ","sv << static_cast<int>(color.blue) << ","sv;
+    number_format::Write(out, color.opacity, number_mode);
+    out << ")"sv;
+}
+
+void AppendColor(std::string& out, const Color& color, number_format::Mode number_mode) {
+    char buffer[number_format::MAX_SIZE];
+    const auto append_rgb = [&](auto rgb) {
+        out.append(buffer, number_format::Format(buffer, static_cast<int>(rgb.red)));
+        out.push_back(',');
+        out.append(buffer, number_format::Format(buffer, static_cast<int>(rgb.green)));
+        out.push_back(',');
+        out.append(buffer, number_format::Format(buffer, static_cast<int>(rgb.blue)));
+    };
+    if (std::holds_alternative<std::monostate>(color)) {
+        out += "none"sv;
+    }
+    else if (const auto* name = std::get_if<std::string>(&color)) {
+        out += *name;
+    }
+    else if (const auto* rgb = std::get_if<Rgb>(&color)) {
+        out += "rgb("sv;
+        append_rgb(*rgb);
+        out.push_back(')');
+    }
+    else {
+        const Rgba& rgba = std::get<Rgba>(color);
+        out += "rgba("sv;
+        append_rgb(rgba);
+        out.push_back(',');
+        out.append(buffer, number_format::Format(buffer, rgba.opacity, number_mode));
+        out.push_back(')');
+    }
 }
 
-const std::unordered_map<char, std::string> DICTIONARY{ {'"', "&quot;"}, {'\'', "&apos;"}, {'<', "&lt;"},
-    {'>', "&gt;"}, {'&', "&amp;"} };
+namespace {
+// Entity of every character escaped in a text, empty for the characters copied as they are
+constexpr std::array<std::string_view, 256> MakeEscapes() {
+    std::array<std::string_view, 256> escapes{};
+    escapes[static_cast<unsigned char>('"')] = "&quot;"sv;
+    escapes[static_cast<unsigned char>('\'')] = "&apos;"sv;
+    escapes[static_cast<unsigned char>('<')] = "&lt;"sv;
+    escapes[static_cast<unsigned char>('>')] = "&gt;"sv;
+    escapes[static_cast<unsigned char>('&')] = "&amp;"sv;
+    return escapes;
+}
+
+constexpr std::array<std::string_view, 256> ESCAPES = MakeEscapes();
+
+// Calls write(run) for every run of characters copied as they are and write(entity) for every escaped one
+template <typename Write>
+void EscapeText(std::string_view text, Write write) {
+    size_t run = 0;
+    for (size_t i = 0; i < text.size(); ++i) {
+        const std::string_view entity = ESCAPES[static_cast<unsigned char>(text[i])];
+        if (entity.empty()) {
+            continue;
+        }
+        if (i != run) {
+            write(text.substr(run, i - run));
+        }
+        write(entity);
+        run = i + 1;
+    }
+    if (run != text.size()) {
+        write(text.substr(run));
+    }
+}
+
+void AppendEscapedText(std::string& out, std::string_view text) {
+    EscapeText(text, [&out](std::string_view part) {
+        out += part;
+        });
+}
+} // namespace
 
 void Object::Render(const RenderContext& context) const {
     context.RenderIndent();
@@ -79,9 +163,15 @@ Circle& Circle::SetRadius(double radius) {
 
 void Circle::RenderObject(const RenderContext& context) const {
     auto& out = context.out;
-    out << "<circle cx=\""sv << center_.x << "\" cy=\""sv << center_.y << "\" "sv;
-    out << "r=\""sv << radius_ << "\" "sv;
-    RenderAttrs(context.out);
+    out << "<circle cx=\""sv;
+    context.RenderNumber(center_.x);
+    out << "\" cy=\""sv;
+    context.RenderNumber(center_.y);
+    out << "\" "sv;
+    out << "r=\""sv;
+    context.RenderNumber(radius_);
+    out << "\" "sv;
+    RenderAttrs(context);
     out << "/>"sv;
 }
 
@@ -92,23 +182,32 @@ Polyline& Polyline::AddPoint(Point point) {
     return *this;
 }
 
-std::string Polyline::GetPointsLine() const {
+std::string Polyline::GetPointsLine(number_format::Mode number_mode) const {
     std::stringstream out;
+    RenderPoints(RenderContext(out, 0, 0, number_mode));
+    return out.str();
+}
+
+void Polyline::RenderPoints(const RenderContext& context) const {
+    auto& out = context.out;
     bool is_first = true;
     for (const auto& point : points_) {
         if (!is_first) {
-            out << " "s;
+            out.put(' ');
         }
         is_first = false;
-        out << point.x << ","s << point.y;
+        context.RenderNumber(point.x);
+        out.put(',');
+        context.RenderNumber(point.y);
     }
-    return out.str();
 }
 
 void Polyline::RenderObject(const RenderContext& context) const {
     auto& out = context.out;
-    out << "<polyline points=\""sv << GetPointsLine() << "\" ";
-    RenderAttrs(context.out);
+    out << "<polyline points=\""sv;
+    RenderPoints(context);
+    out << "\" ";
+    RenderAttrs(context);
     out << "/>";
 }
 
@@ -147,8 +246,15 @@ Text& Text::SetData(std::string data) {
 void Text::RenderObject(const RenderContext& context) const {
     auto& out = context.out;
     out << "<text";
-    RenderAttrs(context.out);
-    out <<" x=\""sv << pos_.x << "\" y=\"" << pos_.y << "\" dx=\"" << offset_.x << "\" dy=\"" << offset_.y;
+    RenderAttrs(context);
+    out << " x=\""sv;
+    context.RenderNumber(pos_.x);
+    out << "\" y=\"";
+    context.RenderNumber(pos_.y);
+    out << "\" dx=\"";
+    context.RenderNumber(offset_.x);
+    out << "\" dy=\"";
+    context.RenderNumber(offset_.y);
     out << "\" font-size=\"" << size_;
     if (!font_family_.empty()) {
         out << "\" font-family=\"" << font_family_;
@@ -157,31 +263,267 @@ void Text::RenderObject(const RenderContext& context) const {
         out << "\" font-weight=\"" << font_weight_;
     }
     out << "\">"sv;
-    for (const char i : data_) {
-        if (DICTIONARY.count(i)) {
-            out << DICTIONARY.at(i);
-        }
-        else {
-            out << i;
-        }
-    }
+    EscapeText(data_, [&out](std::string_view part) {
+        out.write(part.data(), part.size());
+        });
     out  << "</text>"sv;
 }
 
+// ---------- PathStyle ------------------
+
+std::string PathStyle::FormatAttrs(number_format::Mode number_mode) const {
+    std::string out;
+    AppendAttrs(out, number_mode);
+    return out;
+}
+
+// ---------- TextStyle ------------------
+
+TextStyle& TextStyle::SetOffset(Point offset) {
+    offset_ = offset;
+    return *this;
+}
+
+TextStyle& TextStyle::SetFontSize(uint32_t size) {
+    size_ = size;
+    return *this;
+}
+
+TextStyle& TextStyle::SetFontFamily(std::string font_family) {
+    font_family_ = std::move(font_family);
+    return *this;
+}
+
+TextStyle& TextStyle::SetFontWeight(std::string font_weight) {
+    font_weight_ = std::move(font_weight);
+    return *this;
+}
+
+Point TextStyle::GetOffset() const {
+    return offset_;
+}
+
+uint32_t TextStyle::GetFontSize() const {
+    return size_;
+}
+
+std::string TextStyle::FormatAttrs(number_format::Mode number_mode) const {
+    std::string out;
+    AppendAttrs(out, number_mode);
+    return out;
+}
+
+std::string TextStyle::FormatTail(number_format::Mode number_mode) const {
+    char buffer[number_format::MAX_SIZE];
+    std::string out = "\" dx=\""s;
+    out.append(buffer, number_format::Format(buffer, offset_.x, number_mode));
+    out += "\" dy=\""sv;
+    out.append(buffer, number_format::Format(buffer, offset_.y, number_mode));
+    out += "\" font-size=\""sv;
+    out += std::to_string(size_);
+    if (!font_family_.empty()) {
+        out += "\" font-family=\""sv;
+        out += font_family_;
+    }
+    if (!font_weight_.empty()) {
+        out += "\" font-weight=\""sv;
+        out += font_weight_;
+    }
+    out += "\">"sv;
+    return out;
+}
+
 // ---------- Document ------------------
 
 void Document::AddPtr(std::unique_ptr<Object>&& obj) {
     objects_.emplace_back(std::move(obj));
 }
 
-void Document::Render(std::ostream& out) const {
+void Document::Render(std::ostream& out, number_format::Mode number_mode) const {
     out << "<?xml version=\"1.0\" encoding=\"UTF-8\" ?>"sv << std::endl;
     out << "<svg xmlns=\"http://www.w3.org/2000/svg\" version=\"1.1\">"sv << std::endl;
-    RenderContext ctx(out, 2, 2);
+    RenderContext ctx(out, 2, 2, number_mode);
     for (const auto& obj : objects_) {
         obj->Render(ctx);
     }
     out << "</svg>"sv;
 }
 
+// ---------- CompactDocument ------------------
+
+namespace {
+void AppendNumber(std::string& out, double value, number_format::Mode number_mode) {
+    char buffer[number_format::MAX_SIZE];
+    out.append(buffer, number_format::Format(buffer, value, number_mode));
+}
+} // namespace
+
+CompactDocument::StyleId CompactDocument::AddStyle(const PathStyle& style) {
+    std::string attrs = style.FormatAttrs(number_format::Mode::SHORTEST);
+    const auto [it, is_new] = style_ids_.emplace("p"s + attrs, static_cast<StyleId>(path_styles_.size()));
+    if (is_new) {
+        path_styles_.push_back(style);
+        path_tails_.push_back("\" "s + attrs + "/>\n"s);
+    }
+    return it->second;
+}
+
+CompactDocument::StyleId CompactDocument::AddStyle(const TextStyle& style) {
+    std::string attrs = style.FormatAttrs(number_format::Mode::SHORTEST);
+    std::string tail = style.FormatTail(number_format::Mode::SHORTEST);
+    const auto [it, is_new] = style_ids_.emplace("t"s + attrs + '\0' + tail, static_cast<StyleId>(text_styles_.size()));
+    if (is_new) {
+        text_styles_.push_back(style);
+        text_heads_.push_back("<text"s + attrs + " x=\""s);
+        text_tails_.push_back(std::move(tail));
+    }
+    return it->second;
+}
+
+void CompactDocument::AddCircle(Point center, double radius, StyleId path_style) {
+    order_.push_back(Kind::CIRCLE);
+    circles_.push_back({ center, radius, path_style });
+}
+
+void CompactDocument::StartPolyline(StyleId path_style) {
+    order_.push_back(Kind::POLYLINE);
+    polylines_.push_back({ points_.size(), path_style });
+}
+
+void CompactDocument::AddPoint(Point point) {
+    points_.push_back(point);
+    polylines_.back().points_end = points_.size();
+}
+
+void CompactDocument::AddText(Point position, std::string_view data, StyleId text_style) {
+    order_.push_back(Kind::TEXT);
+    AppendEscapedText(text_data_, data);
+    texts_.push_back({ position, text_data_.size(), text_style });
+}
+
+void CompactDocument::Clear() {
+    order_.clear();
+    circles_.clear();
+    polylines_.clear();
+    points_.clear();
+    texts_.clear();
+    text_data_.clear();
+    path_styles_.clear();
+    text_styles_.clear();
+    path_tails_.clear();
+    text_heads_.clear();
+    text_tails_.clear();
+    style_ids_.clear();
+}
+
+void CompactDocument::Render(std::string& out, number_format::Mode number_mode) const {
+    RenderBegin(out);
+    RenderObjects(out, number_mode);
+    RenderEnd(out);
+}
+
+void CompactDocument::RenderBegin(std::string& out) {
+    out += "<?xml version=\"1.0\" encoding=\"UTF-8\" ?>\n"sv;
+    out += "<svg xmlns=\"http://www.w3.org/2000/svg\" version=\"1.1\">\n"sv;
+}
+
+void CompactDocument::RenderBegin(std::string& out, Point view_min, double view_width, double view_height,
+    number_format::Mode number_mode) {
+    out += "<?xml version=\"1.0\" encoding=\"UTF-8\" ?>\n"sv;
+    out += "<svg xmlns=\"http://www.w3.org/2000/svg\" version=\"1.1\" viewBox=\""sv;
+    AppendNumber(out, view_min.x, number_mode);
+    out.push_back(' ');
+    AppendNumber(out, view_min.y, number_mode);
+    out.push_back(' ');
+    AppendNumber(out, view_width, number_mode);
+    out.push_back(' ');
+    AppendNumber(out, view_height, number_mode);
+    out += "\">\n"sv;
+}
+
+void CompactDocument::RenderEnd(std::string& out) {
+    out += "</svg>"sv;
+}
+
+void CompactDocument::RenderObjects(std::string& out, number_format::Mode number_mode,
+    std::vector<size_t>* object_ends) const {
+    // circles and polylines end with the same attributes; styles are formatted as SHORTEST when added
+    std::vector<std::string> other_path_tails;
+    std::vector<std::string> other_text_heads;
+    std::vector<std::string> other_text_tails;
+    if (number_mode != number_format::Mode::SHORTEST) {
+        other_path_tails.reserve(path_styles_.size());
+        for (const auto& style : path_styles_) {
+            other_path_tails.push_back("\" "s + style.FormatAttrs(number_mode) + "/>\n"s);
+        }
+        other_text_heads.reserve(text_styles_.size());
+        other_text_tails.reserve(text_styles_.size());
+        for (const auto& style : text_styles_) {
+            other_text_heads.push_back("<text"s + style.FormatAttrs(number_mode) + " x=\""s);
+            other_text_tails.push_back(style.FormatTail(number_mode));
+        }
+    }
+    const bool is_shortest = number_mode == number_format::Mode::SHORTEST;
+    const auto& path_tails = is_shortest ? path_tails_ : other_path_tails;
+    const auto& text_heads = is_shortest ? text_heads_ : other_text_heads;
+    const auto& text_tails = is_shortest ? text_tails_ : other_text_tails;
+
+    size_t circle = 0;
+    size_t polyline = 0;
+    size_t point = 0;
+    size_t text = 0;
+    size_t data = 0;
+    for (const Kind kind : order_) {
+        out += "  "sv;
+        switch (kind) {
+        case Kind::CIRCLE: {
+            const CircleItem& item = circles_[circle++];
+            out += "<circle cx=\""sv;
+            AppendNumber(out, item.center.x, number_mode);
+            out += "\" cy=\""sv;
+            AppendNumber(out, item.center.y, number_mode);
+            out += "\" r=\""sv;
+            AppendNumber(out, item.radius, number_mode);
+            out += path_tails[item.style];
+            break;
+        }
+        case Kind::POLYLINE: {
+            const PolylineItem& item = polylines_[polyline++];
+            out += "<polyline points=\""sv;
+            for (const size_t begin = point; point < item.points_end; ++point) {
+                if (point != begin) {
+                    out.push_back(' ');
+                }
+                AppendNumber(out, points_[point].x, number_mode);
+                out.push_back(',');
+                AppendNumber(out, points_[point].y, number_mode);
+            }
+            out += path_tails[item.style];
+            break;
+        }
+        case Kind::TEXT: {
+            const TextItem& item = texts_[text++];
+            out += text_heads[item.style];
+            AppendNumber(out, item.position.x, number_mode);
+            out += "\" y=\""sv;
+            AppendNumber(out, item.position.y, number_mode);
+            out += text_tails[item.style];
+            out.append(text_data_, data, item.data_end - data);
+            data = item.data_end;
+            out += "</text>\n"sv;
+            break;
+        }
+        }
+        if (object_ends) {
+            object_ends->push_back(out.size());
+        }
+    }
+}
+
+void CompactDocument::Render(std::ostream& out, number_format::Mode number_mode) const {
+    std::string buffer;
+    Render(buffer, number_mode);
+    out.write(buffer.data(), buffer.size());
+}
+
 }  // namespace svg
\ No newline at end of file
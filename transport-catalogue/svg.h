@@ -1,9 +1,13 @@
 #pragma once
 
+#include "number_format.h"
+
+#include <array>
 #include <cstdint>
 #include <iostream>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <sstream>
 #include <unordered_map>
@@ -26,6 +30,10 @@ enum class StrokeLineJoin {
     ROUND,
 };
 
+// Значение атрибута; пустая строка для значения вне перечисления
+std::string_view GetName(StrokeLineCap line_cap);
+std::string_view GetName(StrokeLineJoin line_join);
+
 std::ostream& operator<<(std::ostream& out, const StrokeLineCap line_cap);
 
 std::ostream& operator<<(std::ostream& out, const StrokeLineJoin line_join);
@@ -54,6 +62,7 @@ inline const Color NoneColor{ std::monostate{} };
 
 struct ColorPrinter {
     std::ostream& out;
+    number_format::Mode number_mode = number_format::Mode::SHORTEST;
 
     void operator()(std::monostate) const;
     void operator()(std::string color) const;
@@ -61,6 +70,9 @@ struct ColorPrinter {
     void operator()(Rgba color) const;
 };
 
+// Дописывает цвет так же, как его выводит ColorPrinter, но без потока
+void AppendColor(std::string& out, const Color& color, number_format::Mode number_mode = number_format::Mode::SHORTEST);
+
 inline std::ostream& operator<<(std::ostream& out, Color color) {
     using namespace std::literals;
     std::visit(ColorPrinter{ out }, color);
@@ -86,14 +98,20 @@ struct RenderContext {
         : out(out) {
     }
 
-    RenderContext(std::ostream& out, int indent_step, int indent = 0)
+    RenderContext(std::ostream& out, int indent_step, int indent = 0,
+        number_format::Mode number_mode = number_format::Mode::SHORTEST)
         : out(out)
         , indent_step(indent_step)
-        , indent(indent) {
+        , indent(indent)
+        , number_mode(number_mode) {
     }
 
     RenderContext Indented() const {
-        return { out, indent_step, indent + indent_step };
+        return { out, indent_step, indent + indent_step, number_mode };
+    }
+
+    void RenderNumber(double value) const {
+        number_format::Write(out, value, number_mode);
     }
 
     void RenderIndent() const {
@@ -105,6 +123,7 @@ struct RenderContext {
     std::ostream& out;
     int indent_step = 0;
     int indent = 0;
+    number_format::Mode number_mode = number_format::Mode::SHORTEST;
 };
 
 /*
@@ -146,24 +165,37 @@ public:
         return AsOwner();
     }
 
+    const std::optional<Color>& GetFillColor() const {
+        return fill_color_;
+    }
+    const std::optional<Color>& GetStrokeColor() const {
+        return stroke_color_;
+    }
+    std::optional<double> GetStrokeWidth() const {
+        return stroke_width_;
+    }
+
 protected:
     ~PathProps() = default;
 
-    void RenderAttrs(std::ostream& out) const {
+    void RenderAttrs(const RenderContext& context) const {
         using namespace std::literals;
+        auto& out = context.out;
 
         if (fill_color_) {
             out << " fill=\""sv;
-            out << *fill_color_;
+            std::visit(ColorPrinter{ out, context.number_mode }, *fill_color_);
             out << "\""sv;
         }
         if (stroke_color_) {
             out << " stroke=\""sv;
-            out << *stroke_color_;
+            std::visit(ColorPrinter{ out, context.number_mode }, *stroke_color_);
             out << "\""sv;
         }
         if (stroke_width_) {
-            out << " stroke-width=\""sv << *stroke_width_ << "\""sv;
+            out << " stroke-width=\""sv;
+            context.RenderNumber(*stroke_width_);
+            out << "\""sv;
         }
         if (stroke_linecap_) {
             out << " stroke-linecap=\""sv << *stroke_linecap_ << "\""sv;
@@ -173,7 +205,49 @@ protected:
         }
     }
 
+    // Те же атрибуты, что выводит RenderAttrs, дописанные в строку
+    void AppendAttrs(std::string& out, number_format::Mode number_mode) const {
+        using namespace std::literals;
+        if (fill_color_) {
+            out += " fill=\""sv;
+            AppendColor(out, *fill_color_, number_mode);
+            out += "\""sv;
+        }
+        if (stroke_color_) {
+            out += " stroke=\""sv;
+            AppendColor(out, *stroke_color_, number_mode);
+            out += "\""sv;
+        }
+        if (stroke_width_) {
+            out += " stroke-width=\""sv;
+            char buffer[number_format::MAX_SIZE];
+            out.append(buffer, number_format::Format(buffer, *stroke_width_, number_mode));
+            out += "\""sv;
+        }
+        if (stroke_linecap_) {
+            out += " stroke-linecap=\""sv;
+            AppendName(out, GetName(*stroke_linecap_), static_cast<int>(*stroke_linecap_));
+            out += "\""sv;
+        }
+        if (stroke_linejoin_) {
+            out += " stroke-linejoin=\""sv;
+            AppendName(out, GetName(*stroke_linejoin_), static_cast<int>(*stroke_linejoin_));
+            out += "\""sv;
+        }
+    }
+
 private:
+    // значение вне перечисления выводится числом, как его выводит operator<<
+    static void AppendName(std::string& out, std::string_view name, int value) {
+        if (name.empty()) {
+            char buffer[number_format::MAX_SIZE];
+            out.append(buffer, number_format::Format(buffer, value));
+        }
+        else {
+            out += name;
+        }
+    }
+
     Owner& AsOwner() {
         // static_cast безопасно преобразует *this к Owner&,
         // если класс Owner — наследник PathProps
@@ -204,9 +278,10 @@ class Polyline final : public Object, public PathProps<Polyline> {
 public:
     // Добавляет очередную вершину к ломаной линии
     Polyline& AddPoint(Point point);
-    std::string GetPointsLine() const;
+    std::string GetPointsLine(number_format::Mode number_mode = number_format::Mode::SHORTEST) const;
 private:
     void RenderObject(const RenderContext& context) const override;
+    void RenderPoints(const RenderContext& context) const;
 
     std::vector<Point> points_;
 };
@@ -242,6 +317,34 @@ private:
     std::string data_;
 };
 
+// Стиль круга или ломаной: атрибуты PathProps отдельно от объекта
+class PathStyle final : public PathProps<PathStyle> {
+public:
+    // Атрибуты в том виде, в каком их выводит объект с этим стилем
+    std::string FormatAttrs(number_format::Mode number_mode) const;
+};
+
+// Стиль текста: всё, кроме опорной точки и содержимого
+class TextStyle final : public PathProps<TextStyle> {
+public:
+    TextStyle& SetOffset(Point offset);
+    TextStyle& SetFontSize(uint32_t size);
+    TextStyle& SetFontFamily(std::string font_family);
+    TextStyle& SetFontWeight(std::string font_weight);
+
+    Point GetOffset() const;
+    uint32_t GetFontSize() const;
+
+    std::string FormatAttrs(number_format::Mode number_mode) const;
+    // Атрибуты после y: от закрывающей кавычки y до конца открывающего тега
+    std::string FormatTail(number_format::Mode number_mode) const;
+private:
+    Point offset_ = { 0.0, 0.0 };
+    uint32_t size_ = 1;
+    std::string font_family_;
+    std::string font_weight_;
+};
+
 class ObjectContainer {
 public:
     void virtual AddPtr(std::unique_ptr<Object>&& obj) = 0;
@@ -266,10 +369,123 @@ public:
     void AddPtr(std::unique_ptr<Object>&& obj) override;
 
     // Выводит в ostream svg-представление документа
-    void Render(std::ostream& out) const;
+    void Render(std::ostream& out, number_format::Mode number_mode = number_format::Mode::SHORTEST) const;
 
 private:
     std::vector<std::unique_ptr<Object>> objects_;
 };
 
+/*
+    * Документ из объектов-значений: круги, ломаные и тексты лежат в массивах по типам,
+    * вершины ломаных и экранированное содержимое текстов - в общих буферах,
+    * а одинаковые стили хранятся один раз.
+    * Стили форматируются один раз за Render, документ дописывается в буфер символов.
+    * Выводит то же, что и Document с теми же объектами, добавленными в том же порядке
+    */
+class CompactDocument {
+public:
+    using StyleId = uint32_t;
+
+    // Равные стили получают один и тот же номер; у стилей текста свои номера
+    StyleId AddStyle(const PathStyle& style);
+    StyleId AddStyle(const TextStyle& style);
+
+    void AddCircle(Point center, double radius, StyleId path_style);
+    // Начинает ломаную, вершины к ней добавляет AddPoint
+    void StartPolyline(StyleId path_style);
+    void AddPoint(Point point);
+    void AddText(Point position, std::string_view data, StyleId text_style);
+    // Удаляет объекты и стили, память под них остаётся
+    void Clear();
+
+    void Render(std::string& out, number_format::Mode number_mode = number_format::Mode::SHORTEST) const;
+    void Render(std::ostream& out, number_format::Mode number_mode = number_format::Mode::SHORTEST) const;
+
+    // Render по частям: документ из нескольких CompactDocument - это RenderBegin,
+    // RenderObjects каждого из них по порядку и RenderEnd
+    static void RenderBegin(std::string& out);
+    // С атрибутом viewBox: видна только эта часть документа
+    static void RenderBegin(std::string& out, Point view_min, double view_width, double view_height,
+        number_format::Mode number_mode = number_format::Mode::SHORTEST);
+    // В object_ends, если он задан, дописывается размер out после каждого объекта
+    void RenderObjects(std::string& out, number_format::Mode number_mode = number_format::Mode::SHORTEST,
+        std::vector<size_t>* object_ends = nullptr) const;
+    static void RenderEnd(std::string& out);
+
+    // Обходит объекты в порядке вывода: visitor.Circle(center, radius, style),
+    // visitor.Polyline(first, last, style) для вершин [first, last) и visitor.Text(position, data, style),
+    // где data - экранированное содержимое текста
+    template <typename Visitor>
+    void VisitObjects(Visitor& visitor) const {
+        size_t circle = 0;
+        size_t polyline = 0;
+        size_t point = 0;
+        size_t text = 0;
+        size_t data = 0;
+        for (const Kind kind : order_) {
+            switch (kind) {
+            case Kind::CIRCLE: {
+                const CircleItem& item = circles_[circle++];
+                visitor.Circle(item.center, item.radius, path_styles_[item.style]);
+                break;
+            }
+            case Kind::POLYLINE: {
+                const PolylineItem& item = polylines_[polyline++];
+                visitor.Polyline(points_.data() + point, points_.data() + item.points_end, path_styles_[item.style]);
+                point = item.points_end;
+                break;
+            }
+            case Kind::TEXT: {
+                const TextItem& item = texts_[text++];
+                visitor.Text(item.position, std::string_view(text_data_).substr(data, item.data_end - data),
+                    text_styles_[item.style]);
+                data = item.data_end;
+                break;
+            }
+            }
+        }
+    }
+
+private:
+    enum class Kind : uint8_t {
+        CIRCLE,
+        POLYLINE,
+        TEXT,
+    };
+
+    struct CircleItem {
+        Point center;
+        double radius;
+        StyleId style;
+    };
+
+    // Вершины ломаной - points_ от конца предыдущей ломаной до points_end
+    struct PolylineItem {
+        size_t points_end;
+        StyleId style;
+    };
+
+    struct TextItem {
+        Point position;
+        size_t data_end;
+        StyleId style;
+    };
+
+    std::vector<Kind> order_;
+    std::vector<CircleItem> circles_;
+    std::vector<PolylineItem> polylines_;
+    std::vector<Point> points_;
+    std::vector<TextItem> texts_;
+    std::string text_data_;
+
+    std::vector<PathStyle> path_styles_;
+    std::vector<TextStyle> text_styles_;
+    // Стили, выведенные в режиме SHORTEST при добавлении: Render в этом режиме их не форматирует
+    std::vector<std::string> path_tails_;
+    std::vector<std::string> text_heads_;
+    std::vector<std::string> text_tails_;
+    // стиль, выведенный в режиме SHORTEST, -> номер стиля
+    std::unordered_map<std::string, StyleId> style_ids_;
+};
+
 }  // namespace svg
\ No newline at end of file
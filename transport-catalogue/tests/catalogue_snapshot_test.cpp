@@ -0,0 +1,261 @@
+#include "catalogue_snapshot.h"
+#include "json_reader.h"
+#include "request_server.h"
+#include "check.h"
+
+#include <atomic>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace transport_catalogue;
+using namespace std::literals;
+
+namespace {
+// stops A, B, C and the bus going A - B - C
+std::unique_ptr<CatalogueSnapshot> MakeSnapshot(std::string bus = "1"s) {
+	CatalogueBuilder builder;
+	builder.AddStop("A"sv, { 55.60, 37.20 });
+	builder.AddStop("B"sv, { 55.61, 37.21 });
+	builder.AddStop("C"sv, { 55.62, 37.22 });
+	builder.AddDistance("A"sv, "B"sv, 1000);
+	builder.AddDistance("B"sv, "C"sv, 2000);
+	builder.AddBus(std::move(bus), { builder.InternStop("A"sv), builder.InternStop("B"sv), builder.InternStop("C"sv) }, TypeRoute::line);
+	auto snapshot = std::make_unique<CatalogueSnapshot>();
+	snapshot->tran_cat = builder.Build();
+	snapshot->map_render = rendering::MapRenderer(rendering::RenderSettings{ 600, 400, 50, 14, 5, 20, { 7, 15 }, 20, { 7, -3 },
+		svg::Rgba(255, 255, 255, 0.85), 3, { svg::Color("green"s) } });
+	snapshot->transport_router = transport_router::TransportRouter(snapshot->tran_cat, RouteSettings{ 40, 6 });
+	return snapshot;
+}
+
+// the bus with this name going from A to a new stop
+CatalogueUpdate MakeBusUpdate(const std::string& name) {
+	CatalogueUpdate update;
+	update.stops.push_back({ "Stop "s + name, { 55.63, 37.23 } });
+	update.distances.push_back({ "A"s, "Stop "s + name, 3000 });
+	update.buses.push_back({ name, { "A"s, "Stop "s + name }, TypeRoute::line });
+	return update;
+}
+
+void TestReaderKeepsItsVersion() {
+	SnapshotPublisher publisher(MakeSnapshot());
+	{
+		const auto before = publisher.Acquire();
+		publisher.Update(MakeBusUpdate("2"s));
+
+		const auto after = publisher.Acquire();
+		CHECK(before->version == 0);
+		CHECK(before->tran_cat.FindBus("2"sv) == nullptr);
+		CHECK(before->tran_cat.GetStopnameToStop().count("Stop 2"sv) == 0);
+		CHECK(after->version == 1);
+		CHECK(after->tran_cat.FindBus("2"sv) != nullptr);
+		CHECK(after->tran_cat.GetInfromBus("2"sv)->length == 6000);
+		CHECK(after->tran_cat.GetInfromBus("1"sv)->length == 6000);
+		// the reader of the old version still holds it
+		CHECK(publisher.GetRetiredCount() == 1);
+	}
+	// and released it last, so it deleted it
+	CHECK(publisher.GetRetiredCount() == 0);
+}
+
+void TestUpdateReplacesStopsAndBuses() {
+	SnapshotPublisher publisher(MakeSnapshot());
+	CatalogueUpdate update;
+	update.stops.push_back({ "B"s, { 55.70, 37.30 } });
+	update.distances.push_back({ "A"s, "B"s, 1500 });
+	update.buses.push_back({ "1"s, { "A"s, "B"s }, TypeRoute::circle });
+	publisher.Update(update);
+
+	const auto snapshot = publisher.Acquire();
+	CHECK(snapshot->tran_cat.FindStop("B"sv)->coordinates.lat == 55.70);
+	CHECK(snapshot->tran_cat.GetDequeStops().size() == 3);
+	const auto bus_info = snapshot->tran_cat.GetInfromBus("1"sv);
+	CHECK(bus_info->amount_stops == 2);
+	CHECK(snapshot->transport_router.FindRoute("A"sv, "B"sv).has_value());
+	CHECK(!snapshot->transport_router.FindRoute("A"sv, "C"sv).has_value());
+}
+
+void TestUnknownStopIsRejected() {
+	SnapshotPublisher publisher(MakeSnapshot());
+	CatalogueUpdate update;
+	update.buses.push_back({ "2"s, { "A"s, "Nowhere"s }, TypeRoute::line });
+	bool thrown = false;
+	try {
+		publisher.Update(update);
+	}
+	catch (const std::invalid_argument&) {
+		thrown = true;
+	}
+	CHECK(thrown);
+	CHECK(publisher.GetVersion() == 0);
+}
+
+// every update adds one bus, so a reader sees version + 1 buses whatever it runs into
+void TestConcurrentReaders() {
+	SnapshotPublisher publisher(MakeSnapshot());
+	constexpr int UPDATES = 8;
+	std::atomic<bool> done = false;
+	std::atomic<int> inconsistent = 0;
+	std::vector<std::thread> readers;
+	for (int i = 0; i < 4; ++i) {
+		readers.emplace_back([&] {
+			while (!done) {
+				const auto snapshot = publisher.Acquire();
+				if (snapshot->tran_cat.GetBusnameToBus().size() != snapshot->version + 1) {
+					++inconsistent;
+				}
+			}
+			});
+	}
+	for (int i = 0; i < UPDATES; ++i) {
+		publisher.Update(MakeBusUpdate("Update "s + std::to_string(i)));
+	}
+	done = true;
+	for (auto& reader : readers) {
+		reader.join();
+	}
+	CHECK(inconsistent == 0);
+	CHECK(publisher.GetVersion() == UPDATES);
+	// the last reader to leave deleted what was retired
+	CHECK(publisher.GetRetiredCount() == 0);
+}
+
+void TestServeUpdateBatch() {
+	handle_iformation::RequestServer server([](const std::string&) {
+		return MakeSnapshot();
+		}, std::cerr);
+	std::istringstream input(
+		R"({"serialization_settings": {"file": "base.db"}, "stat_requests": [{"id": 1, "type": "Bus", "name": "2"}]})" "\n"
+		R"({"base_requests": [{"type": "Stop", "name": "D", "latitude": 55.63, "longitude": 37.23, "road_distances": {"C": 500}},)"
+		R"( {"type": "Bus", "name": "2", "stops": ["C", "D"], "is_roundtrip": false}],)"
+		R"( "stat_requests": [{"id": 2, "type": "Bus", "name": "2"}]})" "\n"
+		R"({"base_requests": [{"type": "Bus", "name": "3", "stops": ["C", "E"], "is_roundtrip": false}]})" "\n"
+		R"({"stat_requests": [{"id": 3, "type": "Bus", "name": "2"}]})" "\n");
+	std::ostringstream output;
+	server.Serve(input, output);
+
+	std::istringstream answers(output.str());
+	std::string line;
+	std::vector<json::Document> documents;
+	while (std::getline(answers, line)) {
+		documents.push_back(json::Load(std::string_view(line)));
+	}
+	CHECK(documents.size() == 4);
+	if (documents.size() != 4) {
+		return;
+	}
+	CHECK(documents[0].GetRoot().AsArray().at(0).AsDict().at("error_message"s).AsString() == "not found"s);
+	const auto& updated = documents[1].GetRoot().AsArray().at(0).AsDict();
+	CHECK(updated.at("stop_count"s).AsInt() == 3);
+	CHECK(updated.at("route_length"s).AsDouble() == 1000);
+	// an update naming an unknown stop is an error of its batch and changes nothing
+	CHECK(documents[2].GetRoot().AsDict().count("error_message"s) == 1);
+	CHECK(documents[3].GetRoot().AsArray().at(0).AsDict().at("stop_count"s).AsInt() == 3);
+}
+
+// a base is loaded once per file name, whatever the loader throws is answered with an error
+void TestServeLoadsBaseOnce() {
+	int loads = 0;
+	handle_iformation::RequestServer server([&loads](const std::string& file) {
+		if (file == "broken.db"s) {
+			throw "not a base";
+		}
+		++loads;
+		return MakeSnapshot();
+		}, std::cerr);
+	std::istringstream input(
+		R"({"stat_requests": [{"id": 1, "type": "Bus", "name": "1"}]})" "\n"
+		R"({"serialization_settings": {"file": "base.db"}, "stat_requests": [{"id": 2, "type": "Bus", "name": "1"}]})" "\n"
+		R"({"serialization_settings": {"file": "base.db"}, "stat_requests": [{"id": 3, "type": "Bus", "name": "1"}]})" "\n"
+		R"({"serialization_settings": {"file": "broken.db"}, "stat_requests": [{"id": 4, "type": "Bus", "name": "1"}]})" "\n"
+		R"({"stat_requests": [{"id": 5, "type": "Bus", "name": "1"}]})" "\n"
+		R"({"serialization_settings": {"file": "other.db"}, "stat_requests": [{"id": 6, "type": "Bus", "name": "1"}]})" "\n");
+	std::ostringstream output;
+	server.Serve(input, output);
+
+	std::istringstream answers(output.str());
+	std::string line;
+	std::vector<json::Document> documents;
+	while (std::getline(answers, line)) {
+		documents.push_back(json::Load(std::string_view(line)));
+	}
+	CHECK(documents.size() == 6);
+	if (documents.size() != 6) {
+		return;
+	}
+	CHECK(documents[0].GetRoot().AsDict().at("error_message"s).AsString() == "serialization_settings are not set!"s);
+	CHECK(documents[1].GetRoot().AsArray().at(0).AsDict().at("stop_count"s).AsInt() == 5);
+	CHECK(documents[2].GetRoot().AsArray().at(0).AsDict().at("stop_count"s).AsInt() == 5);
+	CHECK(documents[3].GetRoot().AsDict().at("error_message"s).AsString() == "unknown error"s);
+	CHECK(documents[4].GetRoot().AsArray().at(0).AsDict().at("stop_count"s).AsInt() == 5);
+	CHECK(documents[5].GetRoot().AsArray().at(0).AsDict().at("stop_count"s).AsInt() == 5);
+	CHECK(loads == 2);
+}
+
+// Two connections alternate batches naming their own bases, every other one with an update.
+// Each batch is answered from its own base whatever the other connection publishes meanwhile
+void TestServeAnswersFromItsBase() {
+	handle_iformation::RequestServer server([](const std::string& file) {
+		return MakeSnapshot(file == "a.db"s ? "A"s : "B"s);
+		}, std::cerr);
+	constexpr int BATCHES = 200;
+	std::atomic<int> wrong = 0;
+	auto connection = [&server, &wrong](const std::string& file, const std::string& own, const std::string& other) {
+		std::string input;
+		for (int i = 0; i < BATCHES; ++i) {
+			input += R"({"serialization_settings": {"file": ")"s + file + R"("},)"s;
+			if (i % 2) {
+				input += R"( "base_requests": [{"type": "Bus", "name": ")"s + own + std::to_string(i)
+					+ R"(", "stops": ["A", "B"], "is_roundtrip": false}],)"s;
+			}
+			input += R"( "stat_requests": [{"id": 1, "type": "Bus", "name": ")"s + own
+				+ R"("}, {"id": 2, "type": "Bus", "name": ")"s + other + R"("}, {"id": 3, "type": "Bus", "name": ")"s
+				+ own + std::to_string(i | 1) + R"("}]})"s + "\n"s;
+		}
+		std::istringstream in(input);
+		std::ostringstream out;
+		server.Serve(in, out);
+
+		std::istringstream answers(out.str());
+		std::string line;
+		int count = 0;
+		while (std::getline(answers, line)) {
+			const json::Document document = json::Load(std::string_view(line));
+			const bool updated = count % 2 == 1;
+			++count;
+			if (!document.GetRoot().IsArray()) {
+				++wrong;
+				continue;
+			}
+			const auto& responses = document.GetRoot().AsArray();
+			if (responses.at(0).AsDict().count("stop_count"s) == 0
+				|| responses.at(1).AsDict().count("error_message"s) == 0
+				|| (responses.at(2).AsDict().count("stop_count"s) == 1) != updated) {
+				++wrong;
+			}
+		}
+		if (count != BATCHES) {
+			++wrong;
+		}
+	};
+	std::thread first(connection, "a.db"s, "A"s, "B"s);
+	std::thread second(connection, "b.db"s, "B"s, "A"s);
+	first.join();
+	second.join();
+	CHECK(wrong == 0);
+}
+} //namespace
+
+int main() {
+	RUN_TEST(TestReaderKeepsItsVersion);
+	RUN_TEST(TestUpdateReplacesStopsAndBuses);
+	RUN_TEST(TestUnknownStopIsRejected);
+	RUN_TEST(TestConcurrentReaders);
+	RUN_TEST(TestServeUpdateBatch);
+	RUN_TEST(TestServeLoadsBaseOnce);
+	RUN_TEST(TestServeAnswersFromItsBase);
+	return tests::FailureCount() == 0 ? 0 : 1;
+}
\ No newline at end of file
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <exception>
+#include <iostream>
+
+// Checks of the test executables: a failed check is reported and the test ends with a nonzero code
+namespace tests {
+inline int& FailureCount() {
+	static int count = 0;
+	return count;
+}
+
+inline void ReportFailure(const char* expression, const char* file, int line) {
+	std::cerr << file << ':' << line << ": check failed: " << expression << std::endl;
+	++FailureCount();
+}
+
+// runs a test function, an escaped exception is a failure
+template <typename Test>
+void Run(const char* name, Test test) {
+	const int failures = FailureCount();
+	try {
+		test();
+	}
+	catch (const std::exception& e) {
+		std::cerr << name << ": exception: " << e.what() << std::endl;
+		++FailureCount();
+	}
+	catch (...) {
+		std::cerr << name << ": unknown exception" << std::endl;
+		++FailureCount();
+	}
+	std::cerr << name << (FailureCount() == failures ? ": OK" : ": FAILED") << std::endl;
+}
+} //namespace tests
+
+#define CHECK(expression) \
+	do { \
+		if (!(expression)) { \
+			tests::ReportFailure(#expression, __FILE__, __LINE__); \
+		} \
+	} while (false)
+
+#define RUN_TEST(test) tests::Run(#test, test)
\ No newline at end of file
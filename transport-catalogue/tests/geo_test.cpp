@@ -0,0 +1,77 @@
+#include "geo.h"
+#include "check.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace {
+// NaN, which ComputeDistance gives for some close points, matches NaN
+bool IsClose(double value, double expected) {
+    if (std::isnan(expected)) {
+        return std::isnan(value);
+    }
+    return std::abs(value - expected) <= 1e-9 * std::abs(expected);
+}
+
+// far points on the whole globe, close points in a city and equal points
+std::vector<geo::Coordinates> MakePoints() {
+    std::mt19937 generator(1);
+    std::uniform_real_distribution<double> latitude(-80, 80);
+    std::uniform_real_distribution<double> longitude(-180, 180);
+    std::uniform_real_distribution<double> offset(-0.05, 0.05);
+    std::vector<geo::Coordinates> points;
+    for (int i = 0; i < 20000; ++i) {
+        points.push_back({ latitude(generator), longitude(generator) });
+        points.push_back({ 55.75 + offset(generator), 37.62 + offset(generator) });
+        points.push_back({ 55.75 + offset(generator) * 1e-6, 37.62 + offset(generator) * 1e-6 });
+    }
+    points.push_back({ 55.75, 37.62 });
+    points.push_back({ 55.75, 37.62 });
+    return points;
+}
+
+void TestBatchMatchesScalar() {
+    const std::vector<geo::Coordinates> points = MakePoints();
+    geo::CoordinatesBatch batch;
+    batch.Reserve(points.size());
+    for (const auto& point : points) {
+        batch.Add(geo::PrecomputeTrig(point));
+    }
+
+    std::vector<double> distances;
+    for (const geo::Coordinates from : { geo::Coordinates{ 55.75, 37.62 }, points.front(), points[1] }) {
+        geo::ComputeDistances(geo::PrecomputeTrig(from), batch, distances);
+        CHECK(distances.size() == points.size());
+        int mismatches = 0;
+        for (size_t i = 0; i < points.size(); ++i) {
+            const double expected = geo::ComputeDistance(from, points[i]);
+            mismatches += !IsClose(distances[i], expected);
+            mismatches += !IsClose(geo::ComputeDistance(geo::PrecomputeTrig(from), geo::PrecomputeTrig(points[i])), expected);
+        }
+        CHECK(mismatches == 0);
+    }
+    // the two points at the end are equal to it
+    geo::ComputeDistances(geo::PrecomputeTrig({ 55.75, 37.62 }), batch, distances);
+    CHECK(distances[points.size() - 1] == 0);
+    CHECK(distances[points.size() - 2] == 0);
+
+    geo::CoordinatesBatch shifted;
+    for (size_t i = 0; i < points.size(); ++i) {
+        shifted.Add(geo::PrecomputeTrig(points[(i + 1) % points.size()]));
+    }
+    geo::ComputeDistances(batch, shifted, distances);
+    int mismatches = 0;
+    for (size_t i = 0; i < points.size(); ++i) {
+        mismatches += !IsClose(distances[i], geo::ComputeDistance(points[i], points[(i + 1) % points.size()]));
+    }
+    CHECK(mismatches == 0);
+    CHECK(distances[points.size() - 2] == 0);
+}
+}  // namespace
+
+int main() {
+    RUN_TEST(TestBatchMatchesScalar);
+    return tests::FailureCount() == 0 ? 0 : 1;
+}
\ No newline at end of file
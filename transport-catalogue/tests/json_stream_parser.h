@@ -0,0 +1,13 @@
+#pragma once
+
+#include "json.h"
+
+#include <iostream>
+
+// The parser json::Load used before it read the input into a buffer: it takes characters
+// one by one from the stream. Kept as the reference for json tests and json_bench
+namespace json_stream_parser {
+
+json::Document Load(std::istream& input);
+
+}  // namespace json_stream_parser
\ No newline at end of file
@@ -0,0 +1,219 @@
+#include "json.h"
+#include "json_flat.h"
+#include "json_stream_parser.h"
+#include "check.h"
+
+#include <optional>
+#include <random>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std::literals;
+
+namespace {
+// the tree or the error message of a parse; other exceptions are outcomes of their own
+struct Outcome {
+    std::optional<json::Node> root;
+    std::string error;
+
+    bool operator==(const Outcome& other) const {
+        return root == other.root && error == other.error;
+    }
+};
+
+template <typename Loader>
+Outcome Parse(Loader loader) {
+    try {
+        return { loader().GetRoot(), {} };
+    } catch (const json::ParsingError& e) {
+        return { std::nullopt, "ParsingError: "s + e.what() };
+    } catch (const std::exception& e) {
+        return { std::nullopt, "exception: "s + e.what() };
+    }
+}
+
+Outcome ParseBuffer(const std::string& text) {
+    return Parse([&text] {
+        return json::Load(std::string_view(text));
+    });
+}
+
+Outcome ParseStream(const std::string& text) {
+    return Parse([&text] {
+        std::istringstream input(text);
+        return json::Load(input);
+    });
+}
+
+Outcome ParseFlat(const std::string& text) {
+    try {
+        return { json::flat::Load(text).GetRoot().ToNode(), {} };
+    } catch (const json::ParsingError& e) {
+        return { std::nullopt, "ParsingError: "s + e.what() };
+    } catch (const std::exception& e) {
+        return { std::nullopt, "exception: "s + e.what() };
+    }
+}
+
+Outcome ParseReference(const std::string& text) {
+    return Parse([&text] {
+        std::istringstream input(text);
+        return json_stream_parser::Load(input);
+    });
+}
+
+const std::vector<std::string> SEEDS = {
+    R"({"a":[1,2.5,-3e2,true,false,null,"x\ny\"z\\"],"b":{"c":0,"d":-0.0}})", "[1 2 ,3]", "[,1]", "{\"a\" 1}",
+    "{\"a\":1,\"a\":2}", "\"abc\ndef\"", "1e400", "-", "01", "2147483648", "-2147483649", "[tru]", "nul", "\"\\q\"",
+    "{1:2}", "   ", "[", "{\"a\":", "\"abc", "[1,]", "123abc", "1.5E+3", "{\"\xc3\xa9\":\"\xd0\x96\"}", "1e-400" };
+// characters the seeds are mutated with
+const std::string ALPHABET = "{}[],:\"\\ntrufalse0123456789.-+eE \n\t\r"s;
+
+void TestSeeds() {
+    for (const auto& text : SEEDS) {
+        const Outcome expected = ParseReference(text);
+        CHECK(ParseBuffer(text) == expected);
+        CHECK(ParseStream(text) == expected);
+    }
+    CHECK(ParseBuffer("{\"a\":1,\"a\":2}"s).error == "ParsingError: Duplicate key 'a' have been found"s);
+    CHECK(ParseBuffer("2147483648"s).root->IsPureDouble());
+    CHECK(ParseBuffer("-2147483648"s).root->AsInt() == -2147483648LL);
+}
+
+// Mutations of the seeds, every other padded past the size the structural index is built from.
+// Load has to give the tree or the ParsingError message of the stream parser it replaced
+void TestDifferential() {
+    constexpr int INPUTS = 200000;
+    std::mt19937 generator(1);
+    int mismatches = 0;
+    for (int i = 0; i < INPUTS; ++i) {
+        std::string text = SEEDS[i % SEEDS.size()];
+        const int mutations = generator() % 4;
+        for (int k = 0; k < mutations; ++k) {
+            const int operation = generator() % 3;
+            const size_t position = text.empty() ? 0 : generator() % (text.size() + 1);
+            if (operation == 0 && position < text.size()) {
+                text.erase(position, 1);
+            } else if (operation == 1) {
+                text.insert(text.begin() + position, ALPHABET[generator() % ALPHABET.size()]);
+            } else if (position < text.size()) {
+                text[position] = ALPHABET[generator() % ALPHABET.size()];
+            }
+        }
+        if (i % 2) {
+            text += std::string(5000, i % 4 == 1 ? ' ' : '\n');
+        }
+        if (!(ParseBuffer(text) == ParseReference(text))) {
+            if (mismatches++ < 10) {
+                std::cerr << "mismatch on: "sv << text.substr(0, 80) << std::endl;
+            }
+        }
+    }
+    CHECK(mismatches == 0);
+}
+// every key of the flat dictionaries is found where json::Dict has it
+bool LookupsMatch(const json::flat::Node& flat, const json::Node& node) {
+    if (flat.IsDict()) {
+        const json::flat::Dict dict = flat.AsDict();
+        if (dict.size() != node.AsDict().size() || dict.Find("\x01missing"sv) != nullptr) {
+            return false;
+        }
+        for (const auto& [key, value] : node.AsDict()) {
+            const json::flat::Node* found = dict.Find(key);
+            if (found == nullptr || found != &dict.at(key) || !LookupsMatch(*found, value)) {
+                return false;
+            }
+        }
+    } else if (flat.IsArray()) {
+        const json::flat::Array array = flat.AsArray();
+        for (size_t i = 0; i < array.size(); ++i) {
+            if (!LookupsMatch(array[i], node.AsArray().at(i))) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// nested dictionaries with escaped keys, unsorted and of different sizes
+std::string MakeDocument(std::mt19937& generator, int depth) {
+    if (depth > 3 || generator() % 3 == 0) {
+        switch (generator() % 5) {
+            case 0:
+                return std::to_string(static_cast<int>(generator()));
+            case 1:
+                return "\"s\\\"x\\\\y\\n"s + std::to_string(generator() % 100) + "\""s;
+            case 2:
+                return "true"s;
+            case 3:
+                return "-1.5e3"s;
+            default:
+                return "null"s;
+        }
+    }
+    if (generator() % 4 == 0) {
+        std::string text = "["s;
+        const int size = generator() % 4;
+        for (int i = 0; i < size; ++i) {
+            text += (i > 0 ? ","s : ""s) + MakeDocument(generator, depth + 1);
+        }
+        return text + "]"s;
+    }
+    std::string text = "{"s;
+    const int size = generator() % 12;
+    const int range = 5 + generator() % 20;
+    for (int i = 0; i < size; ++i) {
+        text += (i > 0 ? ","s : ""s) + "\"k"s + (generator() % 2 ? "\\t"s : ""s) + std::to_string(generator() % range) + "\":"s
+            + MakeDocument(generator, depth + 1);
+    }
+    return text + "}"s;
+}
+
+// the flat document holds the tree of json::Load or fails with its ParsingError
+void TestFlatMatchesLoad() {
+    constexpr int INPUTS = 20000;
+    std::mt19937 generator(3);
+    int mismatches = 0;
+    for (int i = 0; i < INPUTS; ++i) {
+        std::string text;
+        if (i % 2) {
+            text = SEEDS[i % SEEDS.size()];
+            const int mutations = generator() % 4;
+            for (int k = 0; k < mutations; ++k) {
+                const size_t position = text.empty() ? 0 : generator() % (text.size() + 1);
+                if (position < text.size()) {
+                    text[position] = ALPHABET[generator() % ALPHABET.size()];
+                }
+            }
+        } else {
+            text = MakeDocument(generator, 0);
+        }
+        if (i % 5 == 0) {
+            text.insert(0, std::string(4096 + generator() % 100, ' '));
+        }
+        const Outcome expected = ParseBuffer(text);
+        if (!(ParseFlat(text) == expected)
+            || (expected.root && !LookupsMatch(json::flat::Load(text).GetRoot(), *expected.root))) {
+            if (mismatches++ < 10) {
+                std::cerr << "mismatch on: "sv << text.substr(0, 80) << std::endl;
+            }
+        }
+    }
+    CHECK(mismatches == 0);
+
+    std::istringstream input(R"({"b": [1, "x\ty"], "a": {"c": null}})"s);
+    const json::flat::Document document = json::flat::Load(input);
+    CHECK(document.GetRoot().AsDict().begin() != document.GetRoot().AsDict().end());
+    CHECK((*document.GetRoot().AsDict().begin()).first == "a"sv);
+    CHECK(document.GetRoot().AsDict().at("b"sv).AsArray()[1].AsString() == "x\ty"sv);
+}
+}  // namespace
+
+int main() {
+    RUN_TEST(TestSeeds);
+    RUN_TEST(TestDifferential);
+    RUN_TEST(TestFlatMatchesLoad);
+    return tests::FailureCount() == 0 ? 0 : 1;
+}
\ No newline at end of file
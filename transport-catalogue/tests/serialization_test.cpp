@@ -0,0 +1,192 @@
+#include "transport_catalogue.h"
+#include "transport_router.h"
+#include "serialization.h"
+#include "check.h"
+
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace transport_catalogue;
+using namespace std::literals;
+
+namespace {
+using RoutesInternalData = graph::Router<Item>::RoutesInternalData;
+
+// Random buses over few stops with odd distances, so the times of routes are summed in different orders
+// and round differently. Buses 0 and 1 take the same stops, so their edges are parallel
+TransportCatalogue MakeCatalogue() {
+	constexpr int STOPS = 30;
+	std::mt19937 generator(1);
+	std::uniform_real_distribution<double> latitude(55.5, 56.0);
+	std::uniform_real_distribution<double> longitude(37.3, 37.9);
+	CatalogueBuilder builder;
+	std::vector<CatalogueBuilder::StopId> ids;
+	for (int i = 0; i < STOPS; ++i) {
+		const std::string name = "Stop "s + std::to_string(i);
+		ids.push_back(builder.InternStop(name));
+		builder.AddStop(name, { latitude(generator), longitude(generator) });
+	}
+	for (int i = 0; i < STOPS; ++i) {
+		for (int k = 0; k < STOPS; ++k) {
+			if (i != k) {
+				builder.AddDistance(ids[i], ids[k], 100 + generator() % 4900 + (generator() % 7) / 7.);
+			}
+		}
+	}
+	// a stop next to itself has no distance
+	auto make_stops = [&](int size) {
+		std::vector<CatalogueBuilder::StopId> stops;
+		while (stops.size() < static_cast<size_t>(size)) {
+			const auto id = ids[generator() % STOPS];
+			if (stops.empty() || stops.back() != id) {
+				stops.push_back(id);
+			}
+		}
+		return stops;
+	};
+	const std::vector<CatalogueBuilder::StopId> shared = make_stops(6);
+	for (int bus = 0; bus < 12; ++bus) {
+		std::vector<CatalogueBuilder::StopId> stops = bus > 1 ? make_stops(2 + generator() % 7) : shared;
+		if (bus % 3 == 2 && stops.back() == stops.front()) {
+			stops.pop_back();
+		}
+		const TypeRoute type_route = bus % 3 == 2 ? TypeRoute::circle : TypeRoute::line;
+		if (type_route == TypeRoute::circle) {
+			stops.push_back(stops.front());
+		}
+		builder.AddBus("Bus "s + std::to_string(bus), std::move(stops), type_route);
+	}
+	return builder.Build();
+}
+
+bool IsSameItem(const Item& lhs, const Item& rhs) {
+	return lhs.time == rhs.time && lhs.name == rhs.name && lhs.type == rhs.type && lhs.span_count == rhs.span_count;
+}
+
+bool IsSameRoutes(const RoutesInternalData& lhs, const RoutesInternalData& rhs) {
+	if (lhs.size() != rhs.size()) {
+		return false;
+	}
+	for (size_t from = 0; from < lhs.size(); ++from) {
+		if (lhs[from].size() != rhs[from].size()) {
+			return false;
+		}
+		for (size_t to = 0; to < lhs[from].size(); ++to) {
+			const auto& left = lhs[from][to];
+			const auto& right = rhs[from][to];
+			if (left.has_value() != right.has_value()) {
+				return false;
+			}
+			if (!left) {
+				continue;
+			}
+			if (!IsSameItem(left->weight, right->weight) || left->prev_edge != right->prev_edge) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+void SetProtoItem(graph_serialize::Item* proto_item, const Item& item) {
+	proto_item->set_time(item.time);
+	proto_item->set_name(std::string(item.name));
+	proto_item->set_type(item.type == ActionType::BUS ? graph_serialize::ACTION_TYPE_BUS
+		: item.type == ActionType::WAIT ? graph_serialize::ACTION_TYPE_WAIT : graph_serialize::ACTION_TYPE_ITEM);
+	proto_item->set_span_count(item.span_count.value_or(0));
+}
+
+// the router table as it was written before it was packed
+void SetLegacyRouter(transport_router_serialize::TransportRouter& proto_tran_router, const RoutesInternalData& routes_internal_data) {
+	proto_tran_router.clear_packed_router();
+	auto* proto_router = proto_tran_router.mutable_router();
+	for (const auto& row : routes_internal_data) {
+		auto* proto_row = proto_router->add_routesinternaldata();
+		for (const auto& data : row) {
+			auto* proto_data = proto_row->add_values();
+			if (!data) {
+				continue;
+			}
+			SetProtoItem(proto_data->mutable_weight(), data->weight);
+			if (data->prev_edge) {
+				proto_data->mutable_prev_edge()->set_value(static_cast<int64_t>(*data->prev_edge));
+			}
+		}
+	}
+}
+
+bool IsBroken(const transport_router_serialize::TransportRouter& proto_tran_router, const TransportCatalogue& tran_cat) {
+	try {
+		serialization::DeserializeRouteSettings(proto_tran_router, tran_cat.GetStopnameToStop(), tran_cat.GetBusnameToBus());
+	}
+	catch (const std::invalid_argument&) {
+		return true;
+	}
+	return false;
+}
+
+// the packed table restores every cell of the router it was written from, the stored times included
+void TestPackedRouter() {
+	const TransportCatalogue tran_cat = MakeCatalogue();
+	const transport_router::TransportRouter tran_router(tran_cat, RouteSettings{ 37, 3 });
+	const std::unique_ptr<transport_router_serialize::TransportRouter> proto(serialization::SerializeTransportRouter(tran_router));
+	CHECK(proto->has_packed_router());
+	CHECK(proto->packed_router().times_size() > 0);
+
+	const auto& graph = tran_router.GetGraph();
+	bool parallel = false;
+	for (graph::EdgeId first = 0; first < graph.GetEdgeCount() && !parallel; ++first) {
+		for (graph::EdgeId second = first + 1; second < graph.GetEdgeCount() && !parallel; ++second) {
+			parallel = graph.GetEdge(first).from == graph.GetEdge(second).from && graph.GetEdge(first).to == graph.GetEdge(second).to;
+		}
+	}
+	CHECK(parallel);
+
+	const auto loaded = serialization::DeserializeRouteSettings(*proto, tran_cat.GetStopnameToStop(), tran_cat.GetBusnameToBus());
+	CHECK(IsSameRoutes(loaded.GetRouter().GetRoutesInternalData(), tran_router.GetRouter().GetRoutesInternalData()));
+	CHECK(loaded.GetGraph().GetEdgeCount() == graph.GetEdgeCount());
+}
+
+// a base written before the table was packed is read as it was written
+void TestLegacyRouter() {
+	const TransportCatalogue tran_cat = MakeCatalogue();
+	const transport_router::TransportRouter tran_router(tran_cat, RouteSettings{ 37, 3 });
+	const std::unique_ptr<transport_router_serialize::TransportRouter> proto(serialization::SerializeTransportRouter(tran_router));
+	const auto& routes_internal_data = tran_router.GetRouter().GetRoutesInternalData();
+	SetLegacyRouter(*proto, routes_internal_data);
+
+	const auto loaded = serialization::DeserializeRouteSettings(*proto, tran_cat.GetStopnameToStop(), tran_cat.GetBusnameToBus());
+	CHECK(IsSameRoutes(loaded.GetRouter().GetRoutesInternalData(), routes_internal_data));
+}
+
+// tables whose times do not add up to their routes are rejected
+void TestBrokenPackedRouter() {
+	const TransportCatalogue tran_cat = MakeCatalogue();
+	const transport_router::TransportRouter tran_router(tran_cat, RouteSettings{ 37, 3 });
+	const std::unique_ptr<transport_router_serialize::TransportRouter> proto(serialization::SerializeTransportRouter(tran_router));
+	CHECK(!IsBroken(*proto, tran_cat));
+
+	auto broken = *proto;
+	broken.mutable_packed_router()->add_times(1.5);
+	CHECK(IsBroken(broken, tran_cat));
+	broken = *proto;
+	broken.mutable_packed_router()->mutable_times()->RemoveLast();
+	CHECK(IsBroken(broken, tran_cat));
+	broken = *proto;
+	broken.mutable_packed_router()->mutable_prev_edges()->RemoveLast();
+	CHECK(IsBroken(broken, tran_cat));
+	broken = *proto;
+	broken.mutable_packed_router()->set_prev_edges(1, 1000000);
+	CHECK(IsBroken(broken, tran_cat));
+}
+} //namespace
+
+int main() {
+	RUN_TEST(TestPackedRouter);
+	RUN_TEST(TestLegacyRouter);
+	RUN_TEST(TestBrokenPackedRouter);
+	return tests::FailureCount() == 0 ? 0 : 1;
+}
\ No newline at end of file
@@ -0,0 +1,228 @@
+#include "transport_catalogue.h"
+#include "serialization.h"
+#include "check.h"
+
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
+
+using namespace transport_catalogue;
+using namespace std::literals;
+
+namespace {
+TransportCatalogue MakeCatalogue(const std::vector<geo::Coordinates>& points) {
+	CatalogueBuilder builder;
+	for (size_t i = 0; i < points.size(); ++i) {
+		builder.AddStop("Stop "s + std::to_string(i), points[i]);
+	}
+	return builder.Build();
+}
+
+bool IsLess(const NearbyStop& lhs, const NearbyStop& rhs) {
+	return std::tie(lhs.distance, lhs.stop) < std::tie(rhs.distance, rhs.stop);
+}
+
+// every stop with its distance to the center, the same distance the index refines its candidates with
+std::vector<NearbyStop> ScanAll(const TransportCatalogue& tran_cat, geo::Coordinates center) {
+	const auto center_trig = geo::PrecomputeTrig(center);
+	std::vector<NearbyStop> result;
+	for (const auto& stop : tran_cat.GetDequeStops()) {
+		const double distance = geo::ComputeDistance(center_trig, stop.trig);
+		// ComputeDistance gives NaN for some close points, and the index never finds them
+		if (distance == distance) {
+			result.push_back({ &stop, distance });
+		}
+	}
+	std::sort(result.begin(), result.end(), IsLess);
+	return result;
+}
+
+bool MatchesInRadius(const TransportCatalogue& tran_cat, geo::Coordinates center, double radius) {
+	std::vector<NearbyStop> expected = ScanAll(tran_cat, center);
+	expected.erase(std::find_if(expected.begin(), expected.end(), [radius](const NearbyStop& stop) {
+		return stop.distance > radius;
+		}), expected.end());
+	std::vector<NearbyStop> found = tran_cat.GetStopsNearby(center, radius);
+	if (!std::is_sorted(found.begin(), found.end(), [](const NearbyStop& lhs, const NearbyStop& rhs) {
+		return lhs.distance < rhs.distance;
+		})) {
+		return false;
+	}
+	// stops at the same distance come in any order
+	std::sort(found.begin(), found.end(), IsLess);
+	return std::equal(found.begin(), found.end(), expected.begin(), expected.end(), [](const NearbyStop& lhs, const NearbyStop& rhs) {
+		return lhs.stop == rhs.stop && lhs.distance == rhs.distance;
+		});
+}
+
+bool MatchesNearest(const TransportCatalogue& tran_cat, geo::Coordinates center, size_t count) {
+	const std::vector<NearbyStop> expected = ScanAll(tran_cat, center);
+	const std::vector<NearbyStop> found = tran_cat.GetNearestStops(center, count);
+	if (found.size() != std::min(count, expected.size())) {
+		return false;
+	}
+	// which of the stops at the distance of the last one are found is not fixed, the distances are
+	for (size_t i = 0; i < found.size(); ++i) {
+		if (found[i].distance != expected[i].distance) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// stops of a city, some of them at the same point, and centers around it
+void TestCityMatchesScan() {
+	std::mt19937 generator(1);
+	std::uniform_real_distribution<double> latitude(55.5, 56.0);
+	std::uniform_real_distribution<double> longitude(37.3, 37.9);
+	std::vector<geo::Coordinates> points;
+	for (int i = 0; i < 2000; ++i) {
+		points.push_back({ latitude(generator), longitude(generator) });
+		if (i % 50 == 0) {
+			points.push_back(points.back());
+			points.push_back(points.back());
+		}
+	}
+	const TransportCatalogue tran_cat = MakeCatalogue(points);
+	std::uniform_real_distribution<double> outer_latitude(55.3, 56.2);
+	std::uniform_real_distribution<double> outer_longitude(37.0, 38.2);
+	std::uniform_real_distribution<double> radius(0, 5000);
+	int mismatches = 0;
+	for (int i = 0; i < 500; ++i) {
+		const geo::Coordinates center = i % 5 == 0 ? points[generator() % points.size()]
+			: geo::Coordinates{ outer_latitude(generator), outer_longitude(generator) };
+		if (!MatchesInRadius(tran_cat, center, radius(generator))
+			|| !MatchesNearest(tran_cat, center, 1 + generator() % 20)) {
+			++mismatches;
+		}
+	}
+	CHECK(mismatches == 0);
+
+	// a stop and the ones at its point are found with radius 0
+	const auto at_stop = tran_cat.GetStopsNearby(points[0], 0);
+	CHECK(at_stop.size() == 3);
+	CHECK(MatchesInRadius(tran_cat, points[0], 0));
+	CHECK(MatchesInRadius(tran_cat, { 55.75, 37.62 }, 0));
+	// a radius larger than the Earth and a count larger than the catalogue take every stop
+	CHECK(tran_cat.GetStopsNearby({ -55.75, -142.38 }, 1e8).size() == points.size());
+	CHECK(MatchesInRadius(tran_cat, { -55.75, -142.38 }, 1e8));
+	CHECK(tran_cat.GetNearestStops({ 55.75, 37.62 }, points.size() + 10).size() == points.size());
+	CHECK(MatchesNearest(tran_cat, { 55.75, 37.62 }, points.size() + 10));
+	CHECK(tran_cat.GetStopsNearby({ 55.75, 37.62 }, -1).empty());
+	CHECK(tran_cat.GetNearestStops({ 55.75, 37.62 }, 0).empty());
+}
+
+// stops on the whole globe: near the poles and on both sides of the 180th meridian
+void TestGlobeMatchesScan() {
+	std::mt19937 generator(2);
+	std::uniform_real_distribution<double> latitude(-90, 90);
+	std::uniform_real_distribution<double> longitude(-180, 180);
+	std::uniform_real_distribution<double> edge(0, 0.01);
+	std::vector<geo::Coordinates> points;
+	for (int i = 0; i < 1000; ++i) {
+		points.push_back({ latitude(generator), longitude(generator) });
+		points.push_back({ latitude(generator) / 10, i % 2 ? 180 - edge(generator) : -180 + edge(generator) });
+	}
+	const TransportCatalogue tran_cat = MakeCatalogue(points);
+	std::uniform_real_distribution<double> radius(0, 3e6);
+	int mismatches = 0;
+	for (int i = 0; i < 500; ++i) {
+		const geo::Coordinates center = i % 2 ? geo::Coordinates{ latitude(generator), longitude(generator) }
+			: geo::Coordinates{ latitude(generator) / 10, i % 4 ? 180 - edge(generator) : -180 + edge(generator) };
+		if (!MatchesInRadius(tran_cat, center, i % 3 ? radius(generator) / 1000 : radius(generator))
+			|| !MatchesNearest(tran_cat, center, 1 + generator() % 20)) {
+			++mismatches;
+		}
+	}
+	CHECK(mismatches == 0);
+}
+
+// the grid spans the stops from -179.999 to 179.999, the two are 222 m apart across the 180th meridian
+void TestAntimeridian() {
+	const TransportCatalogue tran_cat = MakeCatalogue({ { 0, 179.999 }, { 0, -179.999 }, { 0, 0 }, { 10, 90 } });
+	const Stop* east = tran_cat.FindStop("Stop 0"sv);
+	const Stop* west = tran_cat.FindStop("Stop 1"sv);
+
+	const auto nearby = tran_cat.GetStopsNearby({ 0, 179.9995 }, 1000);
+	CHECK(nearby.size() == 2);
+	CHECK(nearby.size() == 2 && nearby[0].stop == east && nearby[1].stop == west);
+	CHECK(MatchesInRadius(tran_cat, { 0, 179.9995 }, 1000));
+	CHECK(MatchesInRadius(tran_cat, { 0, -179.9995 }, 1000));
+	CHECK(MatchesInRadius(tran_cat, { 0, 180 }, 200));
+
+	const auto nearest = tran_cat.GetNearestStops({ 0, -179.9999 }, 2);
+	CHECK(nearest.size() == 2 && nearest[0].stop == west && nearest[1].stop == east);
+	for (size_t count = 1; count <= 5; ++count) {
+		CHECK(MatchesNearest(tran_cat, { 0, 179.9995 }, count));
+		CHECK(MatchesNearest(tran_cat, { 0.001, -179.9999 }, count));
+	}
+}
+
+// the index stored in a base answers as the one it was built from, a broken one is rejected
+void TestSerializedIndex() {
+	std::mt19937 generator(3);
+	std::uniform_real_distribution<double> latitude(55.5, 56.0);
+	std::uniform_real_distribution<double> longitude(37.3, 37.9);
+	std::vector<geo::Coordinates> points;
+	for (int i = 0; i < 500; ++i) {
+		points.push_back({ latitude(generator), longitude(generator) });
+	}
+	const TransportCatalogue tran_cat = MakeCatalogue(points);
+	const std::unique_ptr<transport_catalogue_serialize::TransportCatalogue> proto(serialization::SerializeTransportCatalogue(tran_cat));
+	CHECK(proto->has_stops_index());
+	const TransportCatalogue loaded = serialization::DeserializeTransportCatalogue(*proto);
+
+	const StopsIndex& index = tran_cat.GetStopsIndex();
+	const StopsIndex& loaded_index = loaded.GetStopsIndex();
+	CHECK(loaded_index.GetGrid().rows == index.GetGrid().rows);
+	CHECK(loaded_index.GetGrid().cols == index.GetGrid().cols);
+	CHECK(loaded_index.GetGrid().cell_lng == index.GetGrid().cell_lng);
+	CHECK(loaded_index.GetCellOffsets() == index.GetCellOffsets());
+	CHECK(loaded_index.GetStopIds() == index.GetStopIds());
+	int mismatches = 0;
+	for (int i = 0; i < 200; ++i) {
+		const geo::Coordinates center{ latitude(generator), longitude(generator) };
+		if (!MatchesInRadius(loaded, center, 1000) || !MatchesNearest(loaded, center, 5)) {
+			++mismatches;
+		}
+	}
+	CHECK(mismatches == 0);
+
+	auto expect_broken = [](const transport_catalogue_serialize::TransportCatalogue& proto_tran_cat) {
+		try {
+			serialization::DeserializeTransportCatalogue(proto_tran_cat);
+		}
+		catch (const std::invalid_argument&) {
+			return true;
+		}
+		return false;
+	};
+	auto broken = *proto;
+	broken.mutable_stops_index()->mutable_cell_offsets()->RemoveLast();
+	CHECK(expect_broken(broken));
+	broken = *proto;
+	broken.mutable_stops_index()->set_cell_offsets(1, broken.stops_index().cell_offsets(2) + 1);
+	CHECK(expect_broken(broken));
+	broken = *proto;
+	broken.mutable_stops_index()->set_stop_ids(0, broken.stops_index().stop_ids(1));
+	CHECK(expect_broken(broken));
+	broken = *proto;
+	broken.mutable_stops_index()->add_stop_ids(0);
+	CHECK(expect_broken(broken));
+	broken = *proto;
+	broken.mutable_stops_index()->set_rows(broken.stops_index().rows() + 1);
+	CHECK(expect_broken(broken));
+}
+} //namespace
+
+int main() {
+	RUN_TEST(TestCityMatchesScan);
+	RUN_TEST(TestGlobeMatchesScan);
+	RUN_TEST(TestAntimeridian);
+	RUN_TEST(TestSerializedIndex);
+	return tests::FailureCount() == 0 ? 0 : 1;
+}
\ No newline at end of file
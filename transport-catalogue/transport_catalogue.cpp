@@ -23,6 +23,8 @@ struct LengthToStop {
 TransportCatalogue::TransportCatalogue() = default;
 
 void TransportCatalogue::AddBus(Bus&& bus) {
+	layout_.reset();
+	bus.id = busses_.size();
 	busses_.push_back(std::move(bus));
 	auto* ptr_bus = &busses_.back();
 	busname_to_bus_[ptr_bus->name] = ptr_bus;
@@ -32,6 +34,9 @@ void TransportCatalogue::AddBus(Bus&& bus) {
 }
 
 void TransportCatalogue::AddStop(Stop&& stop) {
+	layout_.reset();
+	stop.trig = geo::PrecomputeTrig(stop.coordinates);
+	stop.id = stops.size();
 	stops.push_back(std::move(stop));
 	stopname_to_stop_[stops.back().name] = &stops.back();
 }
@@ -57,32 +62,36 @@ std::optional<BusInfo> TransportCatalogue::GetInfromBus(std::string_view busname
 	if (bus == nullptr) {
 		return {};
 	}
-	size_t stops = (bus->type_route == TypeRoute::circle) ? bus->stops.size() : (2 * bus->stops.size() - 1);
-	size_t unique_stops = bus->unique_stops.size();
+	return GetInfromBus(*bus);
+}
+
+BusInfo TransportCatalogue::GetInfromBus(const Bus& bus) const {
+	size_t stops = (bus.type_route == TypeRoute::circle) ? bus.stops.size() : (2 * bus.stops.size() - 1);
+	size_t unique_stops = bus.unique_stops.size();
 	std::vector<LengthToStop> lengths;
 	lengths.resize(stops);
 	auto summarise_circle = [this](const Stop* left, const Stop* right) {
 		auto real_length = GetLengthInStops(left, right);
-		auto geo_length = geo::ComputeDistance(left->coordinates, right->coordinates);
+		auto geo_length = geo::ComputeDistance(left->trig, right->trig);
 		return LengthToStop(real_length, geo_length);
 	};
 	auto summarise_line = [this](const Stop* left, const Stop* right) {
 		auto real_length = GetLengthInStops(left, right);
 		auto real_length_reverse = GetLengthInStops(right, left);
-		auto geo_length = geo::ComputeDistance(left->coordinates, right->coordinates);
+		auto geo_length = geo::ComputeDistance(left->trig, right->trig);
 		return LengthToStop(real_length + real_length_reverse, 2 * geo_length);
 	};
-	if (bus->type_route == TypeRoute::circle) {
-		std::transform(bus->stops.begin(), std::prev(bus->stops.end()), std::next(bus->stops.begin()), lengths.begin(), summarise_circle);
+	if (bus.type_route == TypeRoute::circle) {
+		std::transform(bus.stops.begin(), std::prev(bus.stops.end()), std::next(bus.stops.begin()), lengths.begin(), summarise_circle);
 	}
 	else {
-		std::transform(bus->stops.begin(), std::prev(bus->stops.end()), std::next(bus->stops.begin()), lengths.begin(), summarise_line);
+		std::transform(bus.stops.begin(), std::prev(bus.stops.end()), std::next(bus.stops.begin()), lengths.begin(), summarise_line);
 	}
 	LengthToStop length = std::reduce(lengths.begin(), lengths.end(), LengthToStop(0, 0), [](const LengthToStop& left, const LengthToStop& right) {
 		return LengthToStop(left.real_length_ + right.real_length_, left.geo_length_ + right.geo_length_);
 		});
 	auto curvature = length.real_length_ / length.geo_length_;
-	return { {stops, unique_stops, length.real_length_, curvature} };
+	return { stops, unique_stops, length.real_length_, curvature };
 }
 
 std::set<std::string_view> TransportCatalogue::GetListBusses(std::string_view stopname) const {
@@ -95,6 +104,12 @@ std::set<std::string_view> TransportCatalogue::GetListBusses(std::string_view st
 	return stopname_to_busses_.at(FindStop(stopname));
 }
 
+const std::set<std::string_view>& TransportCatalogue::GetStopBusses(const Stop& stop) const {
+	static const std::set<std::string_view> no_busses;
+	const auto it = stopname_to_busses_.find(&stop);
+	return it == stopname_to_busses_.end() ? no_busses : it->second;
+}
+
 double TransportCatalogue::GetLengthInStops(const Stop* left, const Stop* right) const {
 	auto key = std::make_pair(left, right);
 	auto reverse_key = std::make_pair(right, left);
@@ -120,6 +135,13 @@ const std::map<std::string_view, const Bus*>& TransportCatalogue::GetBusnameToBu
 
 const std::vector<const Stop*> TransportCatalogue::GetValidStops() const {
 	std::vector<const Stop*> result;
+	if (layout_) {
+		result.reserve(layout_->valid_stop_ids.size());
+		for (const auto id : layout_->valid_stop_ids) {
+			result.push_back(&stops[id]);
+		}
+		return result;
+	}
 	for (const auto& [stop, buses] : stopname_to_busses_) {
 		if (buses.size()) {
 			result.push_back(stop);
@@ -131,6 +153,76 @@ const std::vector<const Stop*> TransportCatalogue::GetValidStops() const {
 	return result;
 }
 
+void TransportCatalogue::Freeze() {
+	std::vector<uint32_t> valid_stop_ids;
+	for (const auto& [stop, buses] : stopname_to_busses_) {
+		if (buses.size()) {
+			valid_stop_ids.push_back(static_cast<uint32_t>(stop->id));
+		}
+	}
+	std::sort(valid_stop_ids.begin(), valid_stop_ids.end(), [this](uint32_t lhs, uint32_t rhs) {
+		return stops[lhs].name < stops[rhs].name;
+		});
+	Freeze(std::move(valid_stop_ids));
+}
+
+void TransportCatalogue::Freeze(std::vector<uint32_t>&& valid_stop_ids) {
+	CatalogueLayout layout;
+	layout.latitudes.reserve(stops.size());
+	layout.longitudes.reserve(stops.size());
+	layout.stop_names.reserve(stops.size());
+	for (const auto& stop : stops) {
+		layout.latitudes.push_back(stop.coordinates.lat);
+		layout.longitudes.push_back(stop.coordinates.lng);
+		layout.stop_names.push_back(stop.name);
+	}
+	layout.bus_stop_offsets.reserve(busses_.size() + 1);
+	layout.bus_stop_offsets.push_back(0);
+	for (const auto& bus : busses_) {
+		for (const auto* stop : bus.stops) {
+			layout.bus_stop_ids.push_back(static_cast<uint32_t>(stop->id));
+		}
+		layout.bus_stop_offsets.push_back(static_cast<uint32_t>(layout.bus_stop_ids.size()));
+	}
+	layout.valid_stop_ids = std::move(valid_stop_ids);
+	layout_ = std::move(layout);
+}
+
+bool TransportCatalogue::IsFrozen() const {
+	return layout_.has_value();
+}
+
+const CatalogueLayout& TransportCatalogue::GetLayout() const {
+	if (!layout_) {
+		throw std::logic_error("The catalogue is not frozen!"s);
+	}
+	return *layout_;
+}
+
+const Stop* TransportCatalogue::GetStop(size_t id) const {
+	return &stops.at(id);
+}
+
+const Bus* TransportCatalogue::GetBus(size_t id) const {
+	return &busses_.at(id);
+}
+
+void TransportCatalogue::BuildStopsIndex() {
+	stops_index_ = StopsIndex(stops);
+}
+
+void TransportCatalogue::SetStopsIndex(StopsIndex&& stops_index) {
+	stops_index_ = std::move(stops_index);
+}
+
+std::vector<NearbyStop> TransportCatalogue::GetStopsNearby(geo::Coordinates center, double radius) const {
+	return stops_index_.FindInRadius(center, radius);
+}
+
+std::vector<NearbyStop> TransportCatalogue::GetNearestStops(geo::Coordinates center, size_t count) const {
+	return stops_index_.FindNearest(center, count);
+}
+
 const std::unordered_map<std::string_view, const Stop*>& TransportCatalogue::GetStopnameToStop() const {
 	return stopname_to_stop_;
 }
@@ -144,4 +236,70 @@ const std::deque<Bus>& TransportCatalogue::GetDequeBusses() const {
 const std::unordered_map<std::pair<const Stop*, const Stop*>, double, detail::HashTransportCatalogue>& TransportCatalogue::GetDistanceToStops() const {
 	return distance_stops_;
 }
+const StopsIndex& TransportCatalogue::GetStopsIndex() const {
+	return stops_index_;
+}
+
+CatalogueBuilder::StopId CatalogueBuilder::InternStop(std::string_view name) {
+	if (auto it = name_to_id_.find(name); it != name_to_id_.end()) {
+		return it->second;
+	}
+	const auto id = static_cast<StopId>(names_.size());
+	names_.emplace_back(name);
+	name_to_id_.emplace(names_.back(), id);
+	id_to_stop_.push_back(nullptr);
+	return id;
+}
+
+void CatalogueBuilder::AddStop(StopId id, geo::Coordinates coordinates) {
+	tran_cat_.AddStop({ names_[id], coordinates });
+	id_to_stop_[id] = &tran_cat_.GetDequeStops().back();
+}
+
+void CatalogueBuilder::AddStop(std::string_view name, geo::Coordinates coordinates) {
+	AddStop(InternStop(name), coordinates);
+}
+
+void CatalogueBuilder::AddDistance(StopId from, StopId to, double distance) {
+	distances_.push_back({ from, to, distance });
+}
+
+void CatalogueBuilder::AddDistance(std::string_view from, std::string_view to, double distance) {
+	AddDistance(InternStop(from), InternStop(to), distance);
+}
+
+void CatalogueBuilder::AddBus(std::string&& name, std::vector<StopId>&& stops, TypeRoute type_route) {
+	busses_.push_back({ std::move(name), std::move(stops), type_route });
+}
+
+const Stop* CatalogueBuilder::ResolveStop(StopId id) const {
+	if (id_to_stop_[id] == nullptr) {
+		throw "The stopname is not found!";
+	}
+	return id_to_stop_[id];
+}
+
+TransportCatalogue CatalogueBuilder::Build() {
+	for (const auto& [from, to, distance] : distances_) {
+		tran_cat_.SetLengthInStops(ResolveStop(from), ResolveStop(to), distance);
+	}
+	for (auto& bus : busses_) {
+		std::vector<const Stop*> stops;
+		std::unordered_set<std::string_view> unique_stops;
+		stops.reserve(bus.stops.size());
+		for (const auto id : bus.stops) {
+			stops.push_back(ResolveStop(id));
+			unique_stops.insert(stops.back()->name);
+		}
+		tran_cat_.AddBus({ std::move(bus.name), std::move(stops), std::move(bus.type_route), std::move(unique_stops) });
+	}
+	distances_.clear();
+	busses_.clear();
+	name_to_id_.clear();
+	id_to_stop_.clear();
+	names_.clear();
+	tran_cat_.Freeze();
+	tran_cat_.BuildStopsIndex();
+	return std::move(tran_cat_);
+}
 } //namespace transport_catalogue
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 #include "geo.h"
 #include "domain.h"
+#include "stops_index.h"
 
 #include <string>
 #include <string_view>
@@ -25,6 +26,19 @@ namespace detail {
 	};
 }
 
+// Read-optimized copy of the catalogue, built by TransportCatalogue::Freeze once every stop and bus
+// has been added. Stops and buses are addressed by their id.
+struct CatalogueLayout {
+	std::vector<double> latitudes;
+	std::vector<double> longitudes;
+	std::vector<std::string_view> stop_names;
+	// stops of bus b are bus_stop_ids[bus_stop_offsets[b] .. bus_stop_offsets[b + 1])
+	std::vector<uint32_t> bus_stop_offsets;
+	std::vector<uint32_t> bus_stop_ids;
+	// stops passed by at least one bus, sorted by name
+	std::vector<uint32_t> valid_stop_ids;
+};
+
 class TransportCatalogue {
 	//friend class serialization::Serializator;
 public:
@@ -35,7 +49,10 @@ public:
 	const Stop* FindStop(std::string_view stopname) const;
 	const Bus* FindBus(std::string_view busname) const;
 	std::optional<BusInfo> GetInfromBus(std::string_view busname) const;
+	BusInfo GetInfromBus(const Bus& bus) const;
 	std::set<std::string_view> GetListBusses(std::string_view stopname) const;
+	// buses passing the stop, sorted by name
+	const std::set<std::string_view>& GetStopBusses(const Stop& stop) const;
 	double GetLengthInStops(const Stop* left, const Stop* right) const;
 	void SetLengthInStops(const Stop* from, const Stop* to, double length);
 
@@ -43,10 +60,24 @@ public:
 	const std::unordered_map<std::string_view, const Stop*>& GetStopnameToStop() const;
 	const std::vector<const Stop*> GetValidStops() const;
 
+	void Freeze();
+	// valid_stop_ids are known in advance, e.g. from the base file, and are not searched and sorted
+	void Freeze(std::vector<uint32_t>&& valid_stop_ids);
+	bool IsFrozen() const;
+	const CatalogueLayout& GetLayout() const;
+	const Stop* GetStop(size_t id) const;
+	const Bus* GetBus(size_t id) const;
+
+	void BuildStopsIndex();
+	void SetStopsIndex(StopsIndex&& stops_index);
+	std::vector<NearbyStop> GetStopsNearby(geo::Coordinates center, double radius) const;
+	std::vector<NearbyStop> GetNearestStops(geo::Coordinates center, size_t count) const;
+
 	// for serialization
 	const std::deque<Stop>& GetDequeStops() const;
 	const std::deque<Bus>& GetDequeBusses() const;
 	const std::unordered_map<std::pair<const Stop*, const Stop*>, double, detail::HashTransportCatalogue>& GetDistanceToStops() const;
+	const StopsIndex& GetStopsIndex() const;
 private:
 	std::deque<Stop> stops;
 	std::unordered_map<std::string_view, const Stop*> stopname_to_stop_;
@@ -54,5 +85,45 @@ private:
 	std::map<std::string_view, const Bus*> busname_to_bus_;
 	std::unordered_map<std::pair<const Stop*, const Stop*>, double, detail::HashTransportCatalogue> distance_stops_;
 	std::unordered_map<const Stop*, std::set<std::string_view>> stopname_to_busses_;
+	StopsIndex stops_index_;
+	std::optional<CatalogueLayout> layout_;
+};
+
+// Collects stops, distances and buses in any order and resolves stop names when the catalogue is built
+// Stop names are interned on first mention, so distances and buses may refer to stops
+// that are added later; Build resolves all of them in one pass over the ids.
+class CatalogueBuilder {
+public:
+	using StopId = uint32_t;
+
+	StopId InternStop(std::string_view name);
+	void AddStop(StopId id, geo::Coordinates coordinates);
+	void AddStop(std::string_view name, geo::Coordinates coordinates);
+	void AddDistance(StopId from, StopId to, double distance);
+	void AddDistance(std::string_view from, std::string_view to, double distance);
+	void AddBus(std::string&& name, std::vector<StopId>&& stops, TypeRoute type_route);
+	// adds everything to the catalogue and freezes it
+	TransportCatalogue Build();
+private:
+	struct DistanceRecord {
+		StopId from;
+		StopId to;
+		double distance;
+	};
+	struct BusRecord {
+		std::string name;
+		std::vector<StopId> stops;
+		TypeRoute type_route;
+	};
+
+	TransportCatalogue tran_cat_;
+	std::deque<std::string> names_;
+	std::unordered_map<std::string_view, StopId> name_to_id_;
+	// nullptr until the stop itself is added
+	std::vector<const Stop*> id_to_stop_;
+	std::vector<DistanceRecord> distances_;
+	std::vector<BusRecord> busses_;
+
+	const Stop* ResolveStop(StopId id) const;
 };
 } //namespace transport_catalogue
\ No newline at end of file
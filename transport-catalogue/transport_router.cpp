@@ -2,6 +2,7 @@
 
 #include <algorithm>
 #include <iterator>
+#include <stdexcept>
 
 namespace transport_router {
 using namespace graph;
@@ -35,7 +36,7 @@ TransportRouter::TransportRouter(const TransportCatalogue& tran_cat, RouteSettin
 TransportRouter::TransportRouter(RouteSettings&& route_settings,
 	std::unique_ptr<graph::DirectedWeightedGraph<Item>>&& graph,
 	std::unique_ptr<graph::Router<Item>>&& router_ptr,
-	std::map<std::string, VertexId>&& valid_stopname_to_vertex) 
+	StopnameToVertex&& valid_stopname_to_vertex) 
 	: route_settings_(std::move(route_settings))
 	, graph_(std::move(graph))
 	, router_ptr_(std::move(router_ptr))
@@ -43,7 +44,24 @@ TransportRouter::TransportRouter(RouteSettings&& route_settings,
 	{}
 
 std::optional<FoundedRoute> TransportRouter::FindRoute(std::string_view stop_from, std::string_view stop_to) const {
-	const auto& route_info = router_ptr_->BuildRoute(valid_stopname_to_vertex_.at(std::string(stop_from)), valid_stopname_to_vertex_.at(std::string(stop_to)));
+	const auto from = FindVertex(stop_from);
+	const auto to = FindVertex(stop_to);
+	if (!from || !to) {
+		throw std::out_of_range("The stopname is not found!"s);
+	}
+	return FindRoute(*from, *to);
+}
+
+std::optional<VertexId> TransportRouter::FindVertex(std::string_view stopname) const {
+	const auto it = valid_stopname_to_vertex_.find(stopname);
+	if (it == valid_stopname_to_vertex_.end()) {
+		return std::nullopt;
+	}
+	return it->second;
+}
+
+std::optional<FoundedRoute> TransportRouter::FindRoute(VertexId from, VertexId to) const {
+	const auto& route_info = router_ptr_->BuildRoute(from, to);
 	if (!route_info) {
 		return {};
 	}
@@ -67,7 +85,7 @@ const graph::Router<Item>& TransportRouter::GetRouter() const {
 	return *router_ptr_;
 }
 
-const std::map<std::string, VertexId>& TransportRouter::GetStopnameToVertex() const {
+const StopnameToVertex& TransportRouter::GetStopnameToVertex() const {
 	return valid_stopname_to_vertex_;
 }
 } //namespace transport_router
\ No newline at end of file
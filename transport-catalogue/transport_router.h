@@ -10,6 +10,8 @@ using transport_catalogue::ActionType;
 using transport_catalogue::Item;
 
 using VertexId = size_t;
+// transparent, so a stop is looked up by std::string_view
+using StopnameToVertex = std::map<std::string, VertexId, std::less<>>;
 
 class TransportRouter {
 public:
@@ -17,21 +19,24 @@ public:
 	TransportRouter(transport_catalogue::RouteSettings&& route_settings,
 		std::unique_ptr<graph::DirectedWeightedGraph<Item>>&& graph,
 		std::unique_ptr<graph::Router<Item>>&& router_ptr,
-		std::map<std::string, VertexId>&& valid_stopname_to_vertex);
+		StopnameToVertex&& valid_stopname_to_vertex);
 
 	TransportRouter(const transport_catalogue::TransportCatalogue& tran_cat, transport_catalogue::RouteSettings&& route_settings);
 	std::optional<transport_catalogue::FoundedRoute> FindRoute(std::string_view stop_from, std::string_view stop_to) const;
+	std::optional<transport_catalogue::FoundedRoute> FindRoute(VertexId from, VertexId to) const;
+	// vertex of the stop for FindRoute; nullopt if there is no such stop
+	std::optional<VertexId> FindVertex(std::string_view stopname) const;
 	
 	// for serialization
 	const transport_catalogue::RouteSettings& GetRouteSettings() const;
 	const graph::DirectedWeightedGraph<Item>& GetGraph() const;
 	const graph::Router<Item>& GetRouter() const;
-	const std::map<std::string, VertexId>& GetStopnameToVertex() const;
+	const StopnameToVertex& GetStopnameToVertex() const;
 private:
 	transport_catalogue::RouteSettings route_settings_;
 	std::unique_ptr<graph::DirectedWeightedGraph<Item>> graph_;
 	std::unique_ptr<graph::Router<Item>> router_ptr_;
-	std::map<std::string, VertexId> valid_stopname_to_vertex_;
+	StopnameToVertex valid_stopname_to_vertex_;
 
 	void BuildValidStopsVertex(const std::unordered_map<std::string_view, const transport_catalogue::Stop*>& stopname_to_stop);
 	template <typename Iterator>